@@ -31,6 +31,7 @@ extern "C"
 
 typedef struct ctf_file ctf_file_t;
 typedef struct ctf_archive_internal ctf_archive_t;
+typedef struct ctf_member_path ctf_member_path_t;
 typedef unsigned long ctf_id_t;
 
 /* This opaque definition allows libctf to accept BFD data structures without
@@ -119,6 +120,16 @@ typedef struct ctf_arinfo
   uint32_t ctr_nelems;		/* Number of elements.  */
 } ctf_arinfo_t;
 
+/* The result of evaluating a member path compiled with
+   ctf_member_path_compile() against some base type.  */
+
+typedef struct ctf_pathinfo
+{
+  ctf_id_t ctp_type;		/* Type of the member or element named.  */
+  unsigned long ctp_offset;	/* Offset from the start of the base, in bits.  */
+  unsigned long ctp_bits;	/* Width of the member or element, in bits.  */
+} ctf_pathinfo_t;
+
 typedef struct ctf_funcinfo
 {
   ctf_id_t ctc_return;		/* Function return type.  */
@@ -139,6 +150,44 @@ typedef struct ctf_snapshot_id
 
 #define	CTF_FUNC_VARARG	0x1	/* Function arguments end with varargs.  */
 
+/* The result of looking up the symbol covering an address with
+   ctf_lookup_by_addr().  */
+
+typedef struct ctf_addrinfo
+{
+  unsigned long cai_symidx;	/* Symbol table index of the symbol.  */
+  uint64_t cai_offset;		/* Offset of the address from its start.  */
+  uint32_t cai_flags;		/* Flags (see below).  */
+  ctf_id_t cai_type;		/* Data object type, if CTF_ADDR_TYPED.  */
+  ctf_funcinfo_t cai_func;	/* Function info, if CTF_ADDR_TYPED.  */
+} ctf_addrinfo_t;
+
+#define	CTF_ADDR_FUNC	0x1	/* Symbol is a function.  */
+#define	CTF_ADDR_TYPED	0x2	/* Type information is available.  */
+
+/* Iteration state for the ctf_*_next() cursor iterators, owned by the caller.
+   Initialize it to CTF_NEXT_INIT (or zero it) before the first call, and do
+   not change it between calls: its contents are otherwise private.  Once an
+   iterator returns the ECTF_NEXT_END error, its state is reset, ready for
+   reuse.  Nothing needs freeing if iteration is abandoned early.  */
+
+typedef struct ctf_next
+{
+  ctf_file_t *cnx_fp;		/* Container holding the elements, or NULL.  */
+  const void *cnx_ptr;		/* Next element.  */
+  unsigned long cnx_n;		/* Elements left, or next type index.  */
+  ctf_id_t cnx_type;		/* Type whose elements are iterated over.  */
+  int cnx_flags;		/* Private flags.  */
+} ctf_next_t;
+
+#define	CTF_NEXT_INIT { NULL, NULL, 0, 0, 0 }
+
+/* Flags for ctf_func_iter_by_type().  */
+
+#define	CTF_FUNC_BY_RETURN 0x1	/* Find functions returning the type.  */
+#define	CTF_FUNC_BY_ARG	0x2	/* Find functions taking the type.  */
+#define	CTF_FUNC_BY_BASE 0x4	/* Match types built from the type.  */
+
 /* Functions that return a ctf_id_t use the following value to indicate failure.
    ctf_errno() can be used to obtain an error code.  Functions that return
    a straight integral -1 also use ctf_errno().  */
@@ -204,7 +253,11 @@ enum
    ECTF_DUMPSECTCHANGED,	/* Section changed in middle of dump.  */
    ECTF_NOTYET,			/* Feature not yet implemented.  */
    ECTF_INTERNAL,		/* Internal error in link.  */
-   ECTF_NONREPRESENTABLE	/* Type not representable in CTF.  */
+   ECTF_NONREPRESENTABLE,	/* Type not representable in CTF.  */
+   ECTF_NOSYMADDR,		/* No symbol covers this address.  */
+   ECTF_NEXT_END,		/* End of iteration.  */
+   ECTF_NOVIEW,			/* Writable containers have no view.  */
+   ECTF_VIEWVERS		/* View version not supported.  */
   };
 
 /* The CTF data model is inferred to be the caller's data model or the data
@@ -236,6 +289,8 @@ typedef int ctf_enum_f (const char *name, int val, void *arg);
 typedef int ctf_variable_f (const char *name, ctf_id_t type, void *arg);
 typedef int ctf_type_f (ctf_id_t type, void *arg);
 typedef int ctf_type_all_f (ctf_id_t type, int flag, void *arg);
+typedef int ctf_func_sym_f (const char *name, unsigned long symidx, int argn,
+			    void *arg);
 typedef int ctf_label_f (const char *name, const ctf_lblinfo_t *info,
 			 void *arg);
 typedef int ctf_archive_member_f (ctf_file_t *fp, const char *name, void *arg);
@@ -311,6 +366,8 @@ extern int ctf_getmodel (ctf_file_t *);
 
 extern void ctf_setspecific (ctf_file_t *, void *);
 extern void *ctf_getspecific (ctf_file_t *);
+extern void ctf_setnamecache (ctf_file_t *, int);
+extern int ctf_getnamecache (ctf_file_t *);
 
 extern int ctf_errno (ctf_file_t *);
 extern const char *ctf_errmsg (int);
@@ -318,16 +375,33 @@ extern int ctf_version (int);
 
 extern int ctf_func_info (ctf_file_t *, unsigned long, ctf_funcinfo_t *);
 extern int ctf_func_args (ctf_file_t *, unsigned long, uint32_t, ctf_id_t *);
+extern int ctf_func_info_by_name (ctf_file_t *, const char *, ctf_funcinfo_t *);
+extern int ctf_func_args_by_name (ctf_file_t *, const char *, uint32_t,
+				  ctf_id_t *);
 extern int ctf_func_type_info (ctf_file_t *, ctf_id_t, ctf_funcinfo_t *);
 extern int ctf_func_type_args (ctf_file_t *, ctf_id_t, uint32_t, ctf_id_t *);
 
 extern ctf_id_t ctf_lookup_by_name (ctf_file_t *, const char *);
+extern ssize_t ctf_lookup_by_name_n (ctf_file_t *, const char **, size_t,
+				     ctf_id_t *);
+extern uint32_t ctf_name_hash (const char *);
+extern ssize_t ctf_lookup_by_name_hashed_n (ctf_file_t *, const char **,
+					    const uint32_t *, size_t,
+					    ctf_id_t *);
 extern ctf_id_t ctf_lookup_by_symbol (ctf_file_t *, unsigned long);
+extern ctf_id_t ctf_lookup_object_by_name (ctf_file_t *, const char *);
+extern int ctf_lookup_by_addr (ctf_file_t *, uint64_t, ctf_addrinfo_t *);
+extern ssize_t ctf_lookup_by_addr_n (ctf_file_t *, const uint64_t *, size_t,
+				     ctf_addrinfo_t *);
 extern ctf_id_t ctf_lookup_variable (ctf_file_t *, const char *);
+extern ssize_t ctf_lookup_variable_n (ctf_file_t *, const char **, size_t,
+				      ctf_id_t *);
+extern ctf_id_t ctf_lookup_enumerator (ctf_file_t *, const char *, int *);
 
 extern ctf_id_t ctf_type_resolve (ctf_file_t *, ctf_id_t);
 extern char *ctf_type_aname (ctf_file_t *, ctf_id_t);
 extern char *ctf_type_aname_raw (ctf_file_t *, ctf_id_t);
+extern const char *ctf_type_name_raw (ctf_file_t *, ctf_id_t);
 extern ssize_t ctf_type_lname (ctf_file_t *, ctf_id_t, char *, size_t);
 extern char *ctf_type_name (ctf_file_t *, ctf_id_t, char *, size_t);
 extern ssize_t ctf_type_size (ctf_file_t *, ctf_id_t);
@@ -342,7 +416,17 @@ extern int ctf_type_compat (ctf_file_t *, ctf_id_t, ctf_file_t *, ctf_id_t);
 
 extern int ctf_member_info (ctf_file_t *, ctf_id_t, const char *,
 			    ctf_membinfo_t *);
+extern ssize_t ctf_member_info_n (ctf_file_t *, ctf_id_t, const char **,
+				  size_t, ctf_membinfo_t *);
 extern int ctf_array_info (ctf_file_t *, ctf_id_t, ctf_arinfo_t *);
+extern ctf_member_path_t *ctf_member_path_compile (ctf_file_t *, ctf_id_t,
+						   const char *);
+extern int ctf_member_path_info (ctf_member_path_t *, ctf_file_t *, ctf_id_t,
+				 ctf_pathinfo_t *);
+extern ssize_t ctf_member_path_info_n (ctf_member_path_t *, ctf_file_t *,
+				       const ctf_id_t *, size_t,
+				       ctf_pathinfo_t *);
+extern void ctf_member_path_free (ctf_member_path_t *);
 
 extern const char *ctf_enum_name (ctf_file_t *, ctf_id_t, int);
 extern int ctf_enum_value (ctf_file_t *, ctf_id_t, const char *, int *);
@@ -357,8 +441,17 @@ extern int ctf_member_iter (ctf_file_t *, ctf_id_t, ctf_member_f *, void *);
 extern int ctf_enum_iter (ctf_file_t *, ctf_id_t, ctf_enum_f *, void *);
 extern int ctf_type_iter (ctf_file_t *, ctf_type_f *, void *);
 extern int ctf_type_iter_all (ctf_file_t *, ctf_type_all_f *, void *);
+extern int ctf_type_iter_kind (ctf_file_t *, int, ctf_type_all_f *, void *);
 extern int ctf_label_iter (ctf_file_t *, ctf_label_f *, void *);
 extern int ctf_variable_iter (ctf_file_t *, ctf_variable_f *, void *);
+extern ctf_id_t ctf_type_next (ctf_file_t *, ctf_next_t *, int *, int);
+extern ssize_t ctf_member_next (ctf_file_t *, ctf_id_t, ctf_next_t *,
+				const char **, ctf_id_t *);
+extern const char *ctf_enum_next (ctf_file_t *, ctf_id_t, ctf_next_t *,
+				  int *);
+extern ctf_id_t ctf_variable_next (ctf_file_t *, ctf_next_t *, const char **);
+extern int ctf_func_iter_by_type (ctf_file_t *, ctf_id_t, int,
+				  ctf_func_sym_f *, void *);
 extern int ctf_archive_iter (const ctf_archive_t *, ctf_archive_member_f *,
 			     void *);
 /* This function alone does not currently operate on CTF files masquerading
@@ -447,6 +540,8 @@ extern void ctf_link_set_memb_name_changer
 
 extern void ctf_setdebug (int debug);
 extern int ctf_getdebug (void);
+extern void ctf_setlazy (int lazy);
+extern int ctf_getlazy (void);
 
 #ifdef	__cplusplus
 }
@@ -0,0 +1,241 @@
+/* Inline read-only views of CTF containers.
+   Copyright (c) 2019, Oracle and/or its affiliates. All rights reserved.
+
+   Licensed under the Universal Permissive License v 1.0 as shown at
+   http://oss.oracle.com/licenses/upl.
+
+   Licensed under the GNU General Public License (GPL), version 2.  */
+
+/* This optional header lets consumers that query the same few properties of
+   very many types avoid a call into libctf for each query.  A read-only
+   container exports a ctf_view_t describing all its types, obtained once with
+   ctf_view_acquire(), over which the inline ctf_view_*() functions below
+   answer the commonest questions directly.
+
+   These functions never set errors.  Where they cannot answer (because a type
+   is invalid, lives in a parent container that has no view, or needs more
+   than the view records) they return -1 or CTF_ERR, and the caller should ask
+   the corresponding ctf_type_*() function instead, which will either answer
+   or set an error as usual.
+
+   The layout of ctf_view_t and ctf_view_type_t is part of the ABI, versioned by
+   CTF_VIEW_VERSION, which is checked when the view is acquired: new fields are
+   only ever added at the end.  Because ctv_types is an array, its elements are
+   found using the stride in ctv_type_size, not sizeof (ctf_view_type_t), so
+   that they can grow without breaking consumers built against older versions
+   of this header.  A view remains valid until its container is closed, but
+   must be acquired again after ctf_import() or ctf_setmodel().  */
+
+#ifndef	_CTF_VIEW_H
+#define	_CTF_VIEW_H
+
+#include <sys/ctf-api.h>
+
+#ifdef	__cplusplus
+extern "C"
+  {
+#endif
+
+#define CTF_VIEW_VERSION	1
+
+/* The description of one type.  */
+
+typedef struct ctf_view_type
+{
+  uint32_t ctvt_info;		/* Kind, root flag and vlen (CTF_V2_INFO_*).  */
+  uint32_t ctvt_name;		/* Reference to name in string table.  */
+#ifndef __GNUC__
+  union
+  {
+    uint32_t _size;		/* Size in bytes, or CTF_LSIZE_SENT if large.  */
+    uint32_t _type;		/* Reference to another type.  */
+  } _u;
+#else
+  __extension__
+  union
+  {
+    uint32_t ctvt_size;		/* Size in bytes, or CTF_LSIZE_SENT if large.  */
+    uint32_t ctvt_type;		/* Reference to another type.  */
+  };
+#endif
+  uint32_t ctvt_vdata;		/* Offset of vlen data from ctv_buf.  */
+} ctf_view_type_t;
+
+#ifndef __GNUC__
+#define ctvt_size _u._size
+#define ctvt_type _u._type
+#endif
+
+/* The view of one container.  */
+
+typedef struct ctf_view
+{
+  uint32_t ctv_version;		/* CTF_VIEW_VERSION of this view.  */
+  uint32_t ctv_flags;		/* CTF_VIEW_* flags.  */
+  uint32_t ctv_parmax;		/* Highest type ID of a parent type.  */
+  uint32_t ctv_typemax;		/* Highest type index in ctv_types.  */
+  const ctf_view_type_t *ctv_types; /* Types by type index (0 is unused).  */
+  const unsigned char *ctv_buf;	/* Base of the type section's vlen data.  */
+  const struct ctf_view *ctv_parent; /* View of the parent, or NULL.  */
+  uint32_t ctv_pointer_size;	/* Size of a pointer in the data model.  */
+  uint32_t ctv_int_size;	/* Size of an int (and so of an enum).  */
+  uint32_t ctv_type_size;	/* Stride of ctv_types in bytes.  */
+} ctf_view_t;
+
+#define CTF_VIEW_CHILD	0x1	/* Container is a child.  */
+
+/* Return the view of a read-only container, or NULL (setting the error on FP)
+   if it cannot export one, or not one of version VERSION.  Use
+   ctf_view_acquire(), which passes the version this header describes.  */
+
+extern const ctf_view_t *ctf_view (ctf_file_t *, int version);
+
+static inline const ctf_view_t *
+ctf_view_acquire (ctf_file_t *fp)
+{
+  return ctf_view (fp, CTF_VIEW_VERSION);
+}
+
+/* Return the description of a type, switching *VP to the view of the
+   container it is in, or NULL.  */
+
+static inline const ctf_view_type_t *
+ctf_view_type (const ctf_view_t **vp, ctf_id_t type)
+{
+  const ctf_view_t *v = *vp;
+  ctf_id_t idx;
+
+  if ((v->ctv_flags & CTF_VIEW_CHILD) && type <= v->ctv_parmax
+      && ((v = v->ctv_parent) == NULL || v->ctv_types == NULL))
+    return NULL;
+
+  idx = type & v->ctv_parmax;
+  if (idx == 0 || idx > v->ctv_typemax)
+    return NULL;
+
+  *vp = v;
+  return (const ctf_view_type_t *) ((const unsigned char *) v->ctv_types
+				    + idx * v->ctv_type_size);
+}
+
+/* As ctf_type_kind_unsliced().  */
+
+static inline int
+ctf_view_kind_unsliced (const ctf_view_t *v, ctf_id_t type)
+{
+  const ctf_view_type_t *tp;
+
+  if ((tp = ctf_view_type (&v, type)) == NULL)
+    return -1;
+
+  return CTF_V2_INFO_KIND (tp->ctvt_info);
+}
+
+/* As ctf_type_reference().  */
+
+static inline ctf_id_t
+ctf_view_reference (const ctf_view_t *v, ctf_id_t type)
+{
+  const ctf_view_type_t *tp;
+
+  if ((tp = ctf_view_type (&v, type)) == NULL)
+    return CTF_ERR;
+
+  switch (CTF_V2_INFO_KIND (tp->ctvt_info))
+    {
+    case CTF_K_POINTER:
+    case CTF_K_TYPEDEF:
+    case CTF_K_VOLATILE:
+    case CTF_K_CONST:
+    case CTF_K_RESTRICT:
+      return tp->ctvt_type;
+    case CTF_K_SLICE:
+      return ((const ctf_slice_t *) (v->ctv_buf + tp->ctvt_vdata))->cts_type;
+    default:
+      return CTF_ERR;
+    }
+}
+
+/* As ctf_type_kind().  */
+
+static inline int
+ctf_view_kind (const ctf_view_t *v, ctf_id_t type)
+{
+  int kind;
+
+  if ((kind = ctf_view_kind_unsliced (v, type)) == CTF_K_SLICE)
+    {
+      if ((type = ctf_view_reference (v, type)) == CTF_ERR)
+	return -1;
+      kind = ctf_view_kind_unsliced (v, type);
+    }
+
+  return kind;
+}
+
+/* As ctf_type_resolve().  */
+
+static inline ctf_id_t
+ctf_view_resolve (const ctf_view_t *v, ctf_id_t type)
+{
+  ctf_id_t prev = type, otype = type;
+  const ctf_view_type_t *tp;
+
+  while ((tp = ctf_view_type (&v, type)) != NULL)
+    {
+      switch (CTF_V2_INFO_KIND (tp->ctvt_info))
+	{
+	case CTF_K_TYPEDEF:
+	case CTF_K_VOLATILE:
+	case CTF_K_CONST:
+	case CTF_K_RESTRICT:
+	  if (tp->ctvt_type == type || tp->ctvt_type == otype
+	      || tp->ctvt_type == prev)
+	    return CTF_ERR;
+	  prev = type;
+	  type = tp->ctvt_type;
+	  break;
+	default:
+	  return type;
+	}
+    }
+
+  return CTF_ERR;
+}
+
+/* As ctf_type_size(), except that arrays not recording their own size are not
+   handled.  */
+
+static inline ssize_t
+ctf_view_size (const ctf_view_t *v, ctf_id_t type)
+{
+  const ctf_view_type_t *tp;
+
+  if ((type = ctf_view_resolve (v, type)) == CTF_ERR
+      || (tp = ctf_view_type (&v, type)) == NULL)
+    return -1;
+
+  switch (CTF_V2_INFO_KIND (tp->ctvt_info))
+    {
+    case CTF_K_POINTER:
+      return v->ctv_pointer_size;
+    case CTF_K_FUNCTION:
+      return 0;
+    case CTF_K_ENUM:
+      return v->ctv_int_size;
+    case CTF_K_ARRAY:
+      if (tp->ctvt_size == 0)
+	return -1;
+      /*FALLTHRU*/
+    default:
+      if (tp->ctvt_size == CTF_LSIZE_SENT)
+	return -1;
+      return tp->ctvt_size;
+    }
+}
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif				/* _CTF_VIEW_H */
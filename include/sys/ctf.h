@@ -12,6 +12,7 @@
 #include <sys/types.h>
 #include <limits.h>
 #include <stdint.h>
+#include <string.h>
 
 #ifndef BFD_ONLY
 /* Types used only for backward-compatibility with old callers. */
@@ -51,10 +52,10 @@ extern "C"
    | header | labels | objects |   info   | index  |  index   |...
    +--------+--------+---------+----------+--------+----------+...
 
-   ...+----------+-------+--------+
-   ...| variable | data  | string |
-   ...|   info   | types | table  |
-      +----------+-------+--------+
+   ...+----------+-------+--------+.......+
+   ...| variable | data  | string : index :
+   ...|   info   | types | table  :       :
+      +----------+-------+--------+.......+
 
    The file header stores a magic number and version information, encoding
    flags, and the byte offset of each of the sections relative to the end of the
@@ -95,6 +96,12 @@ extern "C"
    earlier nodes, but this is not required: nodes can point to later nodes,
    particularly structure and union members.
 
+   The optional index, present if CTF_F_IDX is set, holds the lookup tables
+   libctf would otherwise compute from the data types section at open time, in
+   a form usable in place: see ctf_idx_header_t below.  It is not described by
+   the header: it trails the string table, so consumers that do not know about
+   it see an ordinary container.
+
    Strings are recorded as a string table ID (0 or 1) and a byte offset into the
    string table.  String table 0 is the internal CTF string table.  String table
    1 is the external string table, which is the string table associated with the
@@ -201,6 +208,13 @@ typedef struct ctf_header
 
 #define CTF_F_COMPRESS	0x1	/* Data buffer is compressed by libctf.  */
 
+/* 0x2 is reserved: other CTF v3 producers already give it a meaning of their
+   own (GNU libctf's CTF_F_NEWFUNCINFO), so a container with it set need not
+   carry an index at all.  libctf only uses the index if it finds one that
+   validates, and otherwise ignores the flag and reads the types directly.  */
+
+#define CTF_F_IDX	0x2	/* Index trails the string table.  */
+
 typedef struct ctf_lblent
 {
   uint32_t ctl_label;		/* Ref to name of label.  */
@@ -559,6 +573,86 @@ typedef struct ctf_enum
   int32_t cte_value;		/* Value associated with this name.  */
 } ctf_enum_t;
 
+/* The index caches the type-offset table, pointer table and name hashes that
+   would otherwise be computed by decoding every type at open time.  It exists
+   purely to speed up opening: it contains nothing that cannot be recomputed
+   from the type section, and libctf ignores it (and recomputes everything) if
+   it is in the non-native byte order or appears damaged.
+
+   It starts at CTF_IDX_OFFSET(), the first 4-byte-aligned offset after the
+   string table, with a ctf_idx_header_t giving its size.  All offsets in the
+   index are relative to its start and are 4-byte aligned.  Containers
+   compressed by libctf never have an index, since their size when
+   decompressed is only known for the sections the header describes.
+
+   The type-offset table is an array of cti_ntypes + 1 uint32_t's, giving the
+   offset of each type relative to the end of the CTF header, indexed by type
+   index (CTF_V2_TYPE_TO_INDEX()).  Entry 0 is unused.
+
+   The pointer table is an array of the same size, giving for each type the
+   index of a pointer to that type in this container, or 0 if none is known.
+
+   Each name hash table starts with a ctf_idx_hash_t, followed by an
+   open-addressed array of ctih_nslots slots, a power of two, at least one of
+   which is empty (has a ctie_type of zero).  A name is looked up by hashing it
+   with ctf_idx_hash() and probing linearly, wrapping around, from the slot
+   indexed by the low bits of the hash until a slot with the same hash and name,
+   or an empty slot, is found.  Names in index hash tables are always in the
+   internal string table.  */
+
+#define CTF_IDX_STRUCTS	0	/* Indexes of cti_hashoff[].  */
+#define CTF_IDX_UNIONS	1
+#define CTF_IDX_ENUMS	2
+#define CTF_IDX_NAMES	3	/* Names of all other types.  */
+#define CTF_IDX_NHASH	4
+
+#define CTF_IDX_OFFSET(hp) (((hp)->cth_stroff + (hp)->cth_strlen + 3) & ~3U)
+
+typedef struct ctf_idx_header
+{
+  uint32_t cti_size;		/* Size of the index in bytes.  */
+  uint32_t cti_ntypes;		/* Number of types indexed.  */
+  uint32_t cti_txlateoff;	/* Offset of the type-offset table.  */
+  uint32_t cti_ptrtaboff;	/* Offset of the pointer table.  */
+  uint32_t cti_hashoff[CTF_IDX_NHASH]; /* Offsets of the name hash tables.  */
+} ctf_idx_header_t;
+
+typedef struct ctf_idx_hash
+{
+  uint32_t ctih_nslots;		/* Number of slots.  */
+  uint32_t ctih_nelems;		/* Number of nonempty slots.  */
+} ctf_idx_hash_t;
+
+typedef struct ctf_idx_helem
+{
+  uint32_t ctie_hash;		/* ctf_idx_hash() of name.  */
+  uint32_t ctie_name;		/* Reference to name in string table.  */
+  uint32_t ctie_type;		/* Type ID with this name, or 0 if empty.  */
+} ctf_idx_helem_t;
+
+/* The hash function used for index name hash tables: the djb2 string hash,
+   over the signed chars of the LEN-character NAME.  */
+
+static inline uint32_t
+ctf_idx_hash_n (const char *name, size_t len)
+{
+  const signed char *p = (const signed char *) name;
+  uint32_t h = 5381;
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    h = (h << 5) + h + p[i];
+  return h;
+}
+
+/* The same, over the NUL-terminated NAME.  */
+
+static inline uint32_t
+ctf_idx_hash (const char *name)
+{
+  return ctf_idx_hash_n (name, strlen (name));
+}
+
 /* The ctf_archive is a collection of ctf_file_t's stored together. The format
    is suitable for mmap()ing: this control structure merely describes the
    mmap()ed archive (and overlaps the first few bytes of it), hence the
@@ -52,6 +52,34 @@ ctf_grow_ptrtab (ctf_file_t *fp)
   return 0;
 }
 
+/* Make sure the dynamic type vector has room for the type with index IDX.  It
+   grows in the same way as the ptrtab.  */
+
+static int
+ctf_grow_dtvec (ctf_file_t *fp, size_t idx)
+{
+  size_t new_dtvec_len = fp->ctf_dtvec_len;
+  ctf_dtdef_t **new_dtvec;
+
+  if (idx < fp->ctf_dtvec_len)
+    return 0;
+
+  if (new_dtvec_len == 0)
+    new_dtvec_len = 1024;
+  while (new_dtvec_len <= idx)
+    new_dtvec_len = new_dtvec_len * 1.25;
+
+  if ((new_dtvec = realloc (fp->ctf_dtvec,
+			    new_dtvec_len * sizeof (ctf_dtdef_t *))) == NULL)
+    return (ctf_set_errno (fp, ENOMEM));
+
+  fp->ctf_dtvec = new_dtvec;
+  memset (fp->ctf_dtvec + fp->ctf_dtvec_len, 0,
+	  (new_dtvec_len - fp->ctf_dtvec_len) * sizeof (ctf_dtdef_t *));
+  fp->ctf_dtvec_len = new_dtvec_len;
+  return 0;
+}
+
 /* To create an empty CTF container, we just declare a zeroed header and call
    ctf_bufopen() on it.  If ctf_bufopen succeeds, we mark the new container r/w
    and initialize the dynamic members.  We start assigning type IDs at 1 because
@@ -62,27 +90,18 @@ ctf_create (int *errp)
 {
   static const ctf_header_t hdr = { .cth_preamble = { CTF_MAGIC, CTF_VERSION, 0 } };
 
-  ctf_dynhash_t *dthash;
   ctf_dynhash_t *dvhash;
   ctf_dynhash_t *structs = NULL, *unions = NULL, *enums = NULL, *names = NULL;
   ctf_sect_t cts;
   ctf_file_t *fp;
 
   libctf_init_debug();
-  dthash = ctf_dynhash_create (ctf_hash_integer, ctf_hash_eq_integer,
-			       NULL, NULL);
-  if (dthash == NULL)
-    {
-      ctf_set_open_errno (errp, EAGAIN);
-      goto err;
-    }
-
   dvhash = ctf_dynhash_create (ctf_hash_string, ctf_hash_eq_string,
 			       NULL, NULL);
   if (dvhash == NULL)
     {
       ctf_set_open_errno (errp, EAGAIN);
-      goto err_dt;
+      goto err;
     }
 
   structs = ctf_dynhash_create (ctf_hash_string, ctf_hash_eq_string,
@@ -111,7 +130,6 @@ ctf_create (int *errp)
   fp->ctf_unions.ctn_writable = unions;
   fp->ctf_enums.ctn_writable = enums;
   fp->ctf_names.ctn_writable = names;
-  fp->ctf_dthash = dthash;
   fp->ctf_dvhash = dvhash;
   fp->ctf_dtoldid = 0;
   fp->ctf_snapshots = 1;
@@ -134,8 +152,6 @@ ctf_create (int *errp)
   ctf_dynhash_destroy (enums);
   ctf_dynhash_destroy (names);
   ctf_dynhash_destroy (dvhash);
- err_dt:
-  ctf_dynhash_destroy (dthash);
  err:
   return NULL;
 }
@@ -241,6 +257,80 @@ ctf_update (ctf_file_t *fp)
   return 0;
 }
 
+/* Append an index to the serialized CTF in *BUFP, *SIZEP bytes long,
+   reallocating it.  The indexes are
+   built by opening the serialized CTF read-only and copying them out.  If that
+   is not possible (for instance, because names are in an external string table
+   we cannot see), no index is emitted: it is only an optimization.  */
+
+static void
+ctf_serialize_index (unsigned char **bufp, size_t *sizep)
+{
+  const ctf_header_t *hdrp = (const ctf_header_t *) *bufp;
+  ctf_header_t *nhdrp;
+  ctf_file_t *ifp;
+  ctf_idx_header_t ih;
+  const ctf_hash_t *hashes[CTF_IDX_NHASH];
+  size_t idxoff, idxsize, tabsize, hsize;
+  unsigned char *newbuf, *t;
+  int err, i;
+
+  if ((ifp = ctf_simple_open_internal ((char *) *bufp, *sizep, NULL, 0, 0,
+				       NULL, 0, NULL, 0, &err)) == NULL)
+    {
+      ctf_dprintf ("Not emitting CTF index: %s\n", ctf_errmsg (err));
+      return;
+    }
+
+  if (ctf_lazy_build (ifp, LCTF_LAZY_ALL) != 0)
+    goto out;
+
+  hashes[CTF_IDX_STRUCTS] = ifp->ctf_structs.ctn_readonly;
+  hashes[CTF_IDX_UNIONS] = ifp->ctf_unions.ctn_readonly;
+  hashes[CTF_IDX_ENUMS] = ifp->ctf_enums.ctn_readonly;
+  hashes[CTF_IDX_NAMES] = ifp->ctf_names.ctn_readonly;
+
+  memset (&ih, 0, sizeof (ih));
+  tabsize = (ifp->ctf_typemax + 1) * sizeof (uint32_t);
+  ih.cti_ntypes = ifp->ctf_typemax;
+  ih.cti_txlateoff = sizeof (ctf_idx_header_t);
+  ih.cti_ptrtaboff = ih.cti_txlateoff + tabsize;
+  idxsize = ih.cti_ptrtaboff + tabsize;
+
+  for (i = 0; i < CTF_IDX_NHASH; i++)
+    {
+      if ((hsize = ctf_hash_index_size (hashes[i])) == 0)
+	goto out;
+      ih.cti_hashoff[i] = idxsize;
+      idxsize += hsize;
+    }
+
+  ih.cti_size = idxsize;
+  idxoff = sizeof (ctf_header_t) + CTF_IDX_OFFSET (hdrp);
+
+  if ((newbuf = malloc (idxoff + idxsize)) == NULL)
+    goto out;
+
+  memcpy (newbuf, *bufp, *sizep);
+  memset (newbuf + *sizep, 0, idxoff - *sizep);
+  t = newbuf + idxoff;
+  memcpy (t, &ih, sizeof (ctf_idx_header_t));
+  memcpy (t + ih.cti_txlateoff, ifp->ctf_txlate, tabsize);
+  memcpy (t + ih.cti_ptrtaboff, ifp->ctf_ptrtab, tabsize);
+  for (i = 0; i < CTF_IDX_NHASH; i++)
+    ctf_hash_index_write (hashes[i], t + ih.cti_hashoff[i]);
+
+  nhdrp = (ctf_header_t *) newbuf;
+  nhdrp->cth_flags |= CTF_F_IDX;
+
+  free (*bufp);
+  *bufp = newbuf;
+  *sizep = idxoff + idxsize;
+
+ out:
+  ctf_file_close (ifp);
+}
+
 /* If the specified CTF container is writable and has been modified, reload this
    container with the updated type definitions, ready for serialization.  In
    order to make this code and the rest of libctf as simple as possible, we
@@ -493,6 +583,8 @@ ctf_serialize (ctf_file_t *fp)
   buf_size += hdrp->cth_strlen;
   free (strtab.cts_strs);
 
+  ctf_serialize_index (&buf, &buf_size);
+
   /* Finally, we are ready to ctf_simple_open() the new container.  If this
      is successful, we then switch nfp and fp and free the old container.  */
 
@@ -511,7 +603,9 @@ ctf_serialize (ctf_file_t *fp)
   nfp->ctf_flags |= fp->ctf_flags & ~LCTF_DIRTY;
   if (nfp->ctf_dynbase == NULL)
     nfp->ctf_dynbase = buf;		/* Make sure buf is freed on close.  */
-  nfp->ctf_dthash = fp->ctf_dthash;
+  nfp->ctf_dtvec = fp->ctf_dtvec;
+  nfp->ctf_dtvec_len = fp->ctf_dtvec_len;
+  nfp->ctf_typemax = fp->ctf_typemax;
   nfp->ctf_dtdefs = fp->ctf_dtdefs;
   nfp->ctf_dvhash = fp->ctf_dvhash;
   nfp->ctf_dvdefs = fp->ctf_dvdefs;
@@ -538,7 +632,8 @@ ctf_serialize (ctf_file_t *fp)
   nfp->ctf_enums = fp->ctf_enums;
   nfp->ctf_names = fp->ctf_names;
 
-  fp->ctf_dthash = NULL;
+  fp->ctf_dtvec = NULL;
+  fp->ctf_dtvec_len = 0;
   ctf_str_free_atoms (nfp);
   nfp->ctf_str_atoms = fp->ctf_str_atoms;
   nfp->ctf_prov_strtab = fp->ctf_prov_strtab;
@@ -591,8 +686,10 @@ int
 ctf_dtd_insert (ctf_file_t *fp, ctf_dtdef_t *dtd, int flag, int kind)
 {
   const char *name;
-  if (ctf_dynhash_insert (fp->ctf_dthash, (void *) dtd->dtd_type, dtd) < 0)
-    return -1;
+  size_t idx = LCTF_TYPE_TO_INDEX (fp, dtd->dtd_type);
+
+  if (ctf_grow_dtvec (fp, idx) < 0)
+    return -1;				/* errno is set for us.  */
 
   if (flag == CTF_ADD_ROOT && dtd->dtd_data.ctt_name
       && (name = ctf_strraw (fp, dtd->dtd_data.ctt_name)) != NULL)
@@ -600,11 +697,12 @@ ctf_dtd_insert (ctf_file_t *fp, ctf_dtdef_t *dtd, int flag, int kind)
       if (ctf_dynhash_insert (ctf_name_table (fp, kind)->ctn_writable,
 			      (char *) name, (void *) dtd->dtd_type) < 0)
 	{
-	  ctf_dynhash_remove (fp->ctf_dthash, (void *) dtd->dtd_type);
 	  return -1;
 	}
     }
+  fp->ctf_dtvec[idx] = dtd;
   ctf_list_append (&fp->ctf_dtdefs, dtd);
+  ctf_kinds_invalidate (fp);
   return 0;
 }
 
@@ -615,8 +713,11 @@ ctf_dtd_delete (ctf_file_t *fp, ctf_dtdef_t *dtd)
   int kind = LCTF_INFO_KIND (fp, dtd->dtd_data.ctt_info);
   int name_kind = kind;
   const char *name;
+  size_t idx = LCTF_TYPE_TO_INDEX (fp, dtd->dtd_type);
 
-  ctf_dynhash_remove (fp->ctf_dthash, (void *) dtd->dtd_type);
+  if (idx < fp->ctf_dtvec_len && fp->ctf_dtvec[idx] == dtd)
+    fp->ctf_dtvec[idx] = NULL;
+  ctf_kinds_invalidate (fp);
 
   switch (kind)
     {
@@ -653,10 +754,21 @@ ctf_dtd_delete (ctf_file_t *fp, ctf_dtdef_t *dtd)
   free (dtd);
 }
 
+/* Look up the dynamic type definition of TYPE, which must be a type in FP
+   itself, not its parent.  */
+
 ctf_dtdef_t *
 ctf_dtd_lookup (const ctf_file_t *fp, ctf_id_t type)
 {
-  return (ctf_dtdef_t *) ctf_dynhash_lookup (fp->ctf_dthash, (void *) type);
+  size_t idx = LCTF_TYPE_TO_INDEX (fp, type);
+
+  if ((fp->ctf_flags & LCTF_CHILD) ? LCTF_TYPE_ISPARENT (fp, type)
+      : LCTF_TYPE_ISCHILD (fp, type))
+    return NULL;
+
+  if (idx >= fp->ctf_dtvec_len)
+    return NULL;
+  return fp->ctf_dtvec[idx];
 }
 
 ctf_dtdef_t *
@@ -768,7 +880,6 @@ ctf_rollback (ctf_file_t *fp, ctf_snapshot_id_t id)
 	  ctf_str_remove_ref (fp, name, &dtd->dtd_data.ctt_name);
 	}
 
-      ctf_dynhash_remove (fp->ctf_dthash, (void *) dtd->dtd_type);
       ctf_dtd_delete (fp, dtd);
     }
 
@@ -784,6 +895,7 @@ ctf_rollback (ctf_file_t *fp, ctf_snapshot_id_t id)
 
   fp->ctf_typemax = id.dtd_id;
   fp->ctf_snapshots = id.snapshot_id;
+  ctf_tcache_clear (fp);
 
   if (fp->ctf_snapshots == fp->ctf_snapshot_lu)
     fp->ctf_flags &= ~LCTF_DIRTY;
@@ -824,14 +936,21 @@ ctf_add_generic (ctf_file_t *fp, uint32_t flag, const char *name, int kind,
   dtd->dtd_data.ctt_name = ctf_str_add_ref (fp, name, &dtd->dtd_data.ctt_name);
   dtd->dtd_type = type;
 
+  /* On failure, give the type ID back, so that no hole is left in the
+     ctf_dtvec below ctf_typemax.  */
+
   if (dtd->dtd_data.ctt_name == 0 && name != NULL && name[0] != '\0')
     {
+      fp->ctf_typemax--;
       free (dtd);
       return (ctf_set_errno (fp, EAGAIN));
     }
 
   if (ctf_dtd_insert (fp, dtd, flag, kind) < 0)
     {
+      if (dtd->dtd_data.ctt_name != 0)
+	ctf_str_remove_ref (fp, name, &dtd->dtd_data.ctt_name);
+      fp->ctf_typemax--;
       free (dtd);
       return CTF_ERR;			/* errno is set for us.  */
     }
@@ -923,6 +1042,26 @@ ctf_add_reftype (ctf_file_t *fp, uint32_t flag, ctf_id_t ref, uint32_t kind)
 	  && strcmp (ctf_strptr (fp, dtd->dtd_data.ctt_name), "") == 0
 	  && refref_idx < fp->ctf_typemax)
 	fp->ctf_ptrtab[refref_idx] = type_idx;
+
+      /* A pointer to an anonymous typedef of a parent type is a pointer to
+	 that type too: just throw the parent pointer table away.  */
+      if (child && fp->ctf_pptrtab != NULL)
+	{
+	  free (fp->ctf_pptrtab);
+	  fp->ctf_pptrtab = NULL;
+	}
+    }
+  else if (child && fp->ctf_pptrtab != NULL)
+    {
+      /* A pointer in a child to a parent type.  */
+
+      if (ref_idx < fp->ctf_pptrtab->cpp_len)
+	fp->ctf_pptrtab->cpp_ptrs[ref_idx] = type_idx;
+      else
+	{
+	  free (fp->ctf_pptrtab);
+	  fp->ctf_pptrtab = NULL;
+	}
     }
 
   return type;
@@ -1029,6 +1168,7 @@ ctf_set_array (ctf_file_t *fp, ctf_id_t type, const ctf_arinfo_t *arp)
 
   fp->ctf_flags |= LCTF_DIRTY;
   dtd->dtd_u.dtu_arr = *arp;
+  ctf_tcache_invalidate (fp, type);
 
   return 0;
 }
@@ -1098,7 +1238,10 @@ ctf_add_struct_sized (ctf_file_t *fp, uint32_t flag, const char *name,
     type = ctf_lookup_by_rawname (fp, CTF_K_STRUCT, name);
 
   if (type != 0 && ctf_type_kind (fp, type) == CTF_K_FORWARD)
-    dtd = ctf_dtd_lookup (fp, type);
+    {
+      dtd = ctf_dtd_lookup (fp, type);
+      ctf_kinds_invalidate (fp);
+    }
   else if ((type = ctf_add_generic (fp, flag, name, CTF_K_STRUCT,
 				    &dtd)) == CTF_ERR)
     return CTF_ERR;		/* errno is set for us.  */
@@ -1113,6 +1256,7 @@ ctf_add_struct_sized (ctf_file_t *fp, uint32_t flag, const char *name,
     }
   else
     dtd->dtd_data.ctt_size = (uint32_t) size;
+  ctf_tcache_invalidate (fp, type);
 
   return type;
 }
@@ -1135,7 +1279,10 @@ ctf_add_union_sized (ctf_file_t *fp, uint32_t flag, const char *name,
     type = ctf_lookup_by_rawname (fp, CTF_K_UNION, name);
 
   if (type != 0 && ctf_type_kind (fp, type) == CTF_K_FORWARD)
-    dtd = ctf_dtd_lookup (fp, type);
+    {
+      dtd = ctf_dtd_lookup (fp, type);
+      ctf_kinds_invalidate (fp);
+    }
   else if ((type = ctf_add_generic (fp, flag, name, CTF_K_UNION,
 				    &dtd)) == CTF_ERR)
     return CTF_ERR;		/* errno is set for us */
@@ -1150,6 +1297,7 @@ ctf_add_union_sized (ctf_file_t *fp, uint32_t flag, const char *name,
     }
   else
     dtd->dtd_data.ctt_size = (uint32_t) size;
+  ctf_tcache_invalidate (fp, type);
 
   return type;
 }
@@ -1171,13 +1319,17 @@ ctf_add_enum (ctf_file_t *fp, uint32_t flag, const char *name)
     type = ctf_lookup_by_rawname (fp, CTF_K_ENUM, name);
 
   if (type != 0 && ctf_type_kind (fp, type) == CTF_K_FORWARD)
-    dtd = ctf_dtd_lookup (fp, type);
+    {
+      dtd = ctf_dtd_lookup (fp, type);
+      ctf_kinds_invalidate (fp);
+    }
   else if ((type = ctf_add_generic (fp, flag, name, CTF_K_ENUM,
 				    &dtd)) == CTF_ERR)
     return CTF_ERR;		/* errno is set for us.  */
 
   dtd->dtd_data.ctt_info = CTF_TYPE_INFO (CTF_K_ENUM, flag, 0);
   dtd->dtd_data.ctt_size = fp->ctf_dmodel->ctd_int;
+  ctf_tcache_invalidate (fp, type);
 
   return type;
 }
@@ -1332,6 +1484,9 @@ ctf_add_enumerator (ctf_file_t *fp, ctf_id_t enid, const char *name,
 
   dtd->dtd_data.ctt_info = CTF_TYPE_INFO (kind, root, vlen + 1);
   ctf_list_append (&dtd->dtd_u.dtu_members, dmd);
+  ctf_tcache_invalidate (fp, enid);
+  free (fp->ctf_enumerators);
+  fp->ctf_enumerators = NULL;
 
   fp->ctf_flags |= LCTF_DIRTY;
 
@@ -1451,6 +1606,7 @@ ctf_add_member_offset (ctf_file_t *fp, ctf_id_t souid, const char *name,
 
   dtd->dtd_data.ctt_info = CTF_TYPE_INFO (kind, root, vlen + 1);
   ctf_list_append (&dtd->dtd_u.dtu_members, dmd);
+  ctf_tcache_invalidate (fp, souid);
 
   fp->ctf_flags |= LCTF_DIRTY;
   return 0;
@@ -1996,6 +2152,7 @@ ctf_add_type_internal (ctf_file_t *dst_fp, ctf_file_t *src_fp, ctf_id_t src_type
 	    else
 	      dmd->dmd_type = memb_type;
 	  }
+	ctf_tcache_invalidate (dst_fp, dst_type);
 
 	if (errs)
 	  return CTF_ERR;			/* errno is set for us.  */
@@ -2110,6 +2267,15 @@ ctf_gzwrite (ctf_file_t *fp, gzFile fd)
   return 0;
 }
 
+/* Return the size of the CTF data stream without any trailing index, which is
+   never compressed: see CTF_IDX_OFFSET().  */
+
+static size_t
+ctf_unindexed_size (const ctf_file_t *fp)
+{
+  return fp->ctf_header->cth_stroff + fp->ctf_header->cth_strlen;
+}
+
 /* Compress the specified CTF data stream and write it to the specified file
    descriptor.  */
 int
@@ -2121,6 +2287,7 @@ ctf_compress_write (ctf_file_t *fp, int fd)
   ctf_header_t *hp = &h;
   ssize_t header_len = sizeof (ctf_header_t);
   ssize_t compress_len;
+  size_t size;
   ssize_t len;
   int rc;
   int err = 0;
@@ -2130,13 +2297,15 @@ ctf_compress_write (ctf_file_t *fp, int fd)
 
   memcpy (hp, fp->ctf_header, header_len);
   hp->cth_flags |= CTF_F_COMPRESS;
-  compress_len = compressBound (fp->ctf_size);
+  hp->cth_flags &= ~CTF_F_IDX;
+  size = ctf_unindexed_size (fp);
+  compress_len = compressBound (size);
 
   if ((buf = malloc (compress_len)) == NULL)
     return (ctf_set_errno (fp, ECTF_ZALLOC));
 
   if ((rc = compress (buf, (uLongf *) &compress_len,
-		      fp->ctf_buf, fp->ctf_size)) != Z_OK)
+		      fp->ctf_buf, size)) != Z_OK)
     {
       ctf_dprintf ("zlib deflate err: %s\n", zError (rc));
       err = ctf_set_errno (fp, ECTF_COMPRESS);
@@ -2210,8 +2379,9 @@ ctf_write_mem (ctf_file_t *fp, size_t *size, size_t threshold)
   else
     {
       hp->cth_flags |= CTF_F_COMPRESS;
+      hp->cth_flags &= ~CTF_F_IDX;
       if ((rc = compress (bp, (uLongf *) &compress_len,
-			  fp->ctf_buf, fp->ctf_size)) != Z_OK)
+			  fp->ctf_buf, ctf_unindexed_size (fp))) != Z_OK)
 	{
 	  ctf_dprintf ("zlib deflate err: %s\n", zError (rc));
 	  ctf_set_errno (fp, ECTF_COMPRESS);
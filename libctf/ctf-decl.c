@@ -25,23 +25,38 @@
    The functions in this file build a set of stacks from the type graph nodes
    corresponding to the C operator precedence levels in the appropriate order.
    The code in ctf_type_name() can then iterate over the levels and nodes in
-   lexical precedence order and construct the final C declaration string.  */
+   lexical precedence order and construct the final C declaration string.
+
+   Nodes come from a pool in the ctf_decl_t itself, so a declaration stack
+   living on the caller's stack needs no allocation unless it is very deep, and
+   the declaration is formatted straight into a buffer provided by the caller,
+   truncating it (as snprintf() does) if it is too small.  */
 
 #include <ctf-impl.h>
 #include <string.h>
 
 void
-ctf_decl_init (ctf_decl_t *cd)
+ctf_decl_init (ctf_decl_t *cd, char *buf, size_t len)
 {
   int i;
 
-  memset (cd, 0, sizeof (ctf_decl_t));
+  /* Leave the node pool alone: it is not used until handed out.  */
+
+  memset (cd->cd_nodes, 0, sizeof (cd->cd_nodes));
 
   for (i = CTF_PREC_BASE; i < CTF_PREC_MAX; i++)
     cd->cd_order[i] = CTF_PREC_BASE - 1;
 
   cd->cd_qualp = CTF_PREC_BASE;
   cd->cd_ordp = CTF_PREC_BASE;
+  cd->cd_npool = 0;
+  cd->cd_buf = buf;
+  cd->cd_len = len;
+  cd->cd_pos = 0;
+  cd->cd_err = 0;
+
+  if (len > 0)
+    buf[0] = '\0';
 }
 
 void
@@ -50,12 +65,16 @@ ctf_decl_fini (ctf_decl_t *cd)
   ctf_decl_node_t *cdp, *ndp;
   int i;
 
+  if (cd->cd_npool < CTF_DECL_NPOOL)
+    return;			/* Nothing was allocated.  */
+
   for (i = CTF_PREC_BASE; i < CTF_PREC_MAX; i++)
     {
       for (cdp = ctf_list_next (&cd->cd_nodes[i]); cdp != NULL; cdp = ndp)
 	{
 	  ndp = ctf_list_next (cdp);
-	  free (cdp);
+	  if (cdp < cd->cd_pool || cdp >= cd->cd_pool + CTF_DECL_NPOOL)
+	    free (cdp);
 	}
     }
 }
@@ -122,7 +141,9 @@ ctf_decl_push (ctf_decl_t *cd, ctf_file_t *fp, ctf_id_t type)
       prec = CTF_PREC_BASE;
     }
 
-  if ((cdp = malloc (sizeof (ctf_decl_node_t))) == NULL)
+  if (cd->cd_npool < CTF_DECL_NPOOL)
+    cdp = &cd->cd_pool[cd->cd_npool++];
+  else if ((cdp = malloc (sizeof (ctf_decl_node_t))) == NULL)
     {
       cd->cd_err = EAGAIN;
       return;
@@ -151,39 +172,29 @@ ctf_decl_push (ctf_decl_t *cd, ctf_file_t *fp, ctf_id_t type)
     ctf_list_append (&cd->cd_nodes[prec], cdp);
 }
 
+/* Append to the declaration being formatted, truncating it if the buffer is
+   full, but counting the length it would have had regardless.  */
+
 _libctf_printflike_ (2, 3)
 void ctf_decl_sprintf (ctf_decl_t *cd, const char *format, ...)
 {
+  size_t avail = cd->cd_pos < cd->cd_len ? cd->cd_len - cd->cd_pos : 0;
   va_list ap;
-  char *str;
   int n;
 
-  if (cd->cd_enomem)
-    return;
-
   va_start (ap, format);
-  n = vasprintf (&str, format, ap);
+  n = vsnprintf (avail > 0 ? cd->cd_buf + cd->cd_pos : NULL, avail,
+		 format, ap);
   va_end (ap);
 
   if (n > 0)
-    {
-      char *newbuf;
-      if ((newbuf = ctf_str_append (cd->cd_buf, str)) != NULL)
-	cd->cd_buf = newbuf;
-    }
-
-  /* Sticky error condition.  */
-  if (n < 0 || cd->cd_buf == NULL)
-    {
-      free (cd->cd_buf);
-      cd->cd_buf = NULL;
-      cd->cd_enomem = 1;
-    }
-
-  free (str);
+    cd->cd_pos += n;
 }
 
-char *ctf_decl_buf (ctf_decl_t *cd)
+/* Return the length of the formatted declaration, which may exceed the length
+   of the buffer.  */
+
+size_t ctf_decl_len (ctf_decl_t *cd)
 {
-  return cd->cd_buf;
+  return cd->cd_pos;
 }
@@ -286,6 +286,11 @@ ctf_dump_header (ctf_file_t *fp, ctf_dump_state_t *state)
 				 hp->cth_stroff + hp->cth_strlen + 1) < 0)
     goto err;
 
+  if ((hp->cth_flags & CTF_F_IDX)
+      && ctf_dump_header_sectfield (fp, state, "Index", CTF_IDX_OFFSET (hp),
+				    fp->ctf_size) < 0)
+    goto err;
+
   return 0;
  err:
   return (ctf_set_errno (fp, errno));
@@ -61,7 +61,11 @@ static const char *const _ctf_errlist[] = {
   "Section changed in middle of dump",		     /* ECTF_DUMPSECTCHANGED */
   "Feature not yet implemented",		     /* ECTF_NOTYET */
   "Internal error in link",			     /* ECTF_INTERNAL */
-  "Type not representable in CTF"		     /* ECTF_NONREPRESENTABLE */
+  "Type not representable in CTF",		     /* ECTF_NONREPRESENTABLE */
+  "No symbol covers this address",		     /* ECTF_NOSYMADDR */
+  "End of iteration",				     /* ECTF_NEXT_END */
+  "Writable containers have no view",		     /* ECTF_NOVIEW */
+  "View version not supported"			     /* ECTF_VIEWVERS */
 };
 
 static const int _ctf_nerr = sizeof (_ctf_errlist) / sizeof (_ctf_errlist[0]);
@@ -82,5 +86,5 @@ ctf_errmsg (int error)
 int
 ctf_errno (ctf_file_t * fp)
 {
-  return fp->ctf_errno;
+  return __atomic_load_n (&fp->ctf_errno, __ATOMIC_RELAXED);
 }
@@ -26,8 +26,6 @@
    where it is instead universally cast into the type of the *real* hash
    implementation.  */
 
-static const uint32_t _CTF_EMPTY[1] = { 0 };
-
 /* Hash functions. */
 
 unsigned int
@@ -135,53 +133,47 @@ ctf_dynhash_destroy (ctf_dynhash_t *hp)
 }
 
 /* ctf_hash, used for fixed-size maps from const char * -> ctf_id_t without
-   removal.  TODO: implement one-shot initialization with precomputed bucket
-   distribution.  */
+   removal.  This is an open-addressing table with linear probing, sized once at
+   creation time from the number of elements it is to hold: since that is known
+   exactly before any insertions, the table never needs to grow or rehash.  Each
+   slot caches the full hash of its name, so that probes only touch the string
+   table when the hashes match.  A type ID of zero denotes an empty slot.
+
+   The layout of the slots is the same as that of the hash tables in the CTF
+   index section (see <sys/ctf.h>), so that hashes can be written out into it
+   and used in place from it.  */
 
 typedef struct ctf_helem
 {
+  uint32_t h_hash;		/* Hash of name.  */
   uint32_t h_name;		/* Reference to name in string table.  */
-  uint32_t h_next;		/* Index of next element in hash chain.  */
-  ctf_id_t h_type;		/* Corresponding type ID number.  */
-} ctf_helem_t;
+  uint32_t h_type;		/* Corresponding type ID number.  */
+} ctf_helem_t;			/* Same layout as ctf_idx_helem_t.  */
 
 typedef struct ctf_fixed_hash
 {
-  ctf_helem_t *h_chains;	/* Hash chains buffer.  */
-  uint32_t *h_buckets;		/* Hash bucket array (chain indices).  */
-  uint32_t h_nbuckets;		/* Number of elements in bucket array.  */
-  uint32_t h_nelems;		/* Number of elements in hash table.  */
-  uint32_t h_free;		/* Index of next free hash element.  */
+  ctf_helem_t *h_slots;		/* Slot array.  */
+  uint32_t h_nslots;		/* Number of slots: a power of two.  */
+  uint32_t h_nelems;		/* Maximum number of elements in table.  */
+  uint32_t h_count;		/* Number of elements in table.  */
+  int h_borrowed;		/* Slots are in the CTF buffer.  */
 } ctf_hash_t;
 
-/* Table of primes up to almost as high as it's worth going -- there is no point
-   going all the way up to 2^32: an average chain length of four is not a
-   disaster.  */
-
-static uint32_t const primes[] = { 1021, 2039, 4093, 8191, 16381,
-				   32749, 65521, 131071, 262139,
-				   524287, 1048573, 2097143,
-				   4194301, 8388593, 16777213,
-				   33554393, 67108859, 134217689,
-				   268435399, 536870909, 1073741789 };
+static const ctf_helem_t _CTF_EMPTY_SLOT[1];
 
-/* Find a prime greater than N, near a power of two.  */
+/* Find the number of slots needed to hold N elements: a power of two keeping
+   the load factor no higher than 2/3, with at least one slot always free so
+   that unsuccessful probes terminate.  */
 
-static uint32_t
-find_prime (unsigned long n)
+static size_t
+find_nslots (unsigned long n)
 {
-  uint32_t low = 0;
-  uint32_t high = sizeof(primes) / sizeof(uint32_t);
+  size_t want = (size_t) n + n / 2 + 1;
+  size_t nslots = 1;
 
-  while (low != high)
-    {
-      uint32_t mid = low + (high - low) / 2;
-      if (n > primes[mid])
-	low = mid + 1;
-      else
-	high = mid;
-    }
-  return primes[low];
+  while (nslots < want)
+    nslots <<= 1;
+  return nslots;
 }
 
 ctf_hash_t *
@@ -189,6 +181,7 @@ ctf_hash_create (unsigned long nelems, ctf_hash_fun hash_fun,
 		 ctf_hash_eq_fun eq_fun)
 {
   ctf_hash_t *hp;
+  size_t nslots;
 
   if ((hash_fun != ctf_hash_string) || (eq_fun != ctf_hash_eq_string))
     {
@@ -196,7 +189,7 @@ ctf_hash_create (unsigned long nelems, ctf_hash_fun hash_fun,
       return NULL;
     }
 
-  if (nelems > UINT32_MAX)
+  if (nelems > UINT32_MAX / 2 || (nslots = find_nslots (nelems)) > UINT32_MAX)
     {
       errno = EOVERFLOW;
       return NULL;
@@ -208,27 +201,24 @@ ctf_hash_create (unsigned long nelems, ctf_hash_fun hash_fun,
       return NULL;
     }
 
+  memset (hp, 0, sizeof (ctf_hash_t));
+
   /* If the hash table is going to be empty, don't bother allocating any
-     memory and make the only bucket point to a zero so lookups fail.  */
+     memory and make the only slot an empty one so lookups fail.  */
 
   if (nelems == 0)
     {
-      memset (hp, 0, sizeof (ctf_hash_t));
-      hp->h_buckets = (uint32_t *) _CTF_EMPTY;
-      hp->h_nbuckets = 1;
+      hp->h_slots = (ctf_helem_t *) _CTF_EMPTY_SLOT;
+      hp->h_nslots = 1;
       return hp;
     }
 
-  hp->h_nbuckets = find_prime (nelems);
-  hp->h_nelems = nelems + 1;	/* We use index zero as a sentinel.  */
-  hp->h_free = 1;		/* First free element is index 1.  */
-
-  hp->h_buckets = calloc (hp->h_nbuckets, sizeof (uint32_t));
-  hp->h_chains = calloc (hp->h_nelems, sizeof (ctf_helem_t));
+  hp->h_nslots = nslots;
+  hp->h_nelems = nelems;
 
-  if (hp->h_buckets == NULL || hp->h_chains == NULL)
+  if ((hp->h_slots = calloc (hp->h_nslots, sizeof (ctf_helem_t))) == NULL)
     {
-      ctf_hash_destroy (hp);
+      free (hp);
       errno = ENOMEM;
       return NULL;
     }
@@ -239,23 +229,54 @@ ctf_hash_create (unsigned long nelems, ctf_hash_fun hash_fun,
 uint32_t
 ctf_hash_size (const ctf_hash_t *hp)
 {
-  return (hp->h_nelems ? hp->h_nelems - 1 : 0);
+  return hp->h_count;
+}
+
+/* Return the string NAME refers to, for comparison against a key.  */
+
+static inline const char *
+ctf_hash_name (ctf_file_t *fp, uint32_t name)
+{
+  ctf_strs_t *ctsp = &fp->ctf_str[CTF_NAME_STID (name)];
+  return ctsp->cts_strs + CTF_NAME_OFFSET (name);
+}
+
+/* Find the slot for KEY, with hash H: either the slot holding it, or the empty
+   slot where it would be inserted.  */
+
+static inline ctf_helem_t *
+ctf_hash_probe (const ctf_hash_t *hp, ctf_file_t *fp, const char *key,
+		uint32_t h)
+{
+  uint32_t mask = hp->h_nslots - 1;
+  uint32_t i;
+
+  for (i = h & mask;; i = (i + 1) & mask)
+    {
+      ctf_helem_t *hep = &hp->h_slots[i];
+
+      if (hep->h_type == 0)
+	return hep;
+
+      if (hep->h_hash == h && strcmp (key, ctf_hash_name (fp, hep->h_name)) == 0)
+	return hep;
+    }
 }
 
+/* Insert a TYPE with the given NAME into the hash.  If the NAME is already
+   present, the new TYPE replaces the old one.  */
+
 int
 ctf_hash_insert_type (ctf_hash_t * hp, ctf_file_t * fp, uint32_t type,
 		      uint32_t name)
 {
   const char *str = ctf_strraw (fp, name);
-  ctf_helem_t *hep = &hp->h_chains[hp->h_free];
+  ctf_helem_t *hep;
   uint32_t h;
 
   if (type == 0)
     return EINVAL;
 
-  if (hp->h_free >= hp->h_nelems)
-    return EOVERFLOW;
-
   if (str == NULL
       && CTF_NAME_STID (name) == CTF_STRTAB_1
       && fp->ctf_syn_ext_strtab == NULL
@@ -268,19 +289,26 @@ ctf_hash_insert_type (ctf_hash_t * hp, ctf_file_t * fp, uint32_t type,
   if (str[0] == '\0')
     return 0;		   /* Just ignore empty strings on behalf of caller.  */
 
+  h = ctf_idx_hash (str);
+  hep = ctf_hash_probe (hp, fp, str, h);
+
+  if (hep->h_type == 0)
+    {
+      if (hp->h_count >= hp->h_nelems)
+	return EOVERFLOW;
+      hp->h_count++;
+    }
+
+  hep->h_hash = h;
   hep->h_name = name;
   hep->h_type = type;
-  h = ctf_hash_string (str) % hp->h_nbuckets;
-  hep->h_next = hp->h_buckets[h];
-  hp->h_buckets[h] = hp->h_free++;
 
   return 0;
 }
 
 /* Wrapper for ctf_hash_lookup_type/ctf_hash_insert_type: if the key is already
-   in the hash, override the previous definition with this new official
-   definition.  If the key is not present, then call ctf_hash_insert_type() and
-   hash it in.  */
+   in the hash, keep the existing definition.  If the key is not present, then
+   call ctf_hash_insert_type() and hash it in.  */
 int
 ctf_hash_define_type (ctf_hash_t *hp, ctf_file_t *fp, uint32_t type,
 		 uint32_t name)
@@ -297,42 +325,138 @@ ctf_hash_define_type (ctf_hash_t *hp, ctf_file_t *fp, uint32_t type,
 ctf_id_t
 ctf_hash_lookup_type (ctf_hash_t *hp, ctf_file_t *fp, const char *key)
 {
-  ctf_helem_t *hep;
-  ctf_strs_t *ctsp;
-  const char *str;
-  size_t i;
-  size_t j = 0;
+  return ctf_hash_probe (hp, fp, key, ctf_idx_hash (key))->h_type;
+}
+
+/* Like ctf_hash_lookup_type(), but the key is the first LEN characters of KEY,
+   which need not be NUL-terminated.  */
 
-  uint32_t h = ctf_hash_string (key) % hp->h_nbuckets;
+ctf_id_t
+ctf_hash_lookup_type_n (ctf_hash_t *hp, ctf_file_t *fp, const char *key,
+			size_t len)
+{
+  uint32_t h = ctf_idx_hash_n (key, len);
+  uint32_t mask = hp->h_nslots - 1;
+  uint32_t i;
 
-  for (i = hp->h_buckets[h]; i != 0; i = hep->h_next, j++)
+  for (i = h & mask;; i = (i + 1) & mask)
     {
-      hep = &hp->h_chains[i];
-      ctsp = &fp->ctf_str[CTF_NAME_STID (hep->h_name)];
-      str = ctsp->cts_strs + CTF_NAME_OFFSET (hep->h_name);
-      if (strcmp (key, str) == 0)
+      const ctf_helem_t *hep = &hp->h_slots[i];
+      const char *name;
+
+      if (hep->h_type == 0)
+	return 0;
+
+      if (hep->h_hash != h)
+	continue;
+
+      name = ctf_hash_name (fp, hep->h_name);
+      if (strncmp (key, name, len) == 0 && name[len] == '\0')
 	return hep->h_type;
     }
+}
 
-  return 0; 		/* Sentinel value.  */
+/* Return the number of bytes needed to write HP out as an index hash table, or
+   0 if it cannot be written out because it refers to names in the external
+   string table.  */
+
+size_t
+ctf_hash_index_size (const ctf_hash_t *hp)
+{
+  uint32_t i;
+
+  for (i = 0; i < hp->h_nslots; i++)
+    if (hp->h_slots[i].h_type != 0
+	&& CTF_NAME_STID (hp->h_slots[i].h_name) != CTF_STRTAB_0)
+      return 0;
+
+  return sizeof (ctf_idx_hash_t) + hp->h_nslots * sizeof (ctf_helem_t);
 }
 
+/* Write HP out as an index hash table at BUF, which must have room for
+   ctf_hash_index_size() bytes.  */
+
 void
-ctf_hash_destroy (ctf_hash_t *hp)
+ctf_hash_index_write (const ctf_hash_t *hp, unsigned char *buf)
 {
-  if (hp == NULL)
-    return;
+  ctf_idx_hash_t *ih = (ctf_idx_hash_t *) buf;
+
+  ih->ctih_nslots = hp->h_nslots;
+  ih->ctih_nelems = hp->h_count;
+  memcpy (buf + sizeof (ctf_idx_hash_t), hp->h_slots,
+	  hp->h_nslots * sizeof (ctf_helem_t));
+}
+
+/* Return a hash using the index hash table of at most LEN bytes at BUF in
+   place, or NULL (setting *ERRP) if it is damaged.  *SIZEP is set to the number
+   of bytes it occupies.  */
 
-  if (hp->h_buckets != NULL && hp->h_nbuckets != 1)
+ctf_hash_t *
+ctf_hash_index_open (ctf_file_t *fp, const unsigned char *buf, size_t len,
+		     size_t *sizep, int *errp)
+{
+  const ctf_idx_hash_t *ih = (const ctf_idx_hash_t *) buf;
+  ctf_hash_t *hp;
+  size_t size;
+  uint32_t i, count = 0;
+
+  *errp = ECTF_CORRUPT;
+  if (len < sizeof (ctf_idx_hash_t) || ih->ctih_nslots == 0
+      || (ih->ctih_nslots & (ih->ctih_nslots - 1)) != 0
+      || ih->ctih_nelems >= ih->ctih_nslots)
+    return NULL;
+
+  size = sizeof (ctf_idx_hash_t)
+    + (size_t) ih->ctih_nslots * sizeof (ctf_helem_t);
+  if (size > len)
+    return NULL;
+
+  if ((hp = malloc (sizeof (ctf_hash_t))) == NULL)
     {
-      free (hp->h_buckets);
-      hp->h_buckets = NULL;
+      *errp = ENOMEM;
+      return NULL;
     }
 
-  if (hp->h_chains != NULL)
+  hp->h_nslots = ih->ctih_nslots;
+  hp->h_nelems = ih->ctih_nelems;
+  hp->h_count = ih->ctih_nelems;
+  hp->h_borrowed = 1;
+  hp->h_slots = (ctf_helem_t *) (buf + sizeof (ctf_idx_hash_t));
+
+  /* Make sure that no name is outside the internal string table, and that
+     there are as many empty slots as claimed, so that every probe ends.  */
+
+  for (i = 0; i < hp->h_nslots; i++)
     {
-      free (hp->h_chains);
-      hp->h_chains = NULL;
+      const ctf_helem_t *hep = &hp->h_slots[i];
+
+      if (hep->h_type == 0)
+	continue;
+
+      if (CTF_NAME_STID (hep->h_name) != CTF_STRTAB_0
+	  || CTF_NAME_OFFSET (hep->h_name) >= fp->ctf_str[CTF_STRTAB_0].cts_len)
+	goto corrupt;
+      count++;
     }
+
+  if (count != hp->h_count)
+    goto corrupt;
+
+  *sizep = size;
+  return hp;
+
+ corrupt:
+  free (hp);
+  return NULL;
+}
+
+void
+ctf_hash_destroy (ctf_hash_t *hp)
+{
+  if (hp == NULL)
+    return;
+
+  if (!hp->h_borrowed && hp->h_slots != _CTF_EMPTY_SLOT)
+    free (hp->h_slots);
   free (hp);
 }
@@ -15,6 +15,7 @@
 #include <sys/param.h>
 #include "ctf-decls.h"
 #include <sys/ctf-api.h>
+#include <sys/ctf-view.h>
 #include <sys/types.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -22,6 +23,7 @@
 #include <stdint.h>
 #include <limits.h>
 #include <ctype.h>
+#include <pthread.h>
 #include <elf.h>
 #include <bfd.h>
 
@@ -62,6 +64,35 @@ extern "C"
 
 typedef struct ctf_fixed_hash ctf_hash_t; /* Private to ctf-hash.c.  */
 typedef struct ctf_dynhash ctf_dynhash_t; /* Private to ctf-hash.c.  */
+typedef struct ctf_enumeridx ctf_enumeridx_t; /* Private to ctf-lookup.c.  */
+typedef struct ctf_ncache ctf_ncache_t; /* Private to ctf-lookup.c.  */
+typedef struct ctf_symidx ctf_symidx_t; /* Private to ctf-lookup.c.  */
+typedef struct ctf_addridx ctf_addridx_t; /* Private to ctf-lookup.c.  */
+typedef struct ctf_funcrefidx ctf_funcrefidx_t; /* Private to ctf-lookup.c.  */
+typedef struct ctf_kindidx ctf_kindidx_t; /* Private to ctf-types.c.  */
+
+/* The pointers in a child container to types in its parent, indexed by parent
+   type index: the child's counterpart of the parent's ctf_ptrtab, which cannot
+   record them.  Built on first use by ctf_lookup_by_name().  */
+
+typedef struct ctf_pptrtab
+{
+  uint32_t cpp_len;		/* Number of entries.  */
+  uint32_t cpp_ptrs[1];		/* Child pointer type indexes, or 0.  */
+} ctf_pptrtab_t;
+
+/* A packed, fixed-size descriptor of one type in a read-only container,
+   indexed by type index like ctf_txlate, so that the commonest queries need
+   neither a walk from ctf_buf through ctf_txlate nor the ctf_fileops
+   indirections to decode the ctf_type_t found there.  Built once all the types
+   are known, by init_tdescs(), and exported through the ctf_view_t.  */
+
+typedef ctf_view_type_t ctf_tdesc_t;
+
+#define LCTF_TDESC_KIND(td)	CTF_V2_INFO_KIND ((td)->ctvt_info)
+#define LCTF_TDESC_VLEN(td)	CTF_V2_INFO_VLEN ((td)->ctvt_info)
+#define LCTF_TDESC_VDATA(fp, td) \
+  ((const void *) ((fp)->ctf_buf + (td)->ctvt_vdata))
 
 typedef struct ctf_strs
 {
@@ -90,6 +121,7 @@ typedef struct ctf_names
 {
   ctf_hash_t *ctn_readonly;	/* Hash table when readonly.  */
   ctf_dynhash_t *ctn_writable;	/* Hash table when writable.  */
+  uint32_t ctn_nelems;		/* Size of ctn_readonly, if built lazily.  */
 } ctf_names_t;
 
 typedef struct ctf_lookup
@@ -132,15 +164,22 @@ typedef struct ctf_decl_node
   uint32_t cd_n;		/* Type dimension if array.  */
 } ctf_decl_node_t;
 
+/* Declarations deeper than this many nodes allocate the rest.  */
+
+#define CTF_DECL_NPOOL 32
+
 typedef struct ctf_decl
 {
   ctf_list_t cd_nodes[CTF_PREC_MAX]; /* Declaration node stacks.  */
   int cd_order[CTF_PREC_MAX];	     /* Storage order of decls.  */
   ctf_decl_prec_t cd_qualp;	     /* Qualifier precision.  */
   ctf_decl_prec_t cd_ordp;	     /* Ordered precision.  */
-  char *cd_buf;			     /* Buffer for output.  */
+  size_t cd_npool;		     /* Nodes used in cd_pool.  */
+  ctf_decl_node_t cd_pool[CTF_DECL_NPOOL]; /* Preallocated nodes.  */
+  char *cd_buf;			     /* Caller's buffer for output.  */
+  size_t cd_len;		     /* Size of cd_buf.  */
+  size_t cd_pos;		     /* Length of output, even if truncated.  */
   int cd_err;			     /* Saved error value.  */
-  int cd_enomem;		     /* Nonzero if OOM during printing.  */
 } ctf_decl_t;
 
 typedef struct ctf_dmdef
@@ -202,6 +241,32 @@ typedef struct ctf_str_atom
 
 /* The refs of a single string in the atoms table.  */
 
+/* Information about a type derived from the type graph, cached on first use by
+   the functions that compute it.  Zero means "not yet computed": sizes and
+   alignments are stored plus one.  Entries are loaded and stored atomically,
+   since read-only containers may be used by several threads at once.
+
+   In writable containers, sizes and alignments can change as members are
+   added.  A type whose size or alignment has been used to compute that of
+   another type is marked CTC_DEPENDED: if it changes, all cached sizes and
+   alignments in the container are thrown away, and ctf_tcache_gen is given a
+   new value so that child containers throw theirs away too.  Generations are
+   drawn from a counter shared by all containers, so that no two containers
+   ever have the same one, even if one is allocated where another was freed.  */
+
+typedef struct ctf_tcache
+{
+  uint32_t ctc_resolved;	/* Result of ctf_type_resolve().  */
+  uint32_t ctc_unsliced;	/* Result of ctf_type_resolve_unsliced().  */
+  uint32_t ctc_flags;		/* CTC_* flags.  */
+  ssize_t ctc_size;		/* Result of ctf_type_size(), plus one.  */
+  ssize_t ctc_align;		/* Result of ctf_type_align(), plus one.  */
+  void *ctc_index;		/* Member or enumerator index, if built.  */
+  char *ctc_name;		/* Result of ctf_type_aname(), if cached.  */
+} ctf_tcache_t;
+
+#define CTC_DEPENDED	0x1	/* Other cached sizes depend on this one.  */
+
 typedef struct ctf_str_atom_ref
 {
   ctf_list_t caf_list;		/* List forward/back pointers.  */
@@ -219,6 +284,11 @@ typedef struct ctf_link_type_mapping_key
   ctf_id_t cltm_idx;
 } ctf_link_type_mapping_key_t;
 
+/* The number of string table offsets of the symbol names _START_ and _END_
+   that can be recorded for the symtab translation table (see ctf-open.c).  */
+
+#define CTF_SXLATE_NSENTINELS 8
+
 /* The ctf_file is the structure used to represent a CTF container to library
    clients, who see it only as an opaque pointer.  Modifications can therefore
    be made freely to this structure without regard to client versioning.  The
@@ -258,11 +328,22 @@ struct ctf_file
   size_t ctf_size;		  /* Size of CTF header + uncompressed data.  */
   uint32_t *ctf_sxlate;		  /* Translation table for symtab entries.  */
   unsigned long ctf_nsyms;	  /* Number of entries in symtab xlate table.  */
+  unsigned long ctf_sxlate_done;  /* Number of ctf_sxlate entries filled in.  */
+  uint32_t ctf_sxlate_objtoff;	  /* Objt offset of next ctf_sxlate entry.  */
+  uint32_t ctf_sxlate_funcoff;	  /* Func offset of next ctf_sxlate entry.  */
+  int ctf_sxlate_nsentinels;	  /* Entries in ctf_sxlate_sentinels, or -1.  */
+  uint32_t ctf_sxlate_sentinels[CTF_SXLATE_NSENTINELS]; /* _START_/_END_.  */
+  ctf_symidx_t *ctf_symnames;	  /* Symbol name index, if built.  */
+  ctf_addridx_t *ctf_addrs;	  /* Symbol address index, if built.  */
+  ctf_funcrefidx_t *ctf_funcrefs; /* Function reference index, if built.  */
   uint32_t *ctf_txlate;		  /* Translation table for type IDs.  */
+  ctf_tdesc_t *ctf_tdescs;	  /* Packed type descriptors, if built.  */
+  ctf_view_t ctf_view;		  /* View exported by ctf_view().  */
   uint32_t *ctf_ptrtab;		  /* Translation table for pointer-to lookups.  */
   size_t ctf_ptrtab_len;	  /* Num types storable in ptrtab currently.  */
   struct ctf_varent *ctf_vars;	  /* Sorted variable->type mapping.  */
   unsigned long ctf_nvars;	  /* Number of variables in ctf_vars.  */
+  ctf_hash_t *ctf_varhash;	  /* Hash of ctf_vars, if built.  */
   unsigned long ctf_typemax;	  /* Maximum valid type ID number.  */
   const ctf_dmodel_t *ctf_dmodel; /* Data model pointer (see above).  */
   const char *ctf_cuname;	  /* Compilation unit name (if any).  */
@@ -276,7 +357,8 @@ struct ctf_file
   uint32_t ctf_flags;		  /* Libctf flags (see below).  */
   int ctf_errno;		  /* Error code for most recent error.  */
   int ctf_version;		  /* CTF data version.  */
-  ctf_dynhash_t *ctf_dthash;	  /* Hash of dynamic type definitions.  */
+  ctf_dtdef_t **ctf_dtvec;	  /* Dynamic type definitions, by index.  */
+  size_t ctf_dtvec_len;		  /* Number of entries in ctf_dtvec.  */
   ctf_list_t ctf_dtdefs;	  /* List of dynamic type definitions.  */
   ctf_dynhash_t *ctf_dvhash;	  /* Hash of dynamic variable mappings.  */
   ctf_list_t ctf_dvdefs;	  /* List of dynamic variable definitions.  */
@@ -292,9 +374,19 @@ struct ctf_file
   ctf_link_memb_name_changer_f *ctf_link_memb_name_changer;
   void *ctf_link_memb_name_changer_arg; /* Argument for it.  */
   ctf_dynhash_t *ctf_add_processing; /* Types ctf_add_type is working on now.  */
-  char *ctf_tmp_typeslice;	  /* Storage for slicing up type names.  */
-  size_t ctf_tmp_typeslicelen;	  /* Size of the typeslice.  */
   void *ctf_specific;		  /* Data for ctf_get/setspecific().  */
+  uint32_t ctf_lazy;		  /* Indexes not yet built (LCTF_LAZY_*).  */
+  int ctf_lazy_err;		  /* Error from a failed lazy build, if any.  */
+  ctf_tcache_t *ctf_tcache;	  /* Per-type cache of derived information.  */
+  size_t ctf_tcache_len;	  /* Number of entries in ctf_tcache.  */
+  uint32_t ctf_tcache_gen;	  /* Renewed when cached sizes are discarded.  */
+  uint32_t ctf_tcache_pgen;	  /* Parent's ctf_tcache_gen when last checked.  */
+  ctf_enumeridx_t *ctf_enumerators; /* Enumerator name index, if built.  */
+  ctf_ncache_t *ctf_ncache;	  /* ctf_lookup_by_name() cache, if any.  */
+  ctf_pptrtab_t *ctf_pptrtab;	  /* Pointers to parent types, if built.  */
+  ctf_kindidx_t *ctf_kinds;	  /* Type indexes by kind, if built.  */
+  pthread_mutex_t ctf_lazy_lock;  /* Serializes lazy index construction.  */
+  pthread_mutex_t ctf_sxlate_lock; /* Serializes filling in ctf_sxlate.  */
 };
 
 /* An abstraction over both a ctf_file_t and a ctf_archive_t.  */
@@ -330,34 +422,202 @@ struct ctf_archive_internal
 #define LCTF_INDEX_TO_TYPE(fp, id, child) (child ? ((id) | (fp->ctf_parmax+1)) : \
 					   (id))
 
+/* In writable containers, every slot of the ctf_dtvec from 1 to ctf_typemax
+   is filled: types are only ever removed from the top, by ctf_rollback(),
+   which lowers ctf_typemax to match, and ctf_add_generic() gives back the type
+   ID of any type it fails to add.  So anything iterating over all type indexes
+   may use this macro on each without checking for NULL.  */
+
 #define LCTF_INDEX_TO_TYPEPTR(fp, i) \
     ((fp->ctf_flags & LCTF_RDWR) ?					\
-     &(ctf_dtd_lookup (fp, LCTF_INDEX_TO_TYPE				\
-		       (fp, i, fp->ctf_flags & LCTF_CHILD))->dtd_data) : \
+     &((fp)->ctf_dtvec[(i)]->dtd_data) :				\
      (ctf_type_t *)((uintptr_t)(fp)->ctf_buf + (fp)->ctf_txlate[(i)]))
 
-#define LCTF_INFO_KIND(fp, info)	((fp)->ctf_fileops->ctfo_get_kind(info))
-#define LCTF_INFO_ISROOT(fp, info)	((fp)->ctf_fileops->ctfo_get_root(info))
-#define LCTF_INFO_VLEN(fp, info)	((fp)->ctf_fileops->ctfo_get_vlen(info))
+/* Every container is in the CTF_VERSION_2 encoding of type info and sizes
+   (which CTF_VERSION_3 shares) except for CTF_VERSION_1 containers in the
+   middle of being upgraded at open time: so decode that encoding inline, and
+   go through the ctf_fileops only for the rest.  */
+
+#define LCTF_NATIVE(fp) (!_libctf_unlikely_ ((fp)->ctf_version == CTF_VERSION_1))
+
+static inline uint32_t
+ctf_info_kind (const ctf_file_t *fp, uint32_t info)
+{
+  if (LCTF_NATIVE (fp))
+    return (CTF_V2_INFO_KIND (info));
+  return (fp->ctf_fileops->ctfo_get_kind (info));
+}
+
+static inline uint32_t
+ctf_info_isroot (const ctf_file_t *fp, uint32_t info)
+{
+  if (LCTF_NATIVE (fp))
+    return (CTF_V2_INFO_ISROOT (info));
+  return (fp->ctf_fileops->ctfo_get_root (info));
+}
+
+static inline uint32_t
+ctf_info_vlen (const ctf_file_t *fp, uint32_t info)
+{
+  if (LCTF_NATIVE (fp))
+    return (CTF_V2_INFO_VLEN (info));
+  return (fp->ctf_fileops->ctfo_get_vlen (info));
+}
+
+/* The native case of get_vbytes_v2(): invalid kinds are left to it, to
+   diagnose.  */
+
+static inline ssize_t
+ctf_get_vbytes (const ctf_file_t *fp, unsigned short kind, ssize_t size,
+		size_t vlen)
+{
+  if (LCTF_NATIVE (fp))
+    switch (kind)
+      {
+      case CTF_K_INTEGER:
+      case CTF_K_FLOAT:
+	return (sizeof (uint32_t));
+      case CTF_K_ARRAY:
+	return (sizeof (ctf_array_t));
+      case CTF_K_FUNCTION:
+	return (sizeof (uint32_t) * (vlen + (vlen & 1)));
+      case CTF_K_STRUCT:
+      case CTF_K_UNION:
+	if (size < CTF_LSTRUCT_THRESH)
+	  return (sizeof (ctf_member_t) * vlen);
+	else
+	  return (sizeof (ctf_lmember_t) * vlen);
+      case CTF_K_ENUM:
+	return (sizeof (ctf_enum_t) * vlen);
+      case CTF_K_SLICE:
+	return (sizeof (ctf_slice_t));
+      case CTF_K_FORWARD:
+      case CTF_K_UNKNOWN:
+      case CTF_K_POINTER:
+      case CTF_K_TYPEDEF:
+      case CTF_K_VOLATILE:
+      case CTF_K_CONST:
+      case CTF_K_RESTRICT:
+	return 0;
+      }
+  return (fp->ctf_fileops->ctfo_get_vbytes (kind, size, vlen));
+}
+
+#define LCTF_INFO_KIND(fp, info)	ctf_info_kind ((fp), (info))
+#define LCTF_INFO_ISROOT(fp, info)	ctf_info_isroot ((fp), (info))
+#define LCTF_INFO_VLEN(fp, info)	ctf_info_vlen ((fp), (info))
 #define LCTF_VBYTES(fp, kind, size, vlen) \
-  ((fp)->ctf_fileops->ctfo_get_vbytes(kind, size, vlen))
+  ctf_get_vbytes ((fp), (kind), (size), (vlen))
 
 static inline ssize_t ctf_get_ctt_size (const ctf_file_t *fp,
 					const ctf_type_t *tp,
 					ssize_t *sizep,
 					ssize_t *incrementp)
 {
-  return (fp->ctf_fileops->ctfo_get_ctt_size (fp, tp, sizep, incrementp));
+  ssize_t size, increment;
+
+  if (!LCTF_NATIVE (fp))
+    return (fp->ctf_fileops->ctfo_get_ctt_size (fp, tp, sizep, incrementp));
+
+  if (tp->ctt_size == CTF_LSIZE_SENT)
+    {
+      size = CTF_TYPE_LSIZE (tp);
+      increment = sizeof (ctf_type_t);
+    }
+  else
+    {
+      size = tp->ctt_size;
+      increment = sizeof (ctf_stype_t);
+    }
+
+  if (sizep)
+    *sizep = size;
+  if (incrementp)
+    *incrementp = increment;
+
+  return size;
 }
 
 #define LCTF_CHILD	0x0001	/* CTF container is a child */
 #define LCTF_RDWR	0x0002	/* CTF container is writable */
 #define LCTF_DIRTY	0x0004	/* CTF container has been modified */
+#define LCTF_LAZY	0x0008	/* CTF container builds indexes on demand */
+#define LCTF_INDEXED	0x0010	/* Type indexes are in the CTF index section */
+#define LCTF_NAMECACHE	0x0020	/* Formatted type names are cached */
+
+/* Readonly indexes which may be built on demand (see ctf_setlazy()).  The
+   type-offset table must be built before any of the others.  */
+
+#define LCTF_LAZY_TYPES		0x0001	/* ctf_txlate and ctf_typemax.  */
+#define LCTF_LAZY_PTRTAB	0x0002	/* ctf_ptrtab.  */
+#define LCTF_LAZY_STRUCTS	0x0004	/* ctf_structs.  */
+#define LCTF_LAZY_UNIONS	0x0008	/* ctf_unions.  */
+#define LCTF_LAZY_ENUMS		0x0010	/* ctf_enums.  */
+#define LCTF_LAZY_NAMES		0x0020	/* ctf_names.  */
+#define LCTF_LAZY_ALL		0x003f
+
+extern int ctf_lazy_build (ctf_file_t *, uint32_t);
+
+/* Make sure that the indexes in WHICH have been built, building them if need
+   be.  Returns 0 on success, or a CTF error code, also set on FP.  Indexes are
+   never discarded once built, so the fast path is a single load.  */
+
+static inline int
+ctf_lazy_need (ctf_file_t *fp, uint32_t which)
+{
+  if (_libctf_unlikely_ (__atomic_load_n (&fp->ctf_lazy, __ATOMIC_ACQUIRE)
+			 & which))
+    return ctf_lazy_build (fp, which);
+  return 0;
+}
+
+extern void ctf_sxlate_build (ctf_file_t *, unsigned long);
+
+/* Make sure that the symtab translation table has been filled in at least as
+   far as entry SYMIDX, which must be in range.  */
+
+static inline void
+ctf_sxlate_need (ctf_file_t *fp, unsigned long symidx)
+{
+  if (_libctf_unlikely_ (symidx >= __atomic_load_n (&fp->ctf_sxlate_done,
+						    __ATOMIC_ACQUIRE)))
+    ctf_sxlate_build (fp, symidx);
+}
 
 extern ctf_names_t *ctf_name_table (ctf_file_t *, int);
 extern const ctf_type_t *ctf_lookup_by_id (ctf_file_t **, ctf_id_t);
+
+/* Return the packed descriptor of the given type, switching *FPP to the
+   container it is in, or NULL if there is none, either because the container
+   is writable, has not got its types yet, or the type is invalid: callers then
+   fall back to ctf_lookup_by_id(), which sets the appropriate error.  */
+
+static inline const ctf_tdesc_t *
+ctf_lookup_tdesc (ctf_file_t **fpp, ctf_id_t type)
+{
+  ctf_file_t *fp = *fpp;
+  const ctf_tdesc_t *tds;
+  ctf_id_t idx;
+
+  if ((fp->ctf_flags & LCTF_CHILD) && LCTF_TYPE_ISPARENT (fp, type)
+      && (fp = fp->ctf_parent) == NULL)
+    return NULL;
+
+  if ((fp->ctf_flags & LCTF_RDWR)
+      || (tds = __atomic_load_n (&fp->ctf_tdescs, __ATOMIC_ACQUIRE)) == NULL)
+    return NULL;
+
+  idx = LCTF_TYPE_TO_INDEX (fp, type);
+  if (idx <= 0 || (unsigned long) idx > fp->ctf_typemax)
+    return NULL;
+
+  *fpp = fp;
+  return &tds[idx];
+}
 extern ctf_id_t ctf_lookup_by_rawname (ctf_file_t *, int, const char *);
 extern ctf_id_t ctf_lookup_by_rawhash (ctf_file_t *, ctf_names_t *, const char *);
+extern ctf_id_t ctf_lookup_by_rawhash_n (ctf_file_t *, ctf_names_t *,
+					 const char *, size_t);
 extern void ctf_set_ctl_hashes (ctf_file_t *);
 
 typedef unsigned int (*ctf_hash_fun) (const void *ptr);
@@ -379,7 +639,13 @@ extern ctf_hash_t *ctf_hash_create (unsigned long, ctf_hash_fun, ctf_hash_eq_fun
 extern int ctf_hash_insert_type (ctf_hash_t *, ctf_file_t *, uint32_t, uint32_t);
 extern int ctf_hash_define_type (ctf_hash_t *, ctf_file_t *, uint32_t, uint32_t);
 extern ctf_id_t ctf_hash_lookup_type (ctf_hash_t *, ctf_file_t *, const char *);
+extern ctf_id_t ctf_hash_lookup_type_n (ctf_hash_t *, ctf_file_t *,
+					const char *, size_t);
 extern uint32_t ctf_hash_size (const ctf_hash_t *);
+extern size_t ctf_hash_index_size (const ctf_hash_t *);
+extern void ctf_hash_index_write (const ctf_hash_t *, unsigned char *);
+extern ctf_hash_t *ctf_hash_index_open (ctf_file_t *, const unsigned char *,
+					size_t, size_t *, int *);
 extern void ctf_hash_destroy (ctf_hash_t *);
 
 extern ctf_dynhash_t *ctf_dynhash_create (ctf_hash_fun, ctf_hash_eq_fun,
@@ -406,6 +672,12 @@ extern void ctf_dtd_delete (ctf_file_t *, ctf_dtdef_t *);
 extern ctf_dtdef_t *ctf_dtd_lookup (const ctf_file_t *, ctf_id_t);
 extern ctf_dtdef_t *ctf_dynamic_type (const ctf_file_t *, ctf_id_t);
 
+extern ctf_tcache_t *ctf_tcache_entry (ctf_file_t *, ctf_id_t);
+extern void ctf_tcache_clear (ctf_file_t *);
+extern void ctf_tcache_clear_sizes (ctf_file_t *);
+extern void ctf_tcache_newgen (ctf_file_t *);
+extern void ctf_tcache_invalidate (ctf_file_t *, ctf_id_t);
+extern void ctf_kinds_invalidate (ctf_file_t *);
 extern int ctf_dvd_insert (ctf_file_t *, ctf_dvdef_t *);
 extern void ctf_dvd_delete (ctf_file_t *, ctf_dvdef_t *);
 extern ctf_dvdef_t *ctf_dvd_lookup (const ctf_file_t *, const char *);
@@ -415,13 +687,13 @@ extern void ctf_add_type_mapping (ctf_file_t *src_fp, ctf_id_t src_type,
 extern ctf_id_t ctf_type_mapping (ctf_file_t *src_fp, ctf_id_t src_type,
 				  ctf_file_t **dst_fp);
 
-extern void ctf_decl_init (ctf_decl_t *);
+extern void ctf_decl_init (ctf_decl_t *, char *, size_t);
 extern void ctf_decl_fini (ctf_decl_t *);
 extern void ctf_decl_push (ctf_decl_t *, ctf_file_t *, ctf_id_t);
 
 _libctf_printflike_ (2, 3)
 extern void ctf_decl_sprintf (ctf_decl_t *, const char *, ...);
-extern char *ctf_decl_buf (ctf_decl_t *cd);
+extern size_t ctf_decl_len (ctf_decl_t *cd);
 
 extern const char *ctf_strptr (ctf_file_t *, uint32_t);
 extern const char *ctf_strraw (ctf_file_t *, uint32_t);
@@ -482,6 +754,7 @@ extern const char _CTF_NULLSTR[];	/* empty string */
 
 extern int _libctf_version;	/* library client version */
 extern int _libctf_debug;	/* debugging messages enabled */
+extern int _libctf_lazy;	/* readonly indexes built on demand */
 
 #ifdef	__cplusplus
 }
@@ -49,27 +49,38 @@ isqualifier (const char *s, size_t len)
 	  strncmp (qp->q_name, s, qp->q_len) == 0);
 }
 
-/* Attempt to convert the given C type name into the corresponding CTF type ID.
-   It is not possible to do complete and proper conversion of type names
-   without implementing a more full-fledged parser, which is necessary to
-   handle things like types that are function pointers to functions that
-   have arguments that are function pointers, and fun stuff like that.
-   Instead, this function implements a very simple conversion algorithm that
-   finds the things that we actually care about: structs, unions, enums,
-   integers, floats, typedefs, and pointers to any of these named types.  */
+/* A C type name parsed by ctf_lookup_parse_name(): a raw name, to be looked up
+   in one of the ctf_lookups tables, and the number of pointers to it.  */
 
-ctf_id_t
-ctf_lookup_by_name (ctf_file_t *fp, const char *name)
+typedef struct ctf_lookup_name
+{
+  int cln_table;		/* Index into ctf_lookups.  */
+  const char *cln_name;		/* Raw name: not NUL-terminated.  */
+  size_t cln_len;		/* Length of raw name.  */
+  unsigned int cln_nptrs;	/* Number of pointers to it.  */
+} ctf_lookup_name_t;
+
+/* Parse the given C type name into LN, without modifying or copying it.  It is
+   not possible to do complete and proper conversion of type names without
+   implementing a more full-fledged parser, which is necessary to handle things
+   like types that are function pointers to functions that have arguments that
+   are function pointers, and fun stuff like that.  Instead, we implement a very
+   simple parser that finds the things that we actually care about: structs,
+   unions, enums, integers, floats, typedefs, and pointers to any of these named
+   types, ignoring qualifiers.  */
+
+static int
+ctf_lookup_parse_name (ctf_file_t *fp, const char *name, ctf_lookup_name_t *ln)
 {
   static const char delimiters[] = " \t\n\r\v\f*";
 
   const ctf_lookup_t *lp;
   const char *p, *q, *end;
-  ctf_id_t type = 0;
-  ctf_id_t ntype, ptype;
 
-  if (name == NULL)
-    return (ctf_set_errno (fp, EINVAL));
+  ln->cln_table = 0;
+  ln->cln_name = NULL;
+  ln->cln_len = 0;
+  ln->cln_nptrs = 0;
 
   for (p = name, end = name + strlen (name); *p != '\0'; p = q)
     {
@@ -84,31 +95,10 @@ ctf_lookup_by_name (ctf_file_t *fp, const char *name)
 
       if (*p == '*')
 	{
-	  /* Find a pointer to type by looking in fp->ctf_ptrtab.
-	     If we can't find a pointer to the given type, see if
-	     we can compute a pointer to the type resulting from
-	     resolving the type down to its base type and use
-	     that instead.  This helps with cases where the CTF
-	     data includes "struct foo *" but not "foo_t *" and
-	     the user tries to access "foo_t *" in the debugger.
-
-	     TODO need to handle parent containers too.  */
-
-	  ntype = fp->ctf_ptrtab[LCTF_TYPE_TO_INDEX (fp, type)];
-	  if (ntype == 0)
-	    {
-	      ntype = ctf_type_resolve_unsliced (fp, type);
-	      if (ntype == CTF_ERR
-		  || (ntype =
-		      fp->ctf_ptrtab[LCTF_TYPE_TO_INDEX (fp, ntype)]) == 0)
-		{
-		  (void) ctf_set_errno (fp, ECTF_NOTYPE);
-		  goto err;
-		}
-	    }
-
-	  type = LCTF_INDEX_TO_TYPE (fp, ntype, (fp->ctf_flags & LCTF_CHILD));
+	  if (ln->cln_name == NULL)
+	    return (ctf_set_errno (fp, ECTF_SYNTAX));
 
+	  ln->cln_nptrs++;
 	  q = p + 1;
 	  continue;
 	}
@@ -116,9 +106,11 @@ ctf_lookup_by_name (ctf_file_t *fp, const char *name)
       if (isqualifier (p, (size_t) (q - p)))
 	continue;		/* Skip qualifier keyword.  */
 
+      if (ln->cln_name != NULL)
+	return (ctf_set_errno (fp, ECTF_SYNTAX));
+
       for (lp = fp->ctf_lookups; lp->ctl_prefix != NULL; lp++)
 	{
-	  /* TODO: This is not MT-safe.  */
 	  if ((lp->ctl_prefix[0] == '\0' ||
 	       strncmp (p, lp->ctl_prefix, (size_t) (q - p)) == 0) &&
 	      (size_t) (q - p) >= lp->ctl_len)
@@ -129,294 +121,1685 @@ ctf_lookup_by_name (ctf_file_t *fp, const char *name)
 	      if ((q = strchr (p, '*')) == NULL)
 		q = end;	/* Compare until end.  */
 
-	      while (isspace (q[-1]))
+	      while (q > p && isspace (q[-1]))
 		q--;		/* Exclude trailing whitespace.  */
 
-	      /* Expand and/or allocate storage for a slice of the name, then
-		 copy it in.  */
-
-	      if (fp->ctf_tmp_typeslicelen >= (size_t) (q - p) + 1)
-		{
-		  memcpy (fp->ctf_tmp_typeslice, p, (size_t) (q - p));
-		  fp->ctf_tmp_typeslice[(size_t) (q - p)] = '\0';
-		}
-	      else
-		{
-		  free (fp->ctf_tmp_typeslice);
-		  fp->ctf_tmp_typeslice = xstrndup (p, (size_t) (q - p));
-		  if (fp->ctf_tmp_typeslice == NULL)
-		    {
-		      (void) ctf_set_errno (fp, ENOMEM);
-		      return CTF_ERR;
-		    }
-		}
-
-	      if ((type = ctf_lookup_by_rawhash (fp, lp->ctl_hash,
-						 fp->ctf_tmp_typeslice)) == 0)
-		{
-		  (void) ctf_set_errno (fp, ECTF_NOTYPE);
-		  goto err;
-		}
-
+	      ln->cln_table = lp - fp->ctf_lookups;
+	      ln->cln_name = p;
+	      ln->cln_len = (size_t) (q - p);
 	      break;
 	    }
 	}
 
       if (lp->ctl_prefix == NULL)
-	{
-	  (void) ctf_set_errno (fp, ECTF_NOTYPE);
-	  goto err;
-	}
+	return (ctf_set_errno (fp, ECTF_NOTYPE));
     }
 
-  if (*p != '\0' || type == 0)
+  if (*p != '\0' || ln->cln_name == NULL)
     return (ctf_set_errno (fp, ECTF_SYNTAX));
 
-  return type;
-
-err:
-  if (fp->ctf_parent != NULL
-      && (ptype = ctf_lookup_by_name (fp->ctf_parent, name)) != CTF_ERR)
-    return ptype;
-
-  return CTF_ERR;
+  return 0;
 }
 
-typedef struct ctf_lookup_var_key
-{
-  ctf_file_t *clvk_fp;
-  const char *clvk_name;
-} ctf_lookup_var_key_t;
-
-/* A bsearch function for variable names.  */
+/* If the type at TP in the child container FP is a pointer to a parent type,
+   return 1 and set *TARGET to the index of that type.  A pointer to an
+   anonymous typedef in the child of a parent type counts as a pointer to that
+   type.  */
 
 static int
-ctf_lookup_var (const void *key_, const void *memb_)
+ctf_pptr_targets (ctf_file_t *fp, const ctf_type_t *tp, uint32_t *target)
 {
-  const ctf_lookup_var_key_t *key = key_;
-  const ctf_varent_t *memb = memb_;
+  uint32_t ref = tp->ctt_type;
 
-  return (strcmp (key->clvk_name, ctf_strptr (key->clvk_fp, memb->ctv_name)));
+  if (LCTF_INFO_KIND (fp, tp->ctt_info) != CTF_K_POINTER)
+    return 0;
+
+  if (LCTF_TYPE_ISCHILD (fp, ref))
+    {
+      if (LCTF_TYPE_TO_INDEX (fp, ref) > fp->ctf_typemax)
+	return 0;
+
+      tp = LCTF_INDEX_TO_TYPEPTR (fp, LCTF_TYPE_TO_INDEX (fp, ref));
+      if (LCTF_INFO_KIND (fp, tp->ctt_info) != CTF_K_TYPEDEF
+	  || strcmp (ctf_strptr (fp, tp->ctt_name), "") != 0
+	  || LCTF_TYPE_ISCHILD (fp, tp->ctt_type))
+	return 0;
+      ref = tp->ctt_type;
+    }
+
+  *target = LCTF_TYPE_TO_INDEX (fp, ref);
+  return 1;
 }
 
-/* Given a variable name, return the type of the variable with that name.  */
+/* Build the parent pointer table of the child container FP.  */
 
-ctf_id_t
-ctf_lookup_variable (ctf_file_t *fp, const char *name)
+static ctf_pptrtab_t *
+ctf_pptrtab_build (ctf_file_t *fp)
 {
-  ctf_varent_t *ent;
-  ctf_lookup_var_key_t key = { fp, name };
-
-  /* This array is sorted, so we can bsearch for it.  */
+  ctf_pptrtab_t *pp;
+  uint32_t id, target, len = 0;
 
-  ent = bsearch (&key, fp->ctf_vars, fp->ctf_nvars, sizeof (ctf_varent_t),
-		 ctf_lookup_var);
+  for (id = 1; id <= fp->ctf_typemax; id++)
+    if (ctf_pptr_targets (fp, LCTF_INDEX_TO_TYPEPTR (fp, id), &target)
+	&& target >= len)
+      len = target + 1;
 
-  if (ent == NULL)
-    {
-      if (fp->ctf_parent != NULL)
-	return ctf_lookup_variable (fp->ctf_parent, name);
+  if ((pp = calloc (1, sizeof (ctf_pptrtab_t) + len * sizeof (uint32_t)))
+      == NULL)
+    return NULL;
 
-      return (ctf_set_errno (fp, ECTF_NOTYPEDAT));
-    }
+  pp->cpp_len = len;
+  for (id = 1; id <= fp->ctf_typemax; id++)
+    if (ctf_pptr_targets (fp, LCTF_INDEX_TO_TYPEPTR (fp, id), &target))
+      pp->cpp_ptrs[target] = id;
 
-  return ent->ctv_type;
+  return pp;
 }
 
-/* Given a symbol table index, return the name of that symbol from the secondary
-   string table, or the null string (never NULL).  */
-const char *
-ctf_lookup_symbol_name (ctf_file_t *fp, unsigned long symidx)
+/* Return the parent pointer table of the child container FP, building it if
+   need be.  */
+
+static const ctf_pptrtab_t *
+ctf_pptrtab (ctf_file_t *fp)
 {
-  const ctf_sect_t *sp = &fp->ctf_symtab;
-  Elf64_Sym sym, *gsp;
+  ctf_pptrtab_t *pp, *expected = NULL;
 
-  if (sp->cts_data == NULL)
+  if ((pp = __atomic_load_n (&fp->ctf_pptrtab, __ATOMIC_ACQUIRE)) != NULL)
+    return pp;
+
+  if (ctf_lazy_need (fp, LCTF_LAZY_TYPES) != 0)
+    return NULL;		/* errno is set for us.  */
+
+  if ((pp = ctf_pptrtab_build (fp)) == NULL)
     {
-      ctf_set_errno (fp, ECTF_NOSYMTAB);
-      return _CTF_NULLSTR;
+      (void) ctf_set_errno (fp, ENOMEM);
+      return NULL;
     }
 
-  if (symidx >= fp->ctf_nsyms)
+  if (!__atomic_compare_exchange_n (&fp->ctf_pptrtab, &expected, pp, 0,
+				    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
     {
-      ctf_set_errno (fp, EINVAL);
-      return _CTF_NULLSTR;
+      free (pp);
+      pp = expected;
     }
+  return pp;
+}
 
-  if (sp->cts_entsize == sizeof (Elf32_Sym))
+/* Return the ID of a pointer to TYPE, which may be in FP or in its parent, as
+   seen from FP, wherever the pointer is; or 0 if there is none.  */
+
+static ctf_id_t
+ctf_lookup_pointer (ctf_file_t *fp, ctf_id_t type)
+{
+  ctf_file_t *pfp = fp->ctf_parent;
+  const ctf_pptrtab_t *pp;
+  uint32_t idx = LCTF_TYPE_TO_INDEX (fp, type);
+  uint32_t ptr;
+
+  if (!(fp->ctf_flags & LCTF_CHILD) || LCTF_TYPE_ISCHILD (fp, type))
     {
-      const Elf32_Sym *symp = (Elf32_Sym *) sp->cts_data + symidx;
-      gsp = ctf_sym_to_elf64 (symp, &sym);
+      if (ctf_lazy_need (fp, LCTF_LAZY_PTRTAB) != 0)
+	return CTF_ERR;		/* errno is set for us.  */
+
+      if (idx > fp->ctf_typemax || (ptr = fp->ctf_ptrtab[idx]) == 0)
+	return 0;
+      return LCTF_INDEX_TO_TYPE (fp, ptr, (fp->ctf_flags & LCTF_CHILD));
     }
-  else
-      gsp = (Elf64_Sym *) sp->cts_data + symidx;
 
-  if (gsp->st_name < fp->ctf_str[CTF_STRTAB_1].cts_len)
-    return (const char *) fp->ctf_str[CTF_STRTAB_1].cts_strs + gsp->st_name;
+  /* A parent type: the pointer may be in either container.  */
 
-  return _CTF_NULLSTR;
+  if ((pp = ctf_pptrtab (fp)) == NULL)
+    return CTF_ERR;		/* errno is set for us.  */
+
+  if (idx < pp->cpp_len && pp->cpp_ptrs[idx] != 0)
+    return LCTF_INDEX_TO_TYPE (fp, pp->cpp_ptrs[idx], 1);
+
+  if (pfp == NULL)
+    return 0;
+
+  if (ctf_lazy_need (pfp, LCTF_LAZY_PTRTAB) != 0)
+    return (ctf_set_errno (fp, ctf_errno (pfp)));
+
+  if (idx > pfp->ctf_typemax || (ptr = pfp->ctf_ptrtab[idx]) == 0)
+    return 0;
+  return LCTF_INDEX_TO_TYPE (pfp, ptr, 0);
 }
 
-/* Given a symbol table index, return the type of the data object described
-   by the corresponding entry in the symbol table.  */
+/* Look up the parsed type name LN in FP.  The raw name is looked up in FP and
+   then, if it is not found or there is no pointer to it of the depth wanted,
+   in its parent; pointers to it may be in either container.  */
 
-ctf_id_t
-ctf_lookup_by_symbol (ctf_file_t *fp, unsigned long symidx)
+static ctf_id_t
+ctf_lookup_parsed_name (ctf_file_t *fp, const ctf_lookup_name_t *ln)
 {
-  const ctf_sect_t *sp = &fp->ctf_symtab;
-  ctf_id_t type;
+  ctf_file_t *lfp;
+  ctf_id_t type, ntype;
+  unsigned int i;
 
-  if (sp->cts_data == NULL)
-    return (ctf_set_errno (fp, ECTF_NOSYMTAB));
+  for (lfp = fp; lfp != NULL; lfp = (lfp == fp) ? fp->ctf_parent : NULL)
+    {
+      if ((type = ctf_lookup_by_rawhash_n (lfp,
+					   lfp->ctf_lookups[ln->cln_table].ctl_hash,
+					   ln->cln_name, ln->cln_len)) == 0)
+	continue;
 
-  if (symidx >= fp->ctf_nsyms)
-    return (ctf_set_errno (fp, EINVAL));
+      for (i = 0; i < ln->cln_nptrs; i++)
+	{
+	  /* If we can't find a pointer to the given type, see if we can find a
+	     pointer to the type resulting from resolving the type down to its
+	     base type and use that instead.  This helps with cases where the
+	     CTF data includes "struct foo *" but not "foo_t *" and the user
+	     tries to access "foo_t *" in the debugger.  */
 
-  if (sp->cts_entsize == sizeof (Elf32_Sym))
-    {
-      const Elf32_Sym *symp = (Elf32_Sym *) sp->cts_data + symidx;
-      if (ELF32_ST_TYPE (symp->st_info) != STT_OBJECT)
-	return (ctf_set_errno (fp, ECTF_NOTDATA));
-    }
-  else
-    {
-      const Elf64_Sym *symp = (Elf64_Sym *) sp->cts_data + symidx;
-      if (ELF64_ST_TYPE (symp->st_info) != STT_OBJECT)
-	return (ctf_set_errno (fp, ECTF_NOTDATA));
-    }
+	  if ((ntype = ctf_lookup_pointer (fp, type)) == 0)
+	    {
+	      if ((ntype = ctf_type_resolve_unsliced (fp, type)) == CTF_ERR)
+		break;
+	      ntype = ctf_lookup_pointer (fp, ntype);
+	    }
 
-  if (fp->ctf_sxlate[symidx] == -1u)
-    return (ctf_set_errno (fp, ECTF_NOTYPEDAT));
+	  if (ntype == CTF_ERR)
+	    return CTF_ERR;	/* errno is set for us.  */
+
+	  if (ntype == 0)
+	    break;
 
-  type = *(uint32_t *) ((uintptr_t) fp->ctf_buf + fp->ctf_sxlate[symidx]);
-  if (type == 0)
-    return (ctf_set_errno (fp, ECTF_NOTYPEDAT));
+	  type = ntype;
+	}
 
-  return type;
+      if (i == ln->cln_nptrs)
+	return type;
+    }
+
+  return (ctf_set_errno (fp, ECTF_NOTYPE));
 }
 
-/* Return the pointer to the internal CTF type data corresponding to the
-   given type ID.  If the ID is invalid, the function returns NULL.
-   This function is not exported outside of the library.  */
+/* The ctf_lookup_by_name() cache, mapping full type names to the types they
+   denote, so that repeated lookups of the same name cost one hash probe.  It is
+   used only for read-only containers, is allocated on first use, and is
+   bounded: it is an open-addressed table of CTF_NCACHE_SIZE entries, probed at
+   most CTF_NCACHE_PROBE times, and names of CTF_NCACHE_NAMELEN characters or
+   more are not cached.
 
-const ctf_type_t *
-ctf_lookup_by_id (ctf_file_t **fpp, ctf_id_t type)
+   Entries are filled in once and never replaced, so that they can be read
+   without locks: an entry is claimed by atomically changing its state from
+   empty to filling, and published by changing it to full once written.  */
+
+#define CTF_NCACHE_SIZE 1024
+#define CTF_NCACHE_PROBE 8
+#define CTF_NCACHE_NAMELEN 48
+
+/* The number of names ctf_lookup_by_name_hashed_n() hashes and prefetches
+   before looking any of them up.  */
+
+#define CTF_LOOKUP_BATCH 64
+
+enum
+  {
+   CTF_NCACHE_EMPTY,
+   CTF_NCACHE_FILLING,
+   CTF_NCACHE_FULL
+  };
+
+typedef struct ctf_ncache_ent
 {
-  ctf_file_t *fp = *fpp;	/* Caller passes in starting CTF container.  */
-  ctf_id_t idx;
+  uint32_t cne_state;		/* CTF_NCACHE_* state.  */
+  uint32_t cne_hash;		/* ctf_idx_hash() of name.  */
+  ctf_id_t cne_type;		/* Type named.  */
+  char cne_name[CTF_NCACHE_NAMELEN]; /* Name.  */
+} ctf_ncache_ent_t;
 
-  if ((fp->ctf_flags & LCTF_CHILD) && LCTF_TYPE_ISPARENT (fp, type)
-      && (fp = fp->ctf_parent) == NULL)
+struct ctf_ncache
+{
+  ctf_ncache_ent_t cnc_ents[CTF_NCACHE_SIZE];
+};
+
+/* Look NAME, with hash H, up in the cache of FP, returning 0 if absent.  */
+
+static ctf_id_t
+ctf_ncache_lookup (ctf_file_t *fp, const char *name, uint32_t h)
+{
+  ctf_ncache_t *nc = __atomic_load_n (&fp->ctf_ncache, __ATOMIC_ACQUIRE);
+  uint32_t i;
+
+  if (nc == NULL)
+    return 0;
+
+  for (i = 0; i < CTF_NCACHE_PROBE; i++)
     {
-      (void) ctf_set_errno (*fpp, ECTF_NOPARENT);
-      return NULL;
+      ctf_ncache_ent_t *ent = &nc->cnc_ents[(h + i) & (CTF_NCACHE_SIZE - 1)];
+      uint32_t state = __atomic_load_n (&ent->cne_state, __ATOMIC_ACQUIRE);
+
+      if (state == CTF_NCACHE_EMPTY)
+	return 0;
+
+      if (state == CTF_NCACHE_FULL && ent->cne_hash == h
+	  && strcmp (ent->cne_name, name) == 0)
+	return ent->cne_type;
     }
+  return 0;
+}
 
-  /* If this container is writable, check for a dynamic type.  */
+/* Add NAME, with hash H and length LEN, denoting TYPE, to the cache of FP, if
+   there is room.  */
 
-  if (fp->ctf_flags & LCTF_RDWR)
+static void
+ctf_ncache_insert (ctf_file_t *fp, const char *name, size_t len, uint32_t h,
+		   ctf_id_t type)
+{
+  ctf_ncache_t *nc = __atomic_load_n (&fp->ctf_ncache, __ATOMIC_ACQUIRE);
+  uint32_t i;
+
+  if (nc == NULL)
     {
-      ctf_dtdef_t *dtd;
+      ctf_ncache_t *expected = NULL;
 
-      if ((dtd = ctf_dynamic_type (fp, type)) != NULL)
+      if ((nc = calloc (1, sizeof (ctf_ncache_t))) == NULL)
+	return;
+
+      if (!__atomic_compare_exchange_n (&fp->ctf_ncache, &expected, nc, 0,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
 	{
-	  *fpp = fp;
-	  return &dtd->dtd_data;
+	  free (nc);
+	  nc = expected;
 	}
-      (void) ctf_set_errno (*fpp, ECTF_BADID);
-      return NULL;
     }
 
-  /* Check for a type in the static portion.  */
-
-  idx = LCTF_TYPE_TO_INDEX (fp, type);
-  if (idx > 0 && (unsigned long) idx <= fp->ctf_typemax)
+  for (i = 0; i < CTF_NCACHE_PROBE; i++)
     {
-      *fpp = fp;		/* Function returns ending CTF container.  */
-      return (LCTF_INDEX_TO_TYPEPTR (fp, idx));
+      ctf_ncache_ent_t *ent = &nc->cnc_ents[(h + i) & (CTF_NCACHE_SIZE - 1)];
+      uint32_t state = CTF_NCACHE_EMPTY;
+
+      if (__atomic_compare_exchange_n (&ent->cne_state, &state,
+				       CTF_NCACHE_FILLING, 0,
+				       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+	{
+	  ent->cne_hash = h;
+	  ent->cne_type = type;
+	  memcpy (ent->cne_name, name, len + 1);
+	  __atomic_store_n (&ent->cne_state, CTF_NCACHE_FULL, __ATOMIC_RELEASE);
+	  return;
+	}
+
+      /* Someone else is caching this very name: leave them to it.  */
+      if (state == CTF_NCACHE_FULL && ent->cne_hash == h
+	  && strcmp (ent->cne_name, name) == 0)
+	return;
     }
+}
 
-  (void) ctf_set_errno (*fpp, ECTF_BADID);
-  return NULL;
+/* Prefetch the cache entry for a name with hash H in FP.  */
+
+static inline void
+ctf_ncache_prefetch (ctf_file_t *fp, uint32_t h)
+{
+  ctf_ncache_t *nc = __atomic_load_n (&fp->ctf_ncache, __ATOMIC_ACQUIRE);
+
+  if (nc != NULL)
+    __builtin_prefetch (&nc->cnc_ents[h & (CTF_NCACHE_SIZE - 1)]);
 }
 
-/* Given a symbol table index, return the info for the function described
-   by the corresponding entry in the symbol table.  */
+/* Return nonzero if the result of looking up a name of length LEN in FP can be
+   cached.  */
 
-int
-ctf_func_info (ctf_file_t *fp, unsigned long symidx, ctf_funcinfo_t *fip)
+static inline int
+ctf_ncache_cacheable (ctf_file_t *fp, size_t len)
 {
-  const ctf_sect_t *sp = &fp->ctf_symtab;
-  const uint32_t *dp;
-  uint32_t info, kind, n;
+  ctf_file_t *pfp = fp->ctf_parent;
 
-  if (sp->cts_data == NULL)
-    return (ctf_set_errno (fp, ECTF_NOSYMTAB));
+  return !(fp->ctf_flags & LCTF_RDWR)
+    && (pfp == NULL || !(pfp->ctf_flags & LCTF_RDWR))
+    && len < CTF_NCACHE_NAMELEN;
+}
 
-  if (symidx >= fp->ctf_nsyms)
-    return (ctf_set_errno (fp, EINVAL));
+/* Look up NAME, of length LEN and with ctf_name_hash() H, consulting and
+   filling in the cache if CACHEABLE.  */
 
-  if (sp->cts_entsize == sizeof (Elf32_Sym))
-    {
-      const Elf32_Sym *symp = (Elf32_Sym *) sp->cts_data + symidx;
-      if (ELF32_ST_TYPE (symp->st_info) != STT_FUNC)
-	return (ctf_set_errno (fp, ECTF_NOTFUNC));
-    }
-  else
-    {
-      const Elf64_Sym *symp = (Elf64_Sym *) sp->cts_data + symidx;
-      if (ELF64_ST_TYPE (symp->st_info) != STT_FUNC)
-	return (ctf_set_errno (fp, ECTF_NOTFUNC));
-    }
+static ctf_id_t
+ctf_lookup_by_name_internal (ctf_file_t *fp, const char *name, size_t len,
+			     uint32_t h, int cacheable)
+{
+  ctf_lookup_name_t ln;
+  ctf_id_t type;
 
-  if (fp->ctf_sxlate[symidx] == -1u)
-    return (ctf_set_errno (fp, ECTF_NOFUNCDAT));
+  if (cacheable && (type = ctf_ncache_lookup (fp, name, h)) != 0)
+    return type;
 
-  dp = (uint32_t *) ((uintptr_t) fp->ctf_buf + fp->ctf_sxlate[symidx]);
+  if (ctf_lookup_parse_name (fp, name, &ln) < 0)
+    return CTF_ERR;		/* errno is set for us.  */
 
-  info = *dp++;
-  kind = LCTF_INFO_KIND (fp, info);
-  n = LCTF_INFO_VLEN (fp, info);
+  if ((type = ctf_lookup_parsed_name (fp, &ln)) == CTF_ERR)
+    return CTF_ERR;		/* errno is set for us.  */
 
-  if (kind == CTF_K_UNKNOWN && n == 0)
-    return (ctf_set_errno (fp, ECTF_NOFUNCDAT));
+  if (cacheable)
+    ctf_ncache_insert (fp, name, len, h, type);
 
-  if (kind != CTF_K_FUNCTION)
-    return (ctf_set_errno (fp, ECTF_CORRUPT));
+  return type;
+}
 
-  fip->ctc_return = *dp++;
-  fip->ctc_argc = n;
-  fip->ctc_flags = 0;
+/* Attempt to convert the given C type name into the corresponding CTF type ID,
+   looking it up in the parent container if it is not found in this one.  This
+   function does not allocate memory and may be called from several threads at
+   once on the same read-only container.  */
 
-  if (n != 0 && dp[n - 1] == 0)
+ctf_id_t
+ctf_lookup_by_name (ctf_file_t *fp, const char *name)
+{
+  size_t len;
+  int cacheable;
+
+  if (name == NULL)
+    return (ctf_set_errno (fp, EINVAL));
+
+  len = strlen (name);
+  cacheable = ctf_ncache_cacheable (fp, len);
+
+  return ctf_lookup_by_name_internal (fp, name, len,
+				      cacheable ? ctf_idx_hash (name) : 0,
+				      cacheable);
+}
+
+/* Return the hash of a type name, for ctf_lookup_by_name_hashed_n().  */
+
+uint32_t
+ctf_name_hash (const char *name)
+{
+  return ctf_idx_hash (name);
+}
+
+/* Look up the N type names in NAMES, as if with ctf_lookup_by_name(), storing
+   their types in the corresponding entries of IDS.  If HASHES is non-NULL, it
+   holds the ctf_name_hash() of each name, which callers looking up the same
+   names in many containers can compute just once.  The names are hashed, and
+   the cache entries for them prefetched, a batch at a time before any are
+   looked up.  Names that are not found get a type of CTF_ERR, and errno is set
+   for the last of them.  Return the number of names found.  */
+
+ssize_t
+ctf_lookup_by_name_hashed_n (ctf_file_t *fp, const char **names,
+			     const uint32_t *hashes, size_t n, ctf_id_t *ids)
+{
+  uint32_t h[CTF_LOOKUP_BATCH];
+  size_t len[CTF_LOOKUP_BATCH];
+  ssize_t found = 0;
+  size_t i, j, batch;
+
+  for (i = 0; i < n; i += batch)
     {
-      fip->ctc_flags |= CTF_FUNC_VARARG;
-      fip->ctc_argc--;
+      batch = n - i < CTF_LOOKUP_BATCH ? n - i : CTF_LOOKUP_BATCH;
+
+      for (j = 0; j < batch; j++)
+	{
+	  if (names[i + j] == NULL)
+	    continue;
+
+	  len[j] = strlen (names[i + j]);
+	  h[j] = hashes != NULL ? hashes[i + j] : ctf_idx_hash (names[i + j]);
+	  ctf_ncache_prefetch (fp, h[j]);
+	}
+
+      for (j = 0; j < batch; j++)
+	{
+	  if (names[i + j] == NULL)
+	    {
+	      ids[i + j] = ctf_set_errno (fp, EINVAL);
+	      continue;
+	    }
+
+	  if ((ids[i + j] = ctf_lookup_by_name_internal
+	       (fp, names[i + j], len[j], h[j],
+		ctf_ncache_cacheable (fp, len[j]))) != CTF_ERR)
+	    found++;
+	}
     }
 
-  return 0;
+  return found;
 }
 
-/* Given a symbol table index, return the arguments for the function described
-   by the corresponding entry in the symbol table.  */
+/* Like ctf_lookup_by_name_hashed_n(), hashing the names itself.  */
 
-int
-ctf_func_args (ctf_file_t * fp, unsigned long symidx, uint32_t argc,
-	       ctf_id_t * argv)
+ssize_t
+ctf_lookup_by_name_n (ctf_file_t *fp, const char **names, size_t n,
+		      ctf_id_t *ids)
 {
-  const uint32_t *dp;
-  ctf_funcinfo_t f;
+  return ctf_lookup_by_name_hashed_n (fp, names, NULL, n, ids);
+}
 
-  if (ctf_func_info (fp, symidx, &f) < 0)
-    return -1;			/* errno is set for us.  */
+typedef struct ctf_lookup_var_key
+{
+  ctf_file_t *clvk_fp;
+  const char *clvk_name;
+} ctf_lookup_var_key_t;
 
-  /* The argument data is two uint32_t's past the translation table
-     offset: one for the function info, and one for the return type. */
+/* A bsearch function for variable names.  */
 
-  dp = (uint32_t *) ((uintptr_t) fp->ctf_buf + fp->ctf_sxlate[symidx]) + 2;
+static int
+ctf_lookup_var (const void *key_, const void *memb_)
+{
+  const ctf_lookup_var_key_t *key = key_;
+  const ctf_varent_t *memb = memb_;
 
-  for (argc = MIN (argc, f.ctc_argc); argc != 0; argc--)
-    *argv++ = *dp++;
+  return (strcmp (key->clvk_name, ctf_strptr (key->clvk_fp, memb->ctv_name)));
+}
+
+/* Return the hash of the variables in FP, building it on first use, or NULL
+   if it cannot be built.  Variables whose names cannot be hashed (which should
+   never happen) are left out.  */
+
+static ctf_hash_t *
+ctf_var_hash (ctf_file_t *fp)
+{
+  ctf_hash_t *hp, *expected = NULL;
+  unsigned long i;
+
+  if ((hp = __atomic_load_n (&fp->ctf_varhash, __ATOMIC_ACQUIRE)) != NULL)
+    return hp;
+
+  if ((hp = ctf_hash_create (fp->ctf_nvars, ctf_hash_string,
+			     ctf_hash_eq_string)) == NULL)
+    return NULL;
+
+  for (i = 0; i < fp->ctf_nvars; i++)
+    (void) ctf_hash_define_type (hp, fp, fp->ctf_vars[i].ctv_type,
+				 fp->ctf_vars[i].ctv_name);
+
+  if (!__atomic_compare_exchange_n (&fp->ctf_varhash, &expected, hp, 0,
+				    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      ctf_hash_destroy (hp);
+      hp = expected;
+    }
+  return hp;
+}
+
+/* Look up the variable NAME in FP alone, returning its type, or 0.  */
+
+static ctf_id_t
+ctf_lookup_var_1 (ctf_file_t *fp, const char *name)
+{
+  ctf_varent_t *ent;
+  ctf_lookup_var_key_t key = { fp, name };
+  ctf_hash_t *hp;
+  ctf_id_t type;
+
+  if ((hp = ctf_var_hash (fp)) != NULL
+      && ((type = ctf_hash_lookup_type (hp, fp, name)) != 0
+	  || ctf_hash_size (hp) == fp->ctf_nvars))
+    return type;
+
+  /* No memory for the hash, or not every variable is in it: this array is
+     sorted, so we can bsearch it.  */
+
+  ent = bsearch (&key, fp->ctf_vars, fp->ctf_nvars, sizeof (ctf_varent_t),
+		 ctf_lookup_var);
+
+  return ent != NULL ? ent->ctv_type : 0;
+}
+
+/* Given a variable name, return the type of the variable with that name.  */
+
+ctf_id_t
+ctf_lookup_variable (ctf_file_t *fp, const char *name)
+{
+  ctf_id_t type;
+
+  if ((type = ctf_lookup_var_1 (fp, name)) == 0)
+    {
+      if (fp->ctf_parent != NULL)
+	return ctf_lookup_variable (fp->ctf_parent, name);
+
+      return (ctf_set_errno (fp, ECTF_NOTYPEDAT));
+    }
+
+  return type;
+}
+
+/* Look up the N variables named in NAMES, returning their types in the
+   corresponding entries in TYPES, and the number found.  Variables that are
+   found neither in FP nor in its parent get a type of CTF_ERR.  */
+
+ssize_t
+ctf_lookup_variable_n (ctf_file_t *fp, const char **names, size_t n,
+		       ctf_id_t *types)
+{
+  ctf_file_t *pfp = fp->ctf_parent;
+  ssize_t found = 0;
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    {
+      if ((types[i] = ctf_lookup_var_1 (fp, names[i])) == 0
+	  && (pfp == NULL || (types[i] = ctf_lookup_var_1 (pfp, names[i])) == 0))
+	types[i] = CTF_ERR;
+      else
+	found++;
+    }
+
+  if ((size_t) found < n)
+    (void) ctf_set_errno (fp, ECTF_NOTYPEDAT);
+
+  return found;
+}
+
+/* The enumerator index, mapping the names of all the enumerators of all the
+   root-visible enums in a container to their enum and value, so that bare
+   enumeration constants can be looked up without knowing their type.  It is
+   built on first use and thrown away whenever an enumerator is added.  It is a
+   single allocation holding an array of the enumerators in type ID order,
+   followed by an open-addressed hash table of indexes into that array, plus
+   one.  Where several enums have enumerators of the same name, the first is
+   found.  */
+
+typedef struct ctf_enumerator
+{
+  const char *cen_name;		/* Enumerator name.  */
+  uint32_t cen_hash;		/* ctf_idx_hash() of name.  */
+  int cen_value;		/* Enumerator value.  */
+  ctf_id_t cen_type;		/* Enum type.  */
+} ctf_enumerator_t;
+
+struct ctf_enumeridx
+{
+  uint32_t cex_nslots;		/* Number of slots: a power of two.  */
+  uint32_t *cex_slots;		/* Enumerator array index plus one, or 0.  */
+  ctf_enumerator_t cex_enums[1]; /* Enumerators.  */
+};
+
+/* Build the enumerator index for FP.  */
+
+static ctf_enumeridx_t *
+ctf_enumerator_index_build (ctf_file_t *fp)
+{
+  ctf_enumeridx_t *ex;
+  ctf_id_t id, max = fp->ctf_typemax;
+  int child = (fp->ctf_flags & LCTF_CHILD);
+  uint32_t nslots = 1, n = 0, i;
+
+  for (id = 1; id <= max; id++)
+    {
+      const ctf_type_t *tp = LCTF_INDEX_TO_TYPEPTR (fp, id);
+
+      if (LCTF_INFO_KIND (fp, tp->ctt_info) == CTF_K_ENUM
+	  && LCTF_INFO_ISROOT (fp, tp->ctt_info))
+	n += LCTF_INFO_VLEN (fp, tp->ctt_info);
+    }
+
+  while (nslots < n * 2)
+    nslots <<= 1;
+
+  if ((ex = malloc (sizeof (ctf_enumeridx_t) + n * sizeof (ctf_enumerator_t)
+		    + nslots * sizeof (uint32_t))) == NULL)
+    return NULL;
+
+  ex->cex_nslots = nslots;
+  ex->cex_slots = (uint32_t *) &ex->cex_enums[n];
+  memset (ex->cex_slots, 0, nslots * sizeof (uint32_t));
+
+  for (id = 1, i = 0; id <= max; id++)
+    {
+      const ctf_type_t *tp = LCTF_INDEX_TO_TYPEPTR (fp, id);
+      ctf_id_t type = LCTF_INDEX_TO_TYPE (fp, id, child);
+      uint32_t vlen = LCTF_INFO_VLEN (fp, tp->ctt_info);
+      ctf_dtdef_t *dtd;
+
+      if (LCTF_INFO_KIND (fp, tp->ctt_info) != CTF_K_ENUM
+	  || !LCTF_INFO_ISROOT (fp, tp->ctt_info))
+	continue;
+
+      if ((dtd = ctf_dynamic_type (fp, type)) != NULL)
+	{
+	  ctf_dmdef_t *dmd;
+
+	  for (dmd = ctf_list_next (&dtd->dtd_u.dtu_members);
+	       dmd != NULL && i < n; dmd = ctf_list_next (dmd), i++)
+	    {
+	      ex->cex_enums[i].cen_name = dmd->dmd_name;
+	      ex->cex_enums[i].cen_value = dmd->dmd_value;
+	      ex->cex_enums[i].cen_type = type;
+	    }
+	}
+      else
+	{
+	  const ctf_enum_t *ep;
+	  ssize_t increment;
+
+	  (void) ctf_get_ctt_size (fp, tp, NULL, &increment);
+	  ep = (const ctf_enum_t *) ((uintptr_t) tp + increment);
+
+	  for (; vlen != 0 && i < n; vlen--, ep++, i++)
+	    {
+	      ex->cex_enums[i].cen_name = ctf_strptr (fp, ep->cte_name);
+	      ex->cex_enums[i].cen_value = ep->cte_value;
+	      ex->cex_enums[i].cen_type = type;
+	    }
+	}
+    }
+
+  n = i;
+  for (i = 0; i < n; i++)
+    {
+      ctf_enumerator_t *cep = &ex->cex_enums[i];
+      uint32_t slot;
+
+      cep->cen_hash = ctf_idx_hash (cep->cen_name);
+      for (slot = cep->cen_hash & (nslots - 1); ex->cex_slots[slot] != 0;
+	   slot = (slot + 1) & (nslots - 1))
+	{
+	  const ctf_enumerator_t *ocep = &ex->cex_enums[ex->cex_slots[slot] - 1];
+	  if (ocep->cen_hash == cep->cen_hash
+	      && strcmp (ocep->cen_name, cep->cen_name) == 0)
+	    break;
+	}
+
+      if (ex->cex_slots[slot] == 0)
+	ex->cex_slots[slot] = i + 1;
+    }
+
+  return ex;
+}
+
+/* Return the enumerator index for FP, building it if need be.  */
+
+static const ctf_enumeridx_t *
+ctf_enumerator_index (ctf_file_t *fp)
+{
+  ctf_enumeridx_t *ex, *expected = NULL;
+
+  if ((ex = __atomic_load_n (&fp->ctf_enumerators, __ATOMIC_ACQUIRE)) != NULL)
+    return ex;
+
+  if (ctf_lazy_need (fp, LCTF_LAZY_TYPES) != 0)
+    return NULL;		/* errno is set for us.  */
+
+  if ((ex = ctf_enumerator_index_build (fp)) == NULL)
+    {
+      (void) ctf_set_errno (fp, ENOMEM);
+      return NULL;
+    }
+
+  if (!__atomic_compare_exchange_n (&fp->ctf_enumerators, &expected, ex, 0,
+				    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      free (ex);
+      ex = expected;
+    }
+  return ex;
+}
+
+/* Given the name of an enumerator of some root-visible enum, return the type of
+   that enum, and its value in *VALP if VALP is non-NULL.  If the name is not
+   found, the parent container is searched.  */
+
+ctf_id_t
+ctf_lookup_enumerator (ctf_file_t *fp, const char *name, int *valp)
+{
+  const ctf_enumeridx_t *ex;
+  uint32_t h, slot;
+
+  if ((ex = ctf_enumerator_index (fp)) == NULL)
+    return CTF_ERR;		/* errno is set for us.  */
+
+  h = ctf_idx_hash (name);
+  for (slot = h & (ex->cex_nslots - 1); ex->cex_slots[slot] != 0;
+       slot = (slot + 1) & (ex->cex_nslots - 1))
+    {
+      const ctf_enumerator_t *cep = &ex->cex_enums[ex->cex_slots[slot] - 1];
+      if (cep->cen_hash == h && strcmp (cep->cen_name, name) == 0)
+	{
+	  if (valp != NULL)
+	    *valp = cep->cen_value;
+	  return cep->cen_type;
+	}
+    }
+
+  if (fp->ctf_parent != NULL)
+    {
+      ctf_id_t type;
+
+      if ((type = ctf_lookup_enumerator (fp->ctf_parent, name,
+					 valp)) != CTF_ERR)
+	return type;
+      return (ctf_set_errno (fp, ctf_errno (fp->ctf_parent)));
+    }
+
+  return (ctf_set_errno (fp, ECTF_NOENUMNAM));
+}
+
+/* Given a symbol table index, return the name of that symbol from the secondary
+   string table, or the null string (never NULL).  */
+const char *
+ctf_lookup_symbol_name (ctf_file_t *fp, unsigned long symidx)
+{
+  const ctf_sect_t *sp = &fp->ctf_symtab;
+  Elf64_Sym sym, *gsp;
+
+  if (sp->cts_data == NULL)
+    {
+      ctf_set_errno (fp, ECTF_NOSYMTAB);
+      return _CTF_NULLSTR;
+    }
+
+  if (symidx >= fp->ctf_nsyms)
+    {
+      ctf_set_errno (fp, EINVAL);
+      return _CTF_NULLSTR;
+    }
+
+  if (sp->cts_entsize == sizeof (Elf32_Sym))
+    {
+      const Elf32_Sym *symp = (Elf32_Sym *) sp->cts_data + symidx;
+      gsp = ctf_sym_to_elf64 (symp, &sym);
+    }
+  else
+      gsp = (Elf64_Sym *) sp->cts_data + symidx;
+
+  if (gsp->st_name < fp->ctf_str[CTF_STRTAB_1].cts_len)
+    return (const char *) fp->ctf_str[CTF_STRTAB_1].cts_strs + gsp->st_name;
+
+  return _CTF_NULLSTR;
+}
+
+/* Return the symbol at SYMIDX in FP's symbol table, converted into *SYMP if it
+   is an Elf32_Sym.  SYMIDX must be in range.  */
+
+static const Elf64_Sym *
+ctf_symtab_sym (const ctf_file_t *fp, unsigned long symidx, Elf64_Sym *symp)
+{
+  const ctf_sect_t *sp = &fp->ctf_symtab;
+
+  if (sp->cts_entsize == sizeof (Elf32_Sym))
+    return ctf_sym_to_elf64 ((const Elf32_Sym *) sp->cts_data + symidx, symp);
+
+  return (const Elf64_Sym *) sp->cts_data + symidx;
+}
+
+/* The symbol name index, mapping the names of the STT_FUNC and STT_OBJECT
+   symbols in the symbol table to their symbol table indexes, so that consumers
+   that know only a symbol's name need not scan the symbol table themselves.  It
+   is built on first use and never changes, since the symbol table does not.  It
+   is an open-addressed hash table of symbol indexes plus one, with the name
+   hash of each alongside to avoid touching the string table on most probes.
+   Function and data object symbols are told apart, so a function and an object
+   of the same name each have a slot.  Where several symbols of the same type
+   have the same name, global and weak symbols win over local ones, and
+   otherwise the first is found.  */
+
+typedef struct ctf_symslot
+{
+  uint32_t css_hash;		/* ctf_idx_hash() of name.  */
+  uint32_t css_symidx;		/* Symbol index plus one, or 0 if empty.  */
+} ctf_symslot_t;
+
+struct ctf_symidx
+{
+  uint32_t csx_nslots;		/* Number of slots: a power of two.  */
+  ctf_symslot_t csx_slots[1];	/* Slots.  */
+};
+
+/* Return the name of SYM in FP's symbol string table, or NULL if none.  */
+
+static const char *
+ctf_symtab_sym_name (const ctf_file_t *fp, const Elf64_Sym *sym)
+{
+  if (sym->st_name == 0 || sym->st_name >= fp->ctf_str[CTF_STRTAB_1].cts_len)
+    return NULL;
+
+  return (const char *) fp->ctf_str[CTF_STRTAB_1].cts_strs + sym->st_name;
+}
+
+/* Build the symbol name index for FP.  */
+
+static ctf_symidx_t *
+ctf_symbol_index_build (ctf_file_t *fp)
+{
+  ctf_symidx_t *sx;
+  unsigned long i;
+  uint32_t nslots = 1, n = 0;
+
+  for (i = 0; i < fp->ctf_nsyms; i++)
+    {
+      Elf64_Sym sym;
+      const Elf64_Sym *gsp = ctf_symtab_sym (fp, i, &sym);
+      unsigned char type = ELF64_ST_TYPE (gsp->st_info);
+
+      if ((type == STT_FUNC || type == STT_OBJECT)
+	  && ctf_symtab_sym_name (fp, gsp) != NULL)
+	n++;
+    }
+
+  while (nslots < n * 2)
+    nslots <<= 1;
+
+  if ((sx = calloc (1, sizeof (ctf_symidx_t)
+		    + nslots * sizeof (ctf_symslot_t))) == NULL)
+    return NULL;
+
+  sx->csx_nslots = nslots;
+
+  for (i = 0; i < fp->ctf_nsyms; i++)
+    {
+      Elf64_Sym sym;
+      const Elf64_Sym *gsp = ctf_symtab_sym (fp, i, &sym);
+      unsigned char type = ELF64_ST_TYPE (gsp->st_info);
+      const char *name;
+      uint32_t h, slot;
+
+      if ((type != STT_FUNC && type != STT_OBJECT)
+	  || (name = ctf_symtab_sym_name (fp, gsp)) == NULL)
+	continue;
+
+      h = ctf_idx_hash (name);
+      for (slot = h & (nslots - 1); sx->csx_slots[slot].css_symidx != 0;
+	   slot = (slot + 1) & (nslots - 1))
+	{
+	  ctf_symslot_t *ssp = &sx->csx_slots[slot];
+	  Elf64_Sym osym;
+	  const Elf64_Sym *ogsp;
+
+	  if (ssp->css_hash != h)
+	    continue;
+
+	  ogsp = ctf_symtab_sym (fp, ssp->css_symidx - 1, &osym);
+	  if (ELF64_ST_TYPE (ogsp->st_info) == type
+	      && strcmp (ctf_symtab_sym_name (fp, ogsp), name) == 0)
+	    break;
+	}
+
+      if (sx->csx_slots[slot].css_symidx == 0)
+	{
+	  sx->csx_slots[slot].css_hash = h;
+	  sx->csx_slots[slot].css_symidx = i + 1;
+	}
+      else if (ELF64_ST_BIND (gsp->st_info) != STB_LOCAL)
+	{
+	  Elf64_Sym osym;
+	  const Elf64_Sym *ogsp;
+
+	  ogsp = ctf_symtab_sym (fp, sx->csx_slots[slot].css_symidx - 1, &osym);
+	  if (ELF64_ST_BIND (ogsp->st_info) == STB_LOCAL)
+	    sx->csx_slots[slot].css_symidx = i + 1;
+	}
+    }
+
+  return sx;
+}
+
+/* Return the symbol name index for FP, building it if need be.  */
+
+static const ctf_symidx_t *
+ctf_symbol_index (ctf_file_t *fp)
+{
+  ctf_symidx_t *sx, *expected = NULL;
+
+  if ((sx = __atomic_load_n (&fp->ctf_symnames, __ATOMIC_ACQUIRE)) != NULL)
+    return sx;
+
+  if ((sx = ctf_symbol_index_build (fp)) == NULL)
+    {
+      (void) ctf_set_errno (fp, ENOMEM);
+      return NULL;
+    }
+
+  if (!__atomic_compare_exchange_n (&fp->ctf_symnames, &expected, sx, 0,
+				    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      free (sx);
+      sx = expected;
+    }
+  return sx;
+}
+
+/* Given the name of a symbol of TYPE, STT_FUNC or STT_OBJECT, return its index
+   in the symbol table, or -1 if there is no such symbol.  */
+
+static long
+ctf_lookup_symbol_idx (ctf_file_t *fp, const char *name, unsigned char type)
+{
+  const ctf_symidx_t *sx;
+  uint32_t h, slot;
+
+  if (fp->ctf_symtab.cts_data == NULL)
+    {
+      (void) ctf_set_errno (fp, ECTF_NOSYMTAB);
+      return -1;
+    }
+
+  if ((sx = ctf_symbol_index (fp)) == NULL)
+    return -1;			/* errno is set for us.  */
+
+  h = ctf_idx_hash (name);
+  for (slot = h & (sx->csx_nslots - 1); sx->csx_slots[slot].css_symidx != 0;
+       slot = (slot + 1) & (sx->csx_nslots - 1))
+    {
+      const ctf_symslot_t *ssp = &sx->csx_slots[slot];
+      unsigned long symidx = ssp->css_symidx - 1;
+      Elf64_Sym sym;
+      const Elf64_Sym *gsp;
+
+      if (ssp->css_hash != h)
+	continue;
+
+      gsp = ctf_symtab_sym (fp, symidx, &sym);
+      if (ELF64_ST_TYPE (gsp->st_info) == type
+	  && strcmp (ctf_symtab_sym_name (fp, gsp), name) == 0)
+	return symidx;
+    }
+
+  (void) ctf_set_errno (fp, type == STT_FUNC ? ECTF_NOTFUNC : ECTF_NOTDATA);
+  return -1;
+}
+
+/* Find the CTF data for the function (if FUNC) or data object at SYMIDX in
+   the symbol table, returning 0 and the data in *DPP, or an error code.  */
+
+static int
+ctf_symbol_data (ctf_file_t *fp, unsigned long symidx, int func,
+		 const uint32_t **dpp)
+{
+  Elf64_Sym sym;
+  const Elf64_Sym *gsp;
+
+  if (fp->ctf_symtab.cts_data == NULL)
+    return ECTF_NOSYMTAB;
+
+  if (symidx >= fp->ctf_nsyms)
+    return EINVAL;
+
+  gsp = ctf_symtab_sym (fp, symidx, &sym);
+  if (ELF64_ST_TYPE (gsp->st_info) != (func ? STT_FUNC : STT_OBJECT))
+    return func ? ECTF_NOTFUNC : ECTF_NOTDATA;
+
+  ctf_sxlate_need (fp, symidx);
+  if (fp->ctf_sxlate[symidx] == -1u)
+    return func ? ECTF_NOFUNCDAT : ECTF_NOTYPEDAT;
+
+  *dpp = (const uint32_t *) ((uintptr_t) fp->ctf_buf + fp->ctf_sxlate[symidx]);
+  return 0;
+}
+
+/* Find the type of the data object at SYMIDX in the symbol table, returning 0
+   and the type in *TYPEP, or an error code.  */
+
+static int
+ctf_symbol_type (ctf_file_t *fp, unsigned long symidx, ctf_id_t *typep)
+{
+  const uint32_t *dp;
+  int err;
+
+  if ((err = ctf_symbol_data (fp, symidx, 0, &dp)) != 0)
+    return err;
+
+  if ((*typep = *dp) == 0)
+    return ECTF_NOTYPEDAT;
+
+  return 0;
+}
+
+/* Given a symbol table index, return the type of the data object described
+   by the corresponding entry in the symbol table.  */
+
+ctf_id_t
+ctf_lookup_by_symbol (ctf_file_t *fp, unsigned long symidx)
+{
+  ctf_id_t type;
+  int err;
+
+  if ((err = ctf_symbol_type (fp, symidx, &type)) != 0)
+    return (ctf_set_errno (fp, err));
+
+  return type;
+}
+
+/* Return the pointer to the internal CTF type data corresponding to the
+   given type ID.  If the ID is invalid, the function returns NULL.
+   This function is not exported outside of the library.  */
+
+const ctf_type_t *
+ctf_lookup_by_id (ctf_file_t **fpp, ctf_id_t type)
+{
+  ctf_file_t *fp = *fpp;	/* Caller passes in starting CTF container.  */
+  ctf_id_t idx;
+
+  if ((fp->ctf_flags & LCTF_CHILD) && LCTF_TYPE_ISPARENT (fp, type)
+      && (fp = fp->ctf_parent) == NULL)
+    {
+      (void) ctf_set_errno (*fpp, ECTF_NOPARENT);
+      return NULL;
+    }
+
+  /* If this container is writable, check for a dynamic type.  */
+
+  if (fp->ctf_flags & LCTF_RDWR)
+    {
+      ctf_dtdef_t *dtd;
+
+      if ((dtd = ctf_dynamic_type (fp, type)) != NULL)
+	{
+	  *fpp = fp;
+	  return &dtd->dtd_data;
+	}
+      (void) ctf_set_errno (*fpp, ECTF_BADID);
+      return NULL;
+    }
+
+  /* Check for a type in the static portion.  */
+
+  if (ctf_lazy_need (fp, LCTF_LAZY_TYPES) != 0)
+    {
+      (void) ctf_set_errno (*fpp, ctf_errno (fp));
+      return NULL;
+    }
+
+  idx = LCTF_TYPE_TO_INDEX (fp, type);
+  if (idx > 0 && (unsigned long) idx <= fp->ctf_typemax)
+    {
+      *fpp = fp;		/* Function returns ending CTF container.  */
+      return (LCTF_INDEX_TO_TYPEPTR (fp, idx));
+    }
+
+  (void) ctf_set_errno (*fpp, ECTF_BADID);
+  return NULL;
+}
+
+/* Find the info for the function at SYMIDX in the symbol table, returning 0
+   and the info in *FIP, or an error code.  */
+
+static int
+ctf_symbol_func_info (ctf_file_t *fp, unsigned long symidx,
+		      ctf_funcinfo_t *fip)
+{
+  const uint32_t *dp;
+  uint32_t info, kind, n;
+  int err;
+
+  if ((err = ctf_symbol_data (fp, symidx, 1, &dp)) != 0)
+    return err;
+
+  info = *dp++;
+  kind = LCTF_INFO_KIND (fp, info);
+  n = LCTF_INFO_VLEN (fp, info);
+
+  if (kind == CTF_K_UNKNOWN && n == 0)
+    return ECTF_NOFUNCDAT;
+
+  if (kind != CTF_K_FUNCTION)
+    return ECTF_CORRUPT;
+
+  fip->ctc_return = *dp++;
+  fip->ctc_argc = n;
+  fip->ctc_flags = 0;
+
+  if (n != 0 && dp[n - 1] == 0)
+    {
+      fip->ctc_flags |= CTF_FUNC_VARARG;
+      fip->ctc_argc--;
+    }
+
+  return 0;
+}
+
+/* Given a symbol table index, return the info for the function described
+   by the corresponding entry in the symbol table.  */
+
+int
+ctf_func_info (ctf_file_t *fp, unsigned long symidx, ctf_funcinfo_t *fip)
+{
+  int err;
+
+  if ((err = ctf_symbol_func_info (fp, symidx, fip)) != 0)
+    return (ctf_set_errno (fp, err));
+
+  return 0;
+}
+
+/* Given a symbol table index, return the arguments for the function described
+   by the corresponding entry in the symbol table.  */
+
+int
+ctf_func_args (ctf_file_t * fp, unsigned long symidx, uint32_t argc,
+	       ctf_id_t * argv)
+{
+  const uint32_t *dp;
+  ctf_funcinfo_t f;
+
+  if (ctf_func_info (fp, symidx, &f) < 0)
+    return -1;			/* errno is set for us.  */
+
+  /* The argument data is two uint32_t's past the translation table
+     offset: one for the function info, and one for the return type. */
+
+  dp = (uint32_t *) ((uintptr_t) fp->ctf_buf + fp->ctf_sxlate[symidx]) + 2;
+
+  for (argc = MIN (argc, f.ctc_argc); argc != 0; argc--)
+    *argv++ = *dp++;
+
+  return 0;
+}
+
+/* Given the name of a data object symbol, return its type.  */
+
+ctf_id_t
+ctf_lookup_object_by_name (ctf_file_t *fp, const char *name)
+{
+  long symidx;
+
+  if ((symidx = ctf_lookup_symbol_idx (fp, name, STT_OBJECT)) < 0)
+    return CTF_ERR;		/* errno is set for us.  */
+
+  return ctf_lookup_by_symbol (fp, symidx);
+}
+
+/* Given the name of a function symbol, return the info for that function.  */
+
+int
+ctf_func_info_by_name (ctf_file_t *fp, const char *name, ctf_funcinfo_t *fip)
+{
+  long symidx;
+
+  if ((symidx = ctf_lookup_symbol_idx (fp, name, STT_FUNC)) < 0)
+    return -1;			/* errno is set for us.  */
+
+  return ctf_func_info (fp, symidx, fip);
+}
+
+/* Given the name of a function symbol, return the arguments of that
+   function.  */
+
+int
+ctf_func_args_by_name (ctf_file_t *fp, const char *name, uint32_t argc,
+		       ctf_id_t *argv)
+{
+  long symidx;
+
+  if ((symidx = ctf_lookup_symbol_idx (fp, name, STT_FUNC)) < 0)
+    return -1;			/* errno is set for us.  */
+
+  return ctf_func_args (fp, symidx, argc, argv);
+}
+
+/* The address index, covering the extents of all the defined STT_FUNC and
+   STT_OBJECT symbols in the symbol table, so that the symbol covering an
+   address can be found by binary search.  It is built on first use and never
+   changes.  Entries are sorted by start address, and then with enclosing
+   symbols before the symbols they enclose; each records the highest end
+   address of it and all the entries before it, so that a search for a symbol
+   covering an address that starts below some enclosing or overlapping symbol
+   knows when to stop looking backwards.  Symbols of size zero cover only
+   their start address.  */
+
+typedef struct ctf_addrent
+{
+  uint64_t cae_start;		/* Start address.  */
+  uint64_t cae_end;		/* End address (exclusive).  */
+  uint64_t cae_maxend;		/* Highest cae_end up to this entry.  */
+  uint32_t cae_symidx;		/* Symbol table index.  */
+  uint32_t cae_func;		/* Nonzero if an STT_FUNC.  */
+} ctf_addrent_t;
+
+struct ctf_addridx
+{
+  size_t cax_nents;		/* Number of entries.  */
+  ctf_addrent_t cax_ents[1];	/* Entries.  */
+};
+
+static int
+ctf_addrent_compar (const void *one, const void *two)
+{
+  const ctf_addrent_t *a = one;
+  const ctf_addrent_t *b = two;
+
+  if (a->cae_start != b->cae_start)
+    return a->cae_start < b->cae_start ? -1 : 1;
+  if (a->cae_end != b->cae_end)
+    return a->cae_end > b->cae_end ? -1 : 1;
+  return a->cae_symidx < b->cae_symidx ? -1 : (a->cae_symidx > b->cae_symidx);
+}
+
+/* Build the address index for FP.  */
+
+static ctf_addridx_t *
+ctf_addr_index_build (ctf_file_t *fp)
+{
+  ctf_addridx_t *ax;
+  unsigned long i;
+  uint64_t maxend = 0;
+  size_t n = 0;
+
+  for (i = 0; i < fp->ctf_nsyms; i++)
+    {
+      Elf64_Sym sym;
+      const Elf64_Sym *gsp = ctf_symtab_sym (fp, i, &sym);
+      unsigned char type = ELF64_ST_TYPE (gsp->st_info);
+
+      if ((type == STT_FUNC || type == STT_OBJECT)
+	  && gsp->st_shndx != SHN_UNDEF)
+	n++;
+    }
+
+  if ((ax = malloc (sizeof (ctf_addridx_t)
+		    + n * sizeof (ctf_addrent_t))) == NULL)
+    return NULL;
+
+  for (i = 0, n = 0; i < fp->ctf_nsyms; i++)
+    {
+      Elf64_Sym sym;
+      const Elf64_Sym *gsp = ctf_symtab_sym (fp, i, &sym);
+      unsigned char type = ELF64_ST_TYPE (gsp->st_info);
+      ctf_addrent_t *ent = &ax->cax_ents[n];
+
+      if ((type != STT_FUNC && type != STT_OBJECT)
+	  || gsp->st_shndx == SHN_UNDEF)
+	continue;
+
+      ent->cae_start = gsp->st_value;
+      ent->cae_end = gsp->st_value + (gsp->st_size != 0 ? gsp->st_size : 1);
+      if (ent->cae_end < ent->cae_start)
+	ent->cae_end = UINT64_MAX;
+      ent->cae_symidx = i;
+      ent->cae_func = (type == STT_FUNC);
+      n++;
+    }
+
+  ax->cax_nents = n;
+  qsort (ax->cax_ents, n, sizeof (ctf_addrent_t), ctf_addrent_compar);
+
+  for (i = 0; i < n; i++)
+    {
+      if (ax->cax_ents[i].cae_end > maxend)
+	maxend = ax->cax_ents[i].cae_end;
+      ax->cax_ents[i].cae_maxend = maxend;
+    }
+
+  return ax;
+}
+
+/* Return the address index for FP, building it if need be.  */
+
+static const ctf_addridx_t *
+ctf_addr_index (ctf_file_t *fp)
+{
+  ctf_addridx_t *ax, *expected = NULL;
+
+  if ((ax = __atomic_load_n (&fp->ctf_addrs, __ATOMIC_ACQUIRE)) != NULL)
+    return ax;
+
+  if (fp->ctf_symtab.cts_data == NULL)
+    {
+      (void) ctf_set_errno (fp, ECTF_NOSYMTAB);
+      return NULL;
+    }
+
+  if ((ax = ctf_addr_index_build (fp)) == NULL)
+    {
+      (void) ctf_set_errno (fp, ENOMEM);
+      return NULL;
+    }
+
+  if (!__atomic_compare_exchange_n (&fp->ctf_addrs, &expected, ax, 0,
+				    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      free (ax);
+      ax = expected;
+    }
+  return ax;
+}
+
+/* Return the innermost entry in AX covering ADDR, or NULL if none.  */
+
+static const ctf_addrent_t *
+ctf_addr_search (const ctf_addridx_t *ax, uint64_t addr)
+{
+  size_t lo = 0, hi = ax->cax_nents;
+
+  /* Find the first entry starting above ADDR.  */
+
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+
+      if (ax->cax_ents[mid].cae_start <= addr)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+
+  while (lo > 0 && ax->cax_ents[lo - 1].cae_maxend > addr)
+    {
+      const ctf_addrent_t *ent = &ax->cax_ents[--lo];
+
+      if (ent->cae_end > addr)
+	return ent;
+    }
+
+  return NULL;
+}
+
+/* Fill in *AIP for ADDR, covered by ENT.  */
+
+static void
+ctf_addr_fill (ctf_file_t *fp, const ctf_addrent_t *ent, uint64_t addr,
+	       ctf_addrinfo_t *aip)
+{
+  aip->cai_symidx = ent->cae_symidx;
+  aip->cai_offset = addr - ent->cae_start;
+  aip->cai_flags = 0;
+  aip->cai_type = CTF_ERR;
+
+  if (ent->cae_func)
+    {
+      aip->cai_flags |= CTF_ADDR_FUNC;
+      if (ctf_symbol_func_info (fp, ent->cae_symidx, &aip->cai_func) == 0)
+	aip->cai_flags |= CTF_ADDR_TYPED;
+    }
+  else if (ctf_symbol_type (fp, ent->cae_symidx, &aip->cai_type) == 0)
+    aip->cai_flags |= CTF_ADDR_TYPED;
+  else
+    aip->cai_type = CTF_ERR;
+}
+
+/* Given an address, return information on the function or data object symbol
+   whose extent covers it, and on its type, if known.  Where symbols overlap,
+   the one starting closest below the address is returned.  */
+
+int
+ctf_lookup_by_addr (ctf_file_t *fp, uint64_t addr, ctf_addrinfo_t *aip)
+{
+  const ctf_addridx_t *ax;
+  const ctf_addrent_t *ent;
+
+  if ((ax = ctf_addr_index (fp)) == NULL)
+    return -1;			/* errno is set for us.  */
+
+  if ((ent = ctf_addr_search (ax, addr)) == NULL)
+    return (ctf_set_errno (fp, ECTF_NOSYMADDR));
+
+  ctf_addr_fill (fp, ent, addr, aip);
+  return 0;
+}
+
+/* Look up the N addresses in ADDRS as with ctf_lookup_by_addr(), filling in
+   the corresponding entries in AIPS, and return the number found.  Addresses
+   that no symbol covers get a cai_symidx of -1.  Runs of nearby addresses, as
+   found in sorted sample buffers, are cheaper to look up than scattered
+   ones.  */
+
+ssize_t
+ctf_lookup_by_addr_n (ctf_file_t *fp, const uint64_t *addrs, size_t n,
+		      ctf_addrinfo_t *aips)
+{
+  const ctf_addridx_t *ax;
+  const ctf_addrent_t *ent = NULL;
+  ssize_t found = 0;
+  size_t i;
+
+  if ((ax = ctf_addr_index (fp)) == NULL)
+    return -1;			/* errno is set for us.  */
+
+  for (i = 0; i < n; i++)
+    {
+      /* An address covered by the previous entry, and below the start of the
+	 next, is covered by that entry too.  */
+
+      if (ent == NULL || addrs[i] < ent->cae_start || addrs[i] >= ent->cae_end
+	  || (ent + 1 < &ax->cax_ents[ax->cax_nents]
+	      && addrs[i] >= ent[1].cae_start))
+	ent = ctf_addr_search (ax, addrs[i]);
+
+      if (ent == NULL)
+	{
+	  aips[i].cai_symidx = -1ul;
+	  continue;
+	}
+
+      ctf_addr_fill (fp, ent, addrs[i], &aips[i]);
+      found++;
+    }
+
+  if ((size_t) found < n)
+    (void) ctf_set_errno (fp, ECTF_NOSYMADDR);
+
+  return found;
+}
+
+/* The function reference index, mapping type IDs to the functions in the
+   symbol table whose return or argument types are those types, so that
+   consumers looking for all the functions taking or returning some type need
+   not look at every function.  It is built on first use and never changes.
+   It is an array of references sorted by type ID, then by symbol index, then
+   by argument number: the references to a type are found by binary search.
+   Each reference is indexed under the type ID recorded in the function
+   signature and, if that type is a pointer, typedef or cv-qualifier, again
+   under the base type found by looking through those, flagged
+   CTF_FUNCREF_BASE, so that all the references built from some base type are
+   found by a single search.  */
+
+#define CTF_FUNCREF_BASE 0x1	/* Reference indexed under its base type.  */
+
+typedef struct ctf_funcref
+{
+  uint32_t cfr_type;		/* Return or argument type, or its base.  */
+  uint32_t cfr_symidx;		/* Symbol table index of function.  */
+  int32_t cfr_argn;		/* Argument number, or -1 for return type.  */
+  uint32_t cfr_flags;		/* CTF_FUNCREF_* flags.  */
+} ctf_funcref_t;
+
+struct ctf_funcrefidx
+{
+  size_t cfx_nrefs;		/* Number of references.  */
+  ctf_funcref_t cfx_refs[1];	/* References.  */
+};
+
+static int
+ctf_funcref_compar (const void *one, const void *two)
+{
+  const ctf_funcref_t *a = one;
+  const ctf_funcref_t *b = two;
+
+  if (a->cfr_type != b->cfr_type)
+    return a->cfr_type < b->cfr_type ? -1 : 1;
+  if (a->cfr_symidx != b->cfr_symidx)
+    return a->cfr_symidx < b->cfr_symidx ? -1 : 1;
+  return (a->cfr_argn > b->cfr_argn) - (a->cfr_argn < b->cfr_argn);
+}
+
+/* Return the base type of TYPE in FP: the type it is built from by pointers,
+   typedefs and cv-qualifiers, or TYPE itself if it is none of those.  */
+
+static ctf_id_t
+ctf_funcref_base (ctf_file_t *fp, ctf_id_t type)
+{
+  unsigned long limit;
+  ctf_id_t ref;
+
+  /* Guard against reference loops in corrupt containers.  The type counts
+     are not known until lazily-opened containers have been walked.  */
+
+  if (ctf_lazy_need (fp, LCTF_LAZY_TYPES) != 0)
+    return type;
+  limit = fp->ctf_typemax + 1;
+
+  if (fp->ctf_parent != NULL)
+    {
+      if (ctf_lazy_need (fp->ctf_parent, LCTF_LAZY_TYPES) != 0)
+	return type;
+      limit += fp->ctf_parent->ctf_typemax;
+    }
+
+  while (limit-- > 0)
+    {
+      switch (ctf_type_kind (fp, type))
+	{
+	case CTF_K_POINTER:
+	case CTF_K_TYPEDEF:
+	case CTF_K_VOLATILE:
+	case CTF_K_CONST:
+	case CTF_K_RESTRICT:
+	  if ((ref = ctf_type_reference (fp, type)) == CTF_ERR)
+	    return type;
+	  type = ref;
+	  break;
+	default:
+	  return type;
+	}
+    }
+
+  return type;
+}
+
+/* Add references to TYPE, and to its base type, from argument ARGN of the
+   function with symbol table index SYMIDX to the index FX.  */
+
+static void
+ctf_funcref_add (ctf_file_t *fp, ctf_funcrefidx_t *fx, ctf_id_t type,
+		 unsigned long symidx, int32_t argn)
+{
+  ctf_funcref_t *ref = &fx->cfx_refs[fx->cfx_nrefs++];
+  ctf_id_t base;
+
+  ref->cfr_type = type;
+  ref->cfr_symidx = symidx;
+  ref->cfr_argn = argn;
+  ref->cfr_flags = 0;
+
+  if ((base = ctf_funcref_base (fp, type)) != type)
+    {
+      ref = &fx->cfx_refs[fx->cfx_nrefs++];
+      ref->cfr_type = base;
+      ref->cfr_symidx = symidx;
+      ref->cfr_argn = argn;
+      ref->cfr_flags = CTF_FUNCREF_BASE;
+    }
+}
+
+/* Build the function reference index for FP.  */
+
+static ctf_funcrefidx_t *
+ctf_funcref_index_build (ctf_file_t *fp)
+{
+  ctf_funcrefidx_t *fx;
+  unsigned long i;
+  size_t n = 0;
+
+  for (i = 0; i < fp->ctf_nsyms; i++)
+    {
+      ctf_funcinfo_t fi;
+
+      if (ctf_symbol_func_info (fp, i, &fi) == 0)
+	n += (fi.ctc_argc + 1) * 2;
+    }
+
+  if ((fx = malloc (sizeof (ctf_funcrefidx_t)
+		    + n * sizeof (ctf_funcref_t))) == NULL)
+    return NULL;
+
+  fx->cfx_nrefs = 0;
+  for (i = 0; i < fp->ctf_nsyms; i++)
+    {
+      ctf_funcinfo_t fi;
+      const uint32_t *dp;
+      uint32_t j;
+
+      if (ctf_symbol_func_info (fp, i, &fi) != 0)
+	continue;
+
+      ctf_funcref_add (fp, fx, fi.ctc_return, i, -1);
+
+      /* The argument data follows the function info and return type.  */
+
+      dp = (const uint32_t *) ((uintptr_t) fp->ctf_buf + fp->ctf_sxlate[i]) + 2;
+      for (j = 0; j < fi.ctc_argc; j++)
+	ctf_funcref_add (fp, fx, dp[j], i, j);
+    }
+
+  qsort (fx->cfx_refs, fx->cfx_nrefs, sizeof (ctf_funcref_t),
+	 ctf_funcref_compar);
+
+  return fx;
+}
+
+/* Return the function reference index for FP, building it if need be.  */
+
+static const ctf_funcrefidx_t *
+ctf_funcref_index (ctf_file_t *fp)
+{
+  ctf_funcrefidx_t *fx, *expected = NULL;
+
+  if ((fx = __atomic_load_n (&fp->ctf_funcrefs, __ATOMIC_ACQUIRE)) != NULL)
+    return fx;
+
+  if (fp->ctf_symtab.cts_data == NULL)
+    {
+      (void) ctf_set_errno (fp, ECTF_NOSYMTAB);
+      return NULL;
+    }
+
+  if ((fx = ctf_funcref_index_build (fp)) == NULL)
+    {
+      (void) ctf_set_errno (fp, ENOMEM);
+      return NULL;
+    }
+
+  if (!__atomic_compare_exchange_n (&fp->ctf_funcrefs, &expected, fx, 0,
+				    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      free (fx);
+      fx = expected;
+    }
+  return fx;
+}
+
+/* Iterate over every function in the symbol table that returns TYPE (if FLAGS
+   contains CTF_FUNC_BY_RETURN) or takes an argument of TYPE (if FLAGS contains
+   CTF_FUNC_BY_ARG), in symbol table order.  If FLAGS contains CTF_FUNC_BY_BASE,
+   TYPE is first reduced to its base type, looking through pointers, typedefs
+   and cv-qualifiers, and every function whose return or argument type has that
+   base type is found.  We pass the name and symbol table index of each function
+   to the specified callback function, along with the number of the argument of
+   that type, or -1 for the return type: a function with several arguments of
+   TYPE is passed once for each.  */
+
+int
+ctf_func_iter_by_type (ctf_file_t *fp, ctf_id_t type, int flags,
+		       ctf_func_sym_f *func, void *arg)
+{
+  const ctf_funcrefidx_t *fx;
+  const ctf_funcref_t *ref, *end;
+  size_t lo = 0, hi;
+  int rc;
+
+  if ((fx = ctf_funcref_index (fp)) == NULL)
+    return -1;			/* errno is set for us.  */
+
+  if (flags & CTF_FUNC_BY_BASE)
+    type = ctf_funcref_base (fp, type);
+
+  /* Find the first reference to TYPE.  */
+
+  hi = fx->cfx_nrefs;
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+
+      if (fx->cfx_refs[mid].cfr_type < (uint32_t) type)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+
+  end = &fx->cfx_refs[fx->cfx_nrefs];
+  for (ref = &fx->cfx_refs[lo]; ref < end && ref->cfr_type == (uint32_t) type;
+       ref++)
+    {
+      if (!(flags & (ref->cfr_argn < 0 ? CTF_FUNC_BY_RETURN : CTF_FUNC_BY_ARG)))
+	continue;
+
+      if ((ref->cfr_flags & CTF_FUNCREF_BASE) && !(flags & CTF_FUNC_BY_BASE))
+	continue;
+
+      if ((rc = func (ctf_lookup_symbol_name (fp, ref->cfr_symidx),
+		      ref->cfr_symidx, ref->cfr_argn, arg)) != 0)
+	return rc;
+    }
 
   return 0;
 }
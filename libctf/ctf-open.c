@@ -228,24 +228,96 @@ static const ctf_fileops_t ctf_fileops[] = {
   {get_kind_v2, get_root_v2, get_vlen_v2, get_ctt_size_v2, get_vbytes_v2},
 };
 
-/* Initialize the symtab translation table by filling each entry with the
-  offset of the CTF type or function data corresponding to each STT_FUNC or
-  STT_OBJECT entry in the symbol table.  */
+/* The symtab translation table is filled in on demand, CTF_SXLATE_CHUNK
+   entries at a time, as symbols are looked up: since each entry depends on the
+   entries before it, the table is always filled in from the start, and
+   ctf_sxlate_done records how far it has got.  */
+
+#define CTF_SXLATE_CHUNK 4096
+
+/* Find the offsets of all the occurrences of the sentinel symbol names
+   _START_ and _END_ in the symbol string table, so that symbols can be checked
+   against them without looking at their names.  If there are too many to
+   record, ctf_sxlate_nsentinels is set to -1, and names are compared.  */
+
+static void
+init_symtab_sentinels (ctf_file_t *fp)
+{
+  static const char *const sentinels[] = { "_START_", "_END_" };
+  const char *strs = fp->ctf_str[CTF_STRTAB_1].cts_strs;
+  size_t len = fp->ctf_str[CTF_STRTAB_1].cts_len;
+  int n = 0;
+  size_t i;
+
+  for (i = 0; i < sizeof (sentinels) / sizeof (sentinels[0]); i++)
+    {
+      size_t slen = strlen (sentinels[i]) + 1;
+      const char *p = strs;
+      const char *end = strs + len;
+
+      while (p < end
+	     && (p = memmem (p, end - p, sentinels[i], slen)) != NULL)
+	{
+	  if (n == CTF_SXLATE_NSENTINELS)
+	    {
+	      fp->ctf_sxlate_nsentinels = -1;
+	      return;
+	    }
+	  fp->ctf_sxlate_sentinels[n++] = p - strs;
+	  p++;
+	}
+    }
+  fp->ctf_sxlate_nsentinels = n;
+}
+
+/* Return nonzero if the symbol name at string table offset NAME is one of the
+   sentinels _START_ or _END_.  */
 
 static int
-init_symtab (ctf_file_t *fp, const ctf_header_t *hp,
-	     const ctf_sect_t *sp, const ctf_sect_t *strp)
+init_symtab_sentinel (const ctf_file_t *fp, uint32_t name)
+{
+  const char *str;
+  int i;
+
+  if (fp->ctf_sxlate_nsentinels >= 0)
+    {
+      for (i = 0; i < fp->ctf_sxlate_nsentinels; i++)
+	if (fp->ctf_sxlate_sentinels[i] == name)
+	  return 1;
+      return 0;
+    }
+
+  if (name >= fp->ctf_str[CTF_STRTAB_1].cts_len)
+    return 0;
+
+  str = fp->ctf_str[CTF_STRTAB_1].cts_strs + name;
+  return (strcmp (str, "_START_") == 0 || strcmp (str, "_END_") == 0);
+}
+
+/* Fill in the symtab translation table up to entry END (exclusive) with the
+   offset of the CTF type or function data corresponding to each STT_FUNC or
+   STT_OBJECT entry in the symbol table.  Called with the ctf_sxlate_lock
+   held.  */
+
+static void
+init_symtab (ctf_file_t *fp, unsigned long end)
 {
-  const unsigned char *symp = sp->cts_data;
-  uint32_t *xp = fp->ctf_sxlate;
-  uint32_t *xend = xp + fp->ctf_nsyms;
+  const ctf_header_t *hp = fp->ctf_header;
+  const ctf_sect_t *sp = &fp->ctf_symtab;
+  int elf32 = (sp->cts_entsize == sizeof (Elf32_Sym));
+  unsigned long i = fp->ctf_sxlate_done;
 
-  uint32_t objtoff = hp->cth_objtoff;
-  uint32_t funcoff = hp->cth_funcoff;
+  uint32_t objtoff = fp->ctf_sxlate_objtoff;
+  uint32_t funcoff = fp->ctf_sxlate_funcoff;
 
   uint32_t info, vlen;
-  Elf64_Sym sym, *gsp;
-  const char *name;
+
+  if (i == 0)
+    {
+      init_symtab_sentinels (fp);
+      objtoff = hp->cth_objtoff;
+      funcoff = hp->cth_funcoff;
+    }
 
   /* The CTF data object and function type sections are ordered to match
      the relative order of the respective symbol types in the symtab.
@@ -253,30 +325,49 @@ init_symtab (ctf_file_t *fp, const ctf_header_t *hp,
      pad is inserted in the CTF section.  As a further optimization,
      anonymous or undefined symbols are omitted from the CTF data.  */
 
-  for (; xp < xend; xp++, symp += sp->cts_entsize)
+  for (; i < end; i++)
     {
-      if (sp->cts_entsize == sizeof (Elf32_Sym))
-	gsp = ctf_sym_to_elf64 ((Elf32_Sym *) (uintptr_t) symp, &sym);
-      else
-	gsp = (Elf64_Sym *) (uintptr_t) symp;
+      uint32_t *xp = &fp->ctf_sxlate[i];
+      uint32_t name;
+      uint64_t value;
+      unsigned char type;
+      uint16_t shndx;
+
+      /* Pull out only the fields we need, rather than converting whole
+	 Elf32_Syms.  */
 
-      if (gsp->st_name < strp->cts_size)
-	name = (const char *) strp->cts_data + gsp->st_name;
+      if (elf32)
+	{
+	  const Elf32_Sym *symp = (const Elf32_Sym *) sp->cts_data + i;
+
+	  name = symp->st_name;
+	  value = symp->st_value;
+	  type = ELF32_ST_TYPE (symp->st_info);
+	  shndx = symp->st_shndx;
+	}
       else
-	name = _CTF_NULLSTR;
+	{
+	  const Elf64_Sym *symp = (const Elf64_Sym *) sp->cts_data + i;
 
-      if (gsp->st_name == 0 || gsp->st_shndx == SHN_UNDEF
-	  || strcmp (name, "_START_") == 0 || strcmp (name, "_END_") == 0)
+	  name = symp->st_name;
+	  value = symp->st_value;
+	  type = ELF64_ST_TYPE (symp->st_info);
+	  shndx = symp->st_shndx;
+	}
+
+      if (name == 0 || shndx == SHN_UNDEF
+	  || (type != STT_OBJECT && type != STT_FUNC)
+	  || init_symtab_sentinel (fp, name))
 	{
 	  *xp = -1u;
 	  continue;
 	}
 
-      switch (ELF64_ST_TYPE (gsp->st_info))
+      switch (type)
 	{
 	case STT_OBJECT:
 	  if (objtoff >= hp->cth_funcoff
-	      || (gsp->st_shndx == SHN_EXTABS && gsp->st_value == 0))
+	      || (shndx == SHN_EXTABS && value == 0))
 	    {
 	      *xp = -1u;
 	      break;
@@ -307,15 +398,33 @@ init_symtab (ctf_file_t *fp, const ctf_header_t *hp,
 	  else
 	    funcoff += sizeof (uint32_t) * (vlen + 2);
 	  break;
-
-	default:
-	  *xp = -1u;
-	  break;
 	}
     }
 
-  ctf_dprintf ("loaded %lu symtab entries\n", fp->ctf_nsyms);
-  return 0;
+  fp->ctf_sxlate_objtoff = objtoff;
+  fp->ctf_sxlate_funcoff = funcoff;
+  __atomic_store_n (&fp->ctf_sxlate_done, end, __ATOMIC_RELEASE);
+
+  if (end == fp->ctf_nsyms)
+    ctf_dprintf ("loaded %lu symtab entries\n", fp->ctf_nsyms);
+}
+
+/* Make sure that the symtab translation table is filled in at least as far as
+   entry SYMIDX, filling in another chunk or more if need be.  */
+
+void
+ctf_sxlate_build (ctf_file_t *fp, unsigned long symidx)
+{
+  unsigned long end;
+
+  end = (symidx / CTF_SXLATE_CHUNK + 1) * CTF_SXLATE_CHUNK;
+  if (end > fp->ctf_nsyms)
+    end = fp->ctf_nsyms;
+
+  pthread_mutex_lock (&fp->ctf_sxlate_lock);
+  if (fp->ctf_sxlate_done < end)
+    init_symtab (fp, end);
+  pthread_mutex_unlock (&fp->ctf_sxlate_lock);
 }
 
 /* Reset the CTF base pointer and derive the buf pointer from it, initializing
@@ -657,28 +766,18 @@ upgrade_types (ctf_file_t *fp, ctf_header_t *cth)
 }
 #endif /* !NO_COMPAT */
 
-/* Initialize the type ID translation table with the byte offset of each type,
-   and initialize the hash tables of each named type.  Upgrade the type table to
-   the latest supported representation in the process, if needed, and if this
-   recension of libctf supports upgrading.  */
+/* Count the types in the type section, setting ctf_typemax and recording the
+   population of each kind in POP.  Upgrade the type table to the latest
+   supported representation in the process, if needed, and if this recension
+   of libctf supports upgrading.  */
 
 static int
-init_types (ctf_file_t *fp, ctf_header_t *cth)
+init_types_count (ctf_file_t *fp, ctf_header_t *cth, unsigned long *pop)
 {
   const ctf_type_t *tbuf;
   const ctf_type_t *tend;
-
-  unsigned long pop[CTF_K_MAX + 1] = { 0 };
   const ctf_type_t *tp;
-  uint32_t id, dst;
-  uint32_t *xp;
-
-  /* We determine whether the container is a child or a parent based on
-     the value of cth_parname.  */
-
-  int child = cth->cth_parname != 0;
   int nlstructs = 0, nlunions = 0;
-  int err;
 
   assert (!(fp->ctf_flags & LCTF_RDWR));
 
@@ -694,9 +793,7 @@ init_types (ctf_file_t *fp, ctf_header_t *cth)
   tbuf = (ctf_type_t *) (fp->ctf_buf + cth->cth_typeoff);
   tend = (ctf_type_t *) (fp->ctf_buf + cth->cth_stroff);
 
-  /* We make two passes through the entire type section.  In this first
-     pass, we count the number of each type and the total number of types.  */
-
+  fp->ctf_typemax = 0;
   for (tp = tbuf; tp < tend; fp->ctf_typemax++)
     {
       unsigned short kind = LCTF_INFO_KIND (fp, tp->ctt_info);
@@ -720,253 +817,560 @@ init_types (ctf_file_t *fp, ctf_header_t *cth)
 	  else
 	    pop[tp->ctt_type]++;
 	}
+      else if (kind == CTF_K_STRUCT && size >= CTF_LSTRUCT_THRESH)
+	nlstructs++;
+      else if (kind == CTF_K_UNION && size >= CTF_LSTRUCT_THRESH)
+	nlunions++;
+
       tp = (ctf_type_t *) ((uintptr_t) tp + increment + vbytes);
       pop[kind]++;
     }
 
-  if (child)
+  ctf_dprintf ("%lu total types counted (%d long structs, %d long unions)\n",
+	       fp->ctf_typemax, nlstructs, nlunions);
+  return 0;
+}
+
+/* Return the number of names that will be hashed in the ctf_names table, given
+   the population of each kind.  */
+
+static unsigned long
+init_types_nnames (const unsigned long *pop)
+{
+  return pop[CTF_K_INTEGER] + pop[CTF_K_FLOAT] + pop[CTF_K_FUNCTION]
+    + pop[CTF_K_TYPEDEF] + pop[CTF_K_POINTER] + pop[CTF_K_VOLATILE]
+    + pop[CTF_K_CONST] + pop[CTF_K_RESTRICT];
+}
+
+/* Add the type with index ID at TP to those of the indexes in WHICH that
+   it belongs in.  (LCTF_LAZY_TYPES is ignored: the type-offset table is
+   filled in by the caller.)  */
+
+static int
+init_type_index (ctf_file_t *fp, uint32_t which, uint32_t id,
+		 const ctf_type_t *tp, int child)
+{
+  unsigned short kind = LCTF_INFO_KIND (fp, tp->ctt_info);
+  unsigned short isroot = LCTF_INFO_ISROOT (fp, tp->ctt_info);
+  const char *name;
+  int err;
+
+  switch (kind)
     {
-      ctf_dprintf ("CTF container %p is a child\n", (void *) fp);
-      fp->ctf_flags |= LCTF_CHILD;
+    case CTF_K_INTEGER:
+    case CTF_K_FLOAT:
+      if (!(which & LCTF_LAZY_NAMES))
+	break;
+
+      /* Names are reused by bit-fields, which are differentiated by their
+	 encodings, and so typically we'd record only the first instance of
+	 a given intrinsic.  However, we replace an existing type with a
+	 root-visible version so that we can be sure to find it when
+	 checking for conflicting definitions in ctf_add_type().  */
+
+      name = ctf_strptr (fp, tp->ctt_name);
+      if (((ctf_hash_lookup_type (fp->ctf_names.ctn_readonly,
+				  fp, name)) == 0)
+	  || isroot)
+	{
+	  err = ctf_hash_define_type (fp->ctf_names.ctn_readonly, fp,
+				      LCTF_INDEX_TO_TYPE (fp, id, child),
+				      tp->ctt_name);
+	  if (err != 0)
+	    return err;
+	}
+      break;
+
+      /* These kinds have no name, so do not need interning into any
+	 hashtables.  */
+    case CTF_K_ARRAY:
+    case CTF_K_SLICE:
+      break;
+
+    case CTF_K_FUNCTION:
+    case CTF_K_TYPEDEF:
+      if (!isroot || !(which & LCTF_LAZY_NAMES))
+	break;
+
+      err = ctf_hash_insert_type (fp->ctf_names.ctn_readonly, fp,
+				  LCTF_INDEX_TO_TYPE (fp, id, child),
+				  tp->ctt_name);
+      if (err != 0)
+	return err;
+      break;
+
+    case CTF_K_STRUCT:
+    case CTF_K_UNION:
+    case CTF_K_ENUM:
+      {
+	ctf_names_t *np = ctf_name_table (fp, kind);
+	uint32_t bit = (kind == CTF_K_STRUCT ? LCTF_LAZY_STRUCTS
+			: kind == CTF_K_UNION ? LCTF_LAZY_UNIONS
+			: LCTF_LAZY_ENUMS);
+
+	if (!isroot || !(which & bit))
+	  break;
+
+	err = ctf_hash_define_type (np->ctn_readonly, fp,
+				    LCTF_INDEX_TO_TYPE (fp, id, child),
+				    tp->ctt_name);
+	if (err != 0)
+	  return err;
+	break;
+      }
+
+    case CTF_K_FORWARD:
+      {
+	ctf_names_t *np = ctf_name_table (fp, tp->ctt_type);
+	uint32_t bit;
+
+	if (!isroot)
+	  break;
+
+	if (np == &fp->ctf_unions)
+	  bit = LCTF_LAZY_UNIONS;
+	else if (np == &fp->ctf_enums)
+	  bit = LCTF_LAZY_ENUMS;
+	else if (np == &fp->ctf_structs)
+	  bit = LCTF_LAZY_STRUCTS;
+	else
+	  bit = LCTF_LAZY_NAMES;
+
+	if (!(which & bit))
+	  break;
+
+	/* Only insert forward tags into the given hash if the type or tag
+	   name is not already present.  */
+	name = ctf_strptr (fp, tp->ctt_name);
+	if (ctf_hash_lookup_type (np->ctn_readonly, fp, name) == 0)
+	  {
+	    err = ctf_hash_insert_type (np->ctn_readonly, fp,
+					LCTF_INDEX_TO_TYPE (fp, id, child),
+					tp->ctt_name);
+	    if (err != 0)
+	      return err;
+	  }
+	break;
+      }
+
+    case CTF_K_POINTER:
+      /* If the type referenced by the pointer is in this CTF container,
+	 then store the index of the pointer type in
+	 fp->ctf_ptrtab[ index of referenced type ].  */
+
+      if ((which & LCTF_LAZY_PTRTAB)
+	  && LCTF_TYPE_ISCHILD (fp, tp->ctt_type) == child
+	  && LCTF_TYPE_TO_INDEX (fp, tp->ctt_type) <= fp->ctf_typemax)
+	fp->ctf_ptrtab[LCTF_TYPE_TO_INDEX (fp, tp->ctt_type)] = id;
+      /*FALLTHRU*/
+
+    case CTF_K_VOLATILE:
+    case CTF_K_CONST:
+    case CTF_K_RESTRICT:
+      if (!isroot || !(which & LCTF_LAZY_NAMES))
+	break;
+
+      err = ctf_hash_insert_type (fp->ctf_names.ctn_readonly, fp,
+				  LCTF_INDEX_TO_TYPE (fp, id, child),
+				  tp->ctt_name);
+      if (err != 0)
+	return err;
+      break;
+    default:
+      ctf_dprintf ("unhandled CTF kind in endianness conversion -- %x\n",
+		   kind);
+      return ECTF_CORRUPT;
     }
-  else
-    ctf_dprintf ("CTF container %p is a parent\n", (void *) fp);
 
-  /* Now that we've counted up the number of each type, we can allocate
-     the hash tables, type translation table, and pointer table.  */
+  return 0;
+}
+
+/* Make an additional pass through the pointer table to find pointers that
+   point to anonymous typedef nodes.  If we find one, modify the pointer table
+   so that the pointer is also known to point to the node that is referenced
+   by the anonymous typedef node.  */
 
-  if ((fp->ctf_structs.ctn_readonly
-       = ctf_hash_create (pop[CTF_K_STRUCT], ctf_hash_string,
-			  ctf_hash_eq_string)) == NULL)
+static void
+init_ptrtab_typedefs (ctf_file_t *fp, int child)
+{
+  const ctf_type_t *tp;
+  uint32_t id, dst;
+
+  for (id = 1; id <= fp->ctf_typemax; id++)
+    {
+      if ((dst = fp->ctf_ptrtab[id]) != 0)
+	{
+	  tp = LCTF_INDEX_TO_TYPEPTR (fp, id);
+
+	  if (LCTF_INFO_KIND (fp, tp->ctt_info) == CTF_K_TYPEDEF
+	      && strcmp (ctf_strptr (fp, tp->ctt_name), "") == 0
+	      && LCTF_TYPE_ISCHILD (fp, tp->ctt_type) == child
+	      && LCTF_TYPE_TO_INDEX (fp, tp->ctt_type) <= fp->ctf_typemax)
+	      fp->ctf_ptrtab[LCTF_TYPE_TO_INDEX (fp, tp->ctt_type)] = dst;
+	}
+    }
+}
+
+/* Allocate the type translation table and the indexes in WHICH, then walk
+   the type section filling in the byte offset of each type in the translation
+   table and adding each type to the indexes.  */
+
+static int
+init_types_fill (ctf_file_t *fp, ctf_header_t *cth, uint32_t which,
+		 const unsigned long *pop)
+{
+  const ctf_type_t *tbuf;
+  const ctf_type_t *tend;
+  const ctf_type_t *tp;
+  uint32_t id;
+  uint32_t *xp;
+  int child = fp->ctf_flags & LCTF_CHILD;
+  int err;
+
+  if ((which & LCTF_LAZY_STRUCTS)
+      && (fp->ctf_structs.ctn_readonly
+	  = ctf_hash_create (pop[CTF_K_STRUCT], ctf_hash_string,
+			     ctf_hash_eq_string)) == NULL)
     return ENOMEM;
 
-  if ((fp->ctf_unions.ctn_readonly
-       = ctf_hash_create (pop[CTF_K_UNION], ctf_hash_string,
-			  ctf_hash_eq_string)) == NULL)
+  if ((which & LCTF_LAZY_UNIONS)
+      && (fp->ctf_unions.ctn_readonly
+	  = ctf_hash_create (pop[CTF_K_UNION], ctf_hash_string,
+			     ctf_hash_eq_string)) == NULL)
     return ENOMEM;
 
-  if ((fp->ctf_enums.ctn_readonly
-       = ctf_hash_create (pop[CTF_K_ENUM], ctf_hash_string,
-			  ctf_hash_eq_string)) == NULL)
+  if ((which & LCTF_LAZY_ENUMS)
+      && (fp->ctf_enums.ctn_readonly
+	  = ctf_hash_create (pop[CTF_K_ENUM], ctf_hash_string,
+			     ctf_hash_eq_string)) == NULL)
     return ENOMEM;
 
-  if ((fp->ctf_names.ctn_readonly
-       = ctf_hash_create (pop[CTF_K_INTEGER] +
-			  pop[CTF_K_FLOAT] +
-			  pop[CTF_K_FUNCTION] +
-			  pop[CTF_K_TYPEDEF] +
-			  pop[CTF_K_POINTER] +
-			  pop[CTF_K_VOLATILE] +
-			  pop[CTF_K_CONST] +
-			  pop[CTF_K_RESTRICT],
-			  ctf_hash_string,
-			  ctf_hash_eq_string)) == NULL)
+  if ((which & LCTF_LAZY_NAMES)
+      && (fp->ctf_names.ctn_readonly
+	  = ctf_hash_create (init_types_nnames (pop), ctf_hash_string,
+			     ctf_hash_eq_string)) == NULL)
     return ENOMEM;
 
   fp->ctf_txlate = malloc (sizeof (uint32_t) * (fp->ctf_typemax + 1));
-  fp->ctf_ptrtab_len = fp->ctf_typemax + 1;
-  fp->ctf_ptrtab = malloc (sizeof (uint32_t) * fp->ctf_ptrtab_len);
-
-  if (fp->ctf_txlate == NULL || fp->ctf_ptrtab == NULL)
+  if (fp->ctf_txlate == NULL)
     return ENOMEM;		/* Memory allocation failed.  */
+  memset (fp->ctf_txlate, 0, sizeof (uint32_t) * (fp->ctf_typemax + 1));
+
+  if (which & LCTF_LAZY_PTRTAB)
+    {
+      fp->ctf_ptrtab_len = fp->ctf_typemax + 1;
+      fp->ctf_ptrtab = malloc (sizeof (uint32_t) * fp->ctf_ptrtab_len);
+      if (fp->ctf_ptrtab == NULL)
+	return ENOMEM;
+      memset (fp->ctf_ptrtab, 0, sizeof (uint32_t) * fp->ctf_ptrtab_len);
+    }
 
   xp = fp->ctf_txlate;
   *xp++ = 0;			/* Type id 0 is used as a sentinel value.  */
 
-  memset (fp->ctf_txlate, 0, sizeof (uint32_t) * (fp->ctf_typemax + 1));
-  memset (fp->ctf_ptrtab, 0, sizeof (uint32_t) * (fp->ctf_typemax + 1));
-
-  /* In the second pass through the types, we fill in each entry of the
-     type and pointer tables and add names to the appropriate hashes.  */
+  tbuf = (ctf_type_t *) (fp->ctf_buf + cth->cth_typeoff);
+  tend = (ctf_type_t *) (fp->ctf_buf + cth->cth_stroff);
 
   for (id = 1, tp = tbuf; tp < tend; xp++, id++)
     {
       unsigned short kind = LCTF_INFO_KIND (fp, tp->ctt_info);
-      unsigned short isroot = LCTF_INFO_ISROOT (fp, tp->ctt_info);
       unsigned long vlen = LCTF_INFO_VLEN (fp, tp->ctt_info);
       ssize_t size, increment, vbytes;
 
-      const char *name;
-
       (void) ctf_get_ctt_size (fp, tp, &size, &increment);
-      name = ctf_strptr (fp, tp->ctt_name);
       vbytes = LCTF_VBYTES (fp, kind, size, vlen);
 
-      switch (kind)
-	{
-	case CTF_K_INTEGER:
-	case CTF_K_FLOAT:
-	  /* Names are reused by bit-fields, which are differentiated by their
-	     encodings, and so typically we'd record only the first instance of
-	     a given intrinsic.  However, we replace an existing type with a
-	     root-visible version so that we can be sure to find it when
-	     checking for conflicting definitions in ctf_add_type().  */
-
-	  if (((ctf_hash_lookup_type (fp->ctf_names.ctn_readonly,
-				      fp, name)) == 0)
-	      || isroot)
-	    {
-	      err = ctf_hash_define_type (fp->ctf_names.ctn_readonly, fp,
-					  LCTF_INDEX_TO_TYPE (fp, id, child),
-					  tp->ctt_name);
-	      if (err != 0)
-		return err;
-	    }
-	  break;
+      if ((which & ~LCTF_LAZY_TYPES)
+	  && (err = init_type_index (fp, which, id, tp, child)) != 0)
+	return err;
 
-	  /* These kinds have no name, so do not need interning into any
-	     hashtables.  */
-	case CTF_K_ARRAY:
-	case CTF_K_SLICE:
-	  break;
+      *xp = (uint32_t) ((uintptr_t) tp - (uintptr_t) fp->ctf_buf);
+      tp = (ctf_type_t *) ((uintptr_t) tp + increment + vbytes);
+    }
 
-	case CTF_K_FUNCTION:
-	  if (!isroot)
-	    break;
+  if (which & LCTF_LAZY_PTRTAB)
+    init_ptrtab_typedefs (fp, child);
 
-	  err = ctf_hash_insert_type (fp->ctf_names.ctn_readonly, fp,
-				      LCTF_INDEX_TO_TYPE (fp, id, child),
-				      tp->ctt_name);
-	  if (err != 0)
-	    return err;
-	  break;
+  return 0;
+}
 
-	case CTF_K_STRUCT:
-	  if (size >= CTF_LSTRUCT_THRESH)
-	    nlstructs++;
+/* Initialize the type ID translation table with the byte offset of each type,
+   and initialize the hash tables of each named type.  */
 
-	  if (!isroot)
-	    break;
+static int
+init_types (ctf_file_t *fp, ctf_header_t *cth)
+{
+  unsigned long pop[CTF_K_MAX + 1] = { 0 };
+  int err;
 
-	  err = ctf_hash_define_type (fp->ctf_structs.ctn_readonly, fp,
-				      LCTF_INDEX_TO_TYPE (fp, id, child),
-				      tp->ctt_name);
+  /* We make two passes through the entire type section.  In this first
+     pass, we count the number of each type and the total number of types.
+     In the second pass, we fill in each entry of the type and pointer tables
+     and add names to the appropriate hashes.  */
 
-	  if (err != 0)
-	    return err;
+  if ((err = init_types_count (fp, cth, pop)) != 0)
+    return err;
 
-	  break;
+  if ((err = init_types_fill (fp, cth, LCTF_LAZY_ALL, pop)) != 0)
+    return err;
 
-	case CTF_K_UNION:
-	  if (size >= CTF_LSTRUCT_THRESH)
-	    nlunions++;
+  ctf_dprintf ("%lu total types processed\n", fp->ctf_typemax);
+  ctf_dprintf ("%u enum names hashed\n",
+	       ctf_hash_size (fp->ctf_enums.ctn_readonly));
+  ctf_dprintf ("%u struct names hashed\n",
+	       ctf_hash_size (fp->ctf_structs.ctn_readonly));
+  ctf_dprintf ("%u union names hashed\n",
+	       ctf_hash_size (fp->ctf_unions.ctn_readonly));
+  ctf_dprintf ("%u base type names hashed\n",
+	       ctf_hash_size (fp->ctf_names.ctn_readonly));
 
-	  if (!isroot)
-	    break;
+  return 0;
+}
 
-	  err = ctf_hash_define_type (fp->ctf_unions.ctn_readonly, fp,
-				      LCTF_INDEX_TO_TYPE (fp, id, child),
-				      tp->ctt_name);
+/* Initialize the type ID translation table, pointer table and name hashes from
+   the index section, using them in place.  Return nonzero if the index section
+   is unusable, in which case the caller should fall back to init_types().  */
 
-	  if (err != 0)
-	    return err;
-	  break;
+static int
+init_types_from_index (ctf_file_t *fp, ctf_header_t *cth)
+{
+  const unsigned char *idx = fp->ctf_buf + CTF_IDX_OFFSET (cth);
+  size_t idxlen = fp->ctf_size - CTF_IDX_OFFSET (cth);
+  const ctf_idx_header_t *ih = (const ctf_idx_header_t *) idx;
+  ctf_names_t *nps[CTF_IDX_NHASH] = { &fp->ctf_structs, &fp->ctf_unions,
+				      &fp->ctf_enums, &fp->ctf_names };
+  size_t tabsize;
+  uint32_t *txlate, *ptrtab;
+  uint32_t i, next;
+  int err;
 
-	case CTF_K_ENUM:
-	  if (!isroot)
-	    break;
+  if (idxlen < sizeof (ctf_idx_header_t)
+      || ih->cti_ntypes >= idxlen / sizeof (uint32_t))
+    return ECTF_CORRUPT;
 
-	  err = ctf_hash_define_type (fp->ctf_enums.ctn_readonly, fp,
-				      LCTF_INDEX_TO_TYPE (fp, id, child),
-				      tp->ctt_name);
+  tabsize = (ih->cti_ntypes + 1) * sizeof (uint32_t);
+  if ((ih->cti_txlateoff & 3) || (ih->cti_ptrtaboff & 3)
+      || ih->cti_txlateoff > idxlen || idxlen - ih->cti_txlateoff < tabsize
+      || ih->cti_ptrtaboff > idxlen || idxlen - ih->cti_ptrtaboff < tabsize)
+    return ECTF_CORRUPT;
 
-	  if (err != 0)
-	    return err;
-	  break;
+  txlate = (uint32_t *) (idx + ih->cti_txlateoff);
+  ptrtab = (uint32_t *) (idx + ih->cti_ptrtaboff);
 
-	case CTF_K_TYPEDEF:
-	  if (!isroot)
-	    break;
+  /* The index may be stale or crafted, so check that its type offsets walk
+     the type section record by record, exactly as init_types_count() would,
+     before anything indexes types through it.  */
 
-	  err = ctf_hash_insert_type (fp->ctf_names.ctn_readonly, fp,
-				      LCTF_INDEX_TO_TYPE (fp, id, child),
-				      tp->ctt_name);
-	  if (err != 0)
-	    return err;
-	  break;
+  next = cth->cth_typeoff;
+  for (i = 1; i <= ih->cti_ntypes; i++)
+    {
+      const ctf_type_t *tp;
+      ssize_t size, increment, vbytes;
 
-	case CTF_K_FORWARD:
-	  {
-	    ctf_names_t *np = ctf_name_table (fp, tp->ctt_type);
+      if (txlate[i] != next || next >= cth->cth_stroff
+	  || ptrtab[i] > ih->cti_ntypes)
+	return ECTF_CORRUPT;
 
-	    if (!isroot)
-	      break;
+      tp = (const ctf_type_t *) (fp->ctf_buf + txlate[i]);
+      (void) ctf_get_ctt_size (fp, tp, &size, &increment);
+      vbytes = LCTF_VBYTES (fp, LCTF_INFO_KIND (fp, tp->ctt_info), size,
+			    LCTF_INFO_VLEN (fp, tp->ctt_info));
 
-	    /* Only insert forward tags into the given hash if the type or tag
-	       name is not already present.  */
-	    if (ctf_hash_lookup_type (np->ctn_readonly, fp, name) == 0)
-	      {
-		err = ctf_hash_insert_type (np->ctn_readonly, fp,
-					    LCTF_INDEX_TO_TYPE (fp, id, child),
-					    tp->ctt_name);
-		if (err != 0)
-		  return err;
-	      }
-	    break;
-	  }
+      if (vbytes < 0 || (size_t) (increment + vbytes)
+	  > cth->cth_stroff - next)
+	return ECTF_CORRUPT;
+      next += increment + vbytes;
+    }
 
-	case CTF_K_POINTER:
-	  /* If the type referenced by the pointer is in this CTF container,
-	     then store the index of the pointer type in
-	     fp->ctf_ptrtab[ index of referenced type ].  */
+  if (next != cth->cth_stroff)
+    return ECTF_CORRUPT;
 
-	  if (LCTF_TYPE_ISCHILD (fp, tp->ctt_type) == child
-	      && LCTF_TYPE_TO_INDEX (fp, tp->ctt_type) <= fp->ctf_typemax)
-	    fp->ctf_ptrtab[LCTF_TYPE_TO_INDEX (fp, tp->ctt_type)] = id;
-	 /*FALLTHRU*/
+  for (i = 0; i < CTF_IDX_NHASH; i++)
+    {
+      size_t hsize;
 
-	case CTF_K_VOLATILE:
-	case CTF_K_CONST:
-	case CTF_K_RESTRICT:
-	  if (!isroot)
-	    break;
+      if ((ih->cti_hashoff[i] & 3) || ih->cti_hashoff[i] > idxlen
+	  || (nps[i]->ctn_readonly
+	      = ctf_hash_index_open (fp, idx + ih->cti_hashoff[i],
+				     idxlen - ih->cti_hashoff[i], &hsize,
+				     &err)) == NULL)
+	{
+	  while (i-- > 0)
+	    {
+	      ctf_hash_destroy (nps[i]->ctn_readonly);
+	      nps[i]->ctn_readonly = NULL;
+	    }
+	  return ECTF_CORRUPT;
+	}
+    }
 
-	  err = ctf_hash_insert_type (fp->ctf_names.ctn_readonly, fp,
-				      LCTF_INDEX_TO_TYPE (fp, id, child),
-				      tp->ctt_name);
-	  if (err != 0)
-	    return err;
+  fp->ctf_typemax = ih->cti_ntypes;
+  fp->ctf_txlate = txlate;
+  fp->ctf_ptrtab = ptrtab;
+  fp->ctf_ptrtab_len = ih->cti_ntypes + 1;
+  fp->ctf_flags |= LCTF_INDEXED;
+  return 0;
+}
+
+/* Build the packed type descriptor table from the type section, once the
+   type translation table exists.  The table is only an accelerator: if it
+   cannot be allocated, lookups go through ctf_txlate instead.  */
+
+static void
+init_tdescs (ctf_file_t *fp)
+{
+  ctf_tdesc_t *tds;
+  uint32_t id;
+
+  if ((tds = malloc (sizeof (ctf_tdesc_t) * (fp->ctf_typemax + 1))) == NULL)
+    {
+      ctf_dprintf ("Cannot allocate type descriptors: types looked up "
+		   "directly.\n");
+      return;
+    }
+  memset (&tds[0], 0, sizeof (ctf_tdesc_t));
+
+  for (id = 1; id <= fp->ctf_typemax; id++)
+    {
+      const ctf_type_t *tp = LCTF_INDEX_TO_TYPEPTR (fp, id);
+      unsigned short kind = LCTF_INFO_KIND (fp, tp->ctt_info);
+      ssize_t increment;
+
+      (void) ctf_get_ctt_size (fp, tp, NULL, &increment);
+
+      tds[id].ctvt_info = CTF_TYPE_INFO (kind,
+					LCTF_INFO_ISROOT (fp, tp->ctt_info),
+					LCTF_INFO_VLEN (fp, tp->ctt_info));
+      tds[id].ctvt_name = tp->ctt_name;
+      tds[id].ctvt_size = tp->ctt_size;
+      tds[id].ctvt_vdata = fp->ctf_txlate[id] + increment;
+    }
+
+  fp->ctf_view.ctv_version = CTF_VIEW_VERSION;
+  if (fp->ctf_flags & LCTF_CHILD)
+    fp->ctf_view.ctv_flags |= CTF_VIEW_CHILD;
+  fp->ctf_view.ctv_parmax = fp->ctf_parmax;
+  fp->ctf_view.ctv_typemax = fp->ctf_typemax;
+  fp->ctf_view.ctv_types = tds;
+  fp->ctf_view.ctv_type_size = sizeof (ctf_view_type_t);
+  fp->ctf_view.ctv_buf = fp->ctf_buf;
+
+  __atomic_store_n (&fp->ctf_tdescs, tds, __ATOMIC_RELEASE);
+}
+
+/* Build one lazily-constructed index, assuming that all the indexes it
+   depends upon already exist.  Called with the ctf_lazy_lock held.  */
+
+static int
+ctf_lazy_build_one (ctf_file_t *fp, uint32_t which)
+{
+  ctf_header_t *cth = fp->ctf_header;
+  int child = fp->ctf_flags & LCTF_CHILD;
+  ctf_names_t *np;
+  uint32_t id;
+  int err;
+
+  if (which == LCTF_LAZY_TYPES)
+    {
+      unsigned long pop[CTF_K_MAX + 1] = { 0 };
+
+      if ((err = init_types_count (fp, cth, pop)) != 0)
+	return err;
+
+      fp->ctf_structs.ctn_nelems = pop[CTF_K_STRUCT];
+      fp->ctf_unions.ctn_nelems = pop[CTF_K_UNION];
+      fp->ctf_enums.ctn_nelems = pop[CTF_K_ENUM];
+      fp->ctf_names.ctn_nelems = init_types_nnames (pop);
+
+      if ((err = init_types_fill (fp, cth, LCTF_LAZY_TYPES, pop)) != 0)
+	return err;
+
+      init_tdescs (fp);
+      return 0;
+    }
+
+  if (which == LCTF_LAZY_PTRTAB)
+    {
+      fp->ctf_ptrtab_len = fp->ctf_typemax + 1;
+      fp->ctf_ptrtab = malloc (sizeof (uint32_t) * fp->ctf_ptrtab_len);
+      if (fp->ctf_ptrtab == NULL)
+	return ENOMEM;
+      memset (fp->ctf_ptrtab, 0, sizeof (uint32_t) * fp->ctf_ptrtab_len);
+    }
+  else
+    {
+      switch (which)
+	{
+	case LCTF_LAZY_STRUCTS:
+	  np = &fp->ctf_structs;
+	  break;
+	case LCTF_LAZY_UNIONS:
+	  np = &fp->ctf_unions;
+	  break;
+	case LCTF_LAZY_ENUMS:
+	  np = &fp->ctf_enums;
 	  break;
 	default:
-	  ctf_dprintf ("unhandled CTF kind in endianness conversion -- %x\n",
-		       kind);
-	  return ECTF_CORRUPT;
+	  np = &fp->ctf_names;
 	}
 
-      *xp = (uint32_t) ((uintptr_t) tp - (uintptr_t) fp->ctf_buf);
-      tp = (ctf_type_t *) ((uintptr_t) tp + increment + vbytes);
+      if ((np->ctn_readonly = ctf_hash_create (np->ctn_nelems,
+					       ctf_hash_string,
+					       ctf_hash_eq_string)) == NULL)
+	return ENOMEM;
     }
 
-  ctf_dprintf ("%lu total types processed\n", fp->ctf_typemax);
-  ctf_dprintf ("%u enum names hashed\n",
-	       ctf_hash_size (fp->ctf_enums.ctn_readonly));
-  ctf_dprintf ("%u struct names hashed (%d long)\n",
-	       ctf_hash_size (fp->ctf_structs.ctn_readonly), nlstructs);
-  ctf_dprintf ("%u union names hashed (%d long)\n",
-	       ctf_hash_size (fp->ctf_unions.ctn_readonly), nlunions);
-  ctf_dprintf ("%u base type names hashed\n",
-	       ctf_hash_size (fp->ctf_names.ctn_readonly));
+  for (id = 1; id <= fp->ctf_typemax; id++)
+    if ((err = init_type_index (fp, which, id,
+				LCTF_INDEX_TO_TYPEPTR (fp, id), child)) != 0)
+      return err;
 
-  /* Make an additional pass through the pointer table to find pointers that
-     point to anonymous typedef nodes.  If we find one, modify the pointer table
-     so that the pointer is also known to point to the node that is referenced
-     by the anonymous typedef node.  */
+  if (which == LCTF_LAZY_PTRTAB)
+    init_ptrtab_typedefs (fp, child);
 
-  for (id = 1; id <= fp->ctf_typemax; id++)
+  ctf_dprintf ("Lazily built index %x of CTF container %p\n", which,
+	       (void *) fp);
+  return 0;
+}
+
+/* Build whichever of the lazily-constructed indexes in WHICH (and the
+   indexes they depend upon) do not yet exist.  Concurrent callers wait for
+   each other.  If a build fails, the error is remembered and returned by all
+   future calls.  */
+
+int
+ctf_lazy_build (ctf_file_t *fp, uint32_t which)
+{
+  uint32_t bit;
+  int err = 0;
+
+  if (!(fp->ctf_flags & LCTF_LAZY))
+    return 0;
+
+  which |= LCTF_LAZY_TYPES;
+
+  pthread_mutex_lock (&fp->ctf_lazy_lock);
+  if ((err = fp->ctf_lazy_err) != 0)
+    goto out;
+
+  for (bit = LCTF_LAZY_TYPES; bit & LCTF_LAZY_ALL; bit <<= 1)
     {
-      if ((dst = fp->ctf_ptrtab[id]) != 0)
-	{
-	  tp = LCTF_INDEX_TO_TYPEPTR (fp, id);
+      if (!(which & bit) || !(fp->ctf_lazy & bit))
+	continue;
 
-	  if (LCTF_INFO_KIND (fp, tp->ctt_info) == CTF_K_TYPEDEF
-	      && strcmp (ctf_strptr (fp, tp->ctt_name), "") == 0
-	      && LCTF_TYPE_ISCHILD (fp, tp->ctt_type) == child
-	      && LCTF_TYPE_TO_INDEX (fp, tp->ctt_type) <= fp->ctf_typemax)
-	      fp->ctf_ptrtab[LCTF_TYPE_TO_INDEX (fp, tp->ctt_type)] = dst;
+      if ((err = ctf_lazy_build_one (fp, bit)) != 0)
+	{
+	  fp->ctf_lazy_err = err;
+	  goto out;
 	}
+      __atomic_and_fetch (&fp->ctf_lazy, ~bit, __ATOMIC_RELEASE);
     }
 
-  return 0;
+ out:
+  pthread_mutex_unlock (&fp->ctf_lazy_lock);
+  if (err != 0)
+    ctf_set_errno (fp, err);
+  return err;
 }
 
 /* Endianness-flipping routines.
@@ -1419,6 +1823,7 @@ ctf_bufopen_internal (const ctf_sect_t *ctfsect, const ctf_sect_t *symsect,
     return (ctf_set_open_errno (errp, ENOMEM));
 
   memset (fp, 0, sizeof (ctf_file_t));
+  ctf_tcache_newgen (fp);
 
   if (writable)
     fp->ctf_flags |= LCTF_RDWR;
@@ -1464,6 +1869,31 @@ ctf_bufopen_internal (const ctf_sect_t *ctfsect, const ctf_sect_t *symsect,
       || (hp->cth_typeoff & 3))
     return (ctf_set_open_errno (errp, ECTF_CORRUPT));
 
+  /* An index trailing the string table is only used in place, so is only of
+     use in native-endian, uncompressed v3 containers.  Anywhere else, forget
+     it: it is not covered by the decompressed or flipped buffer, and must not
+     be written out again alongside data it no longer describes.  */
+
+  if (hp->cth_flags & CTF_F_IDX)
+    {
+      size_t idxoff = CTF_IDX_OFFSET (hp);
+      const ctf_idx_header_t *ih;
+
+      ih = (const ctf_idx_header_t *) ((unsigned char *) ctfsect->cts_data
+				       + hdrsz + idxoff);
+
+      if (!foreign_endian && !(hp->cth_flags & CTF_F_COMPRESS)
+	  && pp->ctp_version == CTF_VERSION_3
+	  && ctfsect->cts_size >= hdrsz + idxoff + sizeof (ctf_idx_header_t)
+	  && ih->cti_ntypes <= (ctfsect->cts_size - hdrsz - idxoff
+				- sizeof (ctf_idx_header_t)) / sizeof (uint32_t)
+	  && ih->cti_size >= sizeof (ctf_idx_header_t)
+	  && ih->cti_size <= ctfsect->cts_size - hdrsz - idxoff)
+	fp->ctf_size = idxoff + ih->cti_size;
+      else
+	hp->cth_flags &= ~CTF_F_IDX;
+    }
+
   /* Once everything is determined to be valid, attempt to decompress the CTF
      data buffer if it is compressed, or copy it into new storage if it is not
      compressed but needs endian-flipping.  Otherwise we just put the data
@@ -1601,20 +2031,47 @@ ctf_bufopen_internal (const ctf_sect_t *ctfsect, const ctf_sect_t *symsect,
   ctf_set_base (fp, hp, fp->ctf_base);
 
   /* No need to do anything else for dynamic containers: they do not support
-     symbol lookups, and the type table is maintained in the dthashes.  */
+     symbol lookups, and the type table is maintained in the ctf_dtvec.  */
   if (fp->ctf_flags & LCTF_RDWR)
     {
       fp->ctf_refcnt = 1;
       return fp;
     }
 
-  if ((err = init_types (fp, hp)) != 0)
+  /* We determine whether the container is a child or a parent based on
+     the value of cth_parname.  */
+
+  if (hp->cth_parname != 0)
+    {
+      ctf_dprintf ("CTF container %p is a child\n", (void *) fp);
+      fp->ctf_flags |= LCTF_CHILD;
+    }
+  else
+    ctf_dprintf ("CTF container %p is a parent\n", (void *) fp);
+
+  /* Use the index section if there is one and it is usable.  Otherwise, build
+     the type indexes now, unless asked to defer them until they are needed.
+     Containers needing upgrade are always initialized at once, since the
+     upgrade reallocates the buffer everything else points into.  */
+
+  if ((hp->cth_flags & CTF_F_IDX) && init_types_from_index (fp, hp) == 0)
+    ctf_dprintf ("%lu types indexed by the CTF index section\n",
+		 fp->ctf_typemax);
+  else if (_libctf_lazy && fp->ctf_version != CTF_VERSION_1)
+    {
+      fp->ctf_flags |= LCTF_LAZY;
+      fp->ctf_lazy = LCTF_LAZY_ALL;
+      pthread_mutex_init (&fp->ctf_lazy_lock, NULL);
+    }
+  else if ((err = init_types (fp, hp)) != 0)
     goto bad;
 
-  /* If we have a symbol table section, allocate and initialize
-     the symtab translation table, pointed to by ctf_sxlate.  This table may be
-     too large for the actual size of the object and function info sections: if
-     so, ctf_nsyms will be adjusted and the excess will never be used.  */
+  if (!(fp->ctf_flags & LCTF_LAZY))
+    init_tdescs (fp);
+
+  /* If we have a symbol table section, allocate the symtab translation table,
+     pointed to by ctf_sxlate.  It is filled in on demand by
+     ctf_sxlate_build().  */
 
   if (symsect != NULL)
     {
@@ -1626,9 +2083,7 @@ ctf_bufopen_internal (const ctf_sect_t *ctfsect, const ctf_sect_t *symsect,
 	  err = ENOMEM;
 	  goto bad;
 	}
-
-      if ((err = init_symtab (fp, hp, symsect, strsect)) != 0)
-	goto bad;
+      pthread_mutex_init (&fp->ctf_sxlate_lock, NULL);
     }
 
   ctf_set_ctl_hashes (fp);
@@ -1683,7 +2138,8 @@ ctf_file_close (ctf_file_t *fp)
       ntd = ctf_list_next (dtd);
       ctf_dtd_delete (fp, dtd);
     }
-  ctf_dynhash_destroy (fp->ctf_dthash);
+  free (fp->ctf_dtvec);
+  ctf_tcache_clear (fp);
   if (fp->ctf_flags & LCTF_RDWR)
     {
       ctf_dynhash_destroy (fp->ctf_structs.ctn_writable);
@@ -1698,6 +2154,7 @@ ctf_file_close (ctf_file_t *fp)
       ctf_hash_destroy (fp->ctf_enums.ctn_readonly);
       ctf_hash_destroy (fp->ctf_names.ctn_readonly);
     }
+  ctf_hash_destroy (fp->ctf_varhash);
 
   for (dvd = ctf_list_next (&fp->ctf_dvdefs); dvd != NULL; dvd = nvd)
     {
@@ -1706,7 +2163,6 @@ ctf_file_close (ctf_file_t *fp)
     }
   ctf_dynhash_destroy (fp->ctf_dvhash);
   ctf_str_free_atoms (fp);
-  free (fp->ctf_tmp_typeslice);
 
   if (fp->ctf_data.cts_name != _CTF_NULLSTR)
     free ((char *) fp->ctf_data.cts_name);
@@ -1728,9 +2184,21 @@ ctf_file_close (ctf_file_t *fp)
   ctf_dynhash_destroy (fp->ctf_link_cu_mapping);
   ctf_dynhash_destroy (fp->ctf_add_processing);
 
+  if (fp->ctf_sxlate != NULL)
+    pthread_mutex_destroy (&fp->ctf_sxlate_lock);
   free (fp->ctf_sxlate);
-  free (fp->ctf_txlate);
-  free (fp->ctf_ptrtab);
+  free (fp->ctf_symnames);
+  free (fp->ctf_addrs);
+  free (fp->ctf_funcrefs);
+  free (fp->ctf_tdescs);
+  if (!(fp->ctf_flags & LCTF_INDEXED))
+    {
+      free (fp->ctf_txlate);
+      free (fp->ctf_ptrtab);
+    }
+
+  if (fp->ctf_flags & LCTF_LAZY)
+    pthread_mutex_destroy (&fp->ctf_lazy_lock);
 
   free (fp->ctf_header);
   free (fp);
@@ -1841,9 +2309,14 @@ ctf_import (ctf_file_t *fp, ctf_file_t *pfp)
   if (pfp != NULL && pfp->ctf_dmodel != fp->ctf_dmodel)
     return (ctf_set_errno (fp, ECTF_DMODEL));
 
+  /* Types may resolve differently against a different parent, and the base
+     types in the function reference index may be in it.  */
+  ctf_tcache_clear (fp);
+  free (fp->ctf_funcrefs);
+  fp->ctf_funcrefs = NULL;
+
   if (fp->ctf_parent != NULL)
     {
-      fp->ctf_parent->ctf_refcnt--;
       ctf_file_close (fp->ctf_parent);
       fp->ctf_parent = NULL;
     }
@@ -1861,6 +2334,13 @@ ctf_import (ctf_file_t *fp, ctf_file_t *pfp)
     }
 
   fp->ctf_parent = pfp;
+  if (pfp != NULL)
+    fp->ctf_tcache_pgen = pfp->ctf_tcache_gen;
+
+  if (pfp != NULL)
+    fp->ctf_view.ctv_flags |= CTF_VIEW_CHILD;
+  fp->ctf_view.ctv_parent = (pfp != NULL && !(pfp->ctf_flags & LCTF_RDWR))
+    ? &pfp->ctf_view : NULL;
   return 0;
 }
 
@@ -1874,7 +2354,11 @@ ctf_setmodel (ctf_file_t *fp, int model)
     {
       if (dp->ctd_code == model)
 	{
+	  if (fp->ctf_dmodel != dp)
+	    ctf_tcache_clear_sizes (fp);
 	  fp->ctf_dmodel = dp;
+	  fp->ctf_view.ctv_pointer_size = dp->ctd_pointer;
+	  fp->ctf_view.ctv_int_size = dp->ctd_int;
 	  return 0;
 	}
     }
@@ -1889,6 +2373,43 @@ ctf_getmodel (ctf_file_t *fp)
   return fp->ctf_dmodel->ctd_code;
 }
 
+/* Return the view of a read-only container, building its types first if they
+   are built lazily, and those of its parent, so that the view is complete.  */
+const ctf_view_t *
+ctf_view (ctf_file_t *fp, int version)
+{
+  ctf_file_t *pfp = fp->ctf_parent;
+
+  if (version < 1 || version > CTF_VIEW_VERSION)
+    {
+      (void) ctf_set_errno (fp, ECTF_VIEWVERS);
+      return NULL;
+    }
+
+  if (fp->ctf_flags & LCTF_RDWR)
+    {
+      (void) ctf_set_errno (fp, ECTF_NOVIEW);
+      return NULL;
+    }
+
+  if (ctf_lazy_need (fp, LCTF_LAZY_TYPES) != 0)
+    return NULL;		/* errno is set for us.  */
+
+  /* A parent whose types cannot be built is merely left out of the view:
+     lookups of its types will go through the library and fail there.  */
+
+  if (pfp != NULL && !(pfp->ctf_flags & LCTF_RDWR))
+    (void) ctf_lazy_need (pfp, LCTF_LAZY_TYPES);
+
+  if (fp->ctf_view.ctv_types == NULL)
+    {
+      (void) ctf_set_errno (fp, ENOMEM);
+      return NULL;
+    }
+
+  return &fp->ctf_view;
+}
+
 /* The caller can hang an arbitrary pointer off each ctf_file_t using this
    function.  */
 void
@@ -1903,3 +2424,35 @@ ctf_getspecific (ctf_file_t *fp)
 {
   return fp->ctf_specific;
 }
+
+/* Turn caching of formatted type names by ctf_type_aname(), ctf_type_lname()
+   and ctf_type_name() on or off.  Names of types in read-only containers are
+   cached in the container they are in, the first time they are formatted,
+   until ctf_import() is called: this suits callers that name the same types
+   over and over.  Must not be called while other threads are using FP.  */
+void
+ctf_setnamecache (ctf_file_t *fp, int cache)
+{
+  size_t i;
+
+  if (cache)
+    {
+      fp->ctf_flags |= LCTF_NAMECACHE;
+      return;
+    }
+
+  fp->ctf_flags &= ~LCTF_NAMECACHE;
+  if (fp->ctf_tcache != NULL && !(fp->ctf_flags & LCTF_RDWR))
+    for (i = 0; i <= fp->ctf_typemax; i++)
+      {
+	free (fp->ctf_tcache[i].ctc_name);
+	fp->ctf_tcache[i].ctc_name = NULL;
+      }
+}
+
+/* Return whether formatted type names are cached.  */
+int
+ctf_getnamecache (ctf_file_t *fp)
+{
+  return (fp->ctf_flags & LCTF_NAMECACHE) != 0;
+}
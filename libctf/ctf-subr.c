@@ -18,6 +18,7 @@
 
 int _libctf_version = CTF_VERSION;	      /* Library client version.  */
 int _libctf_debug = 0;			      /* Debugging messages enabled.  */
+int _libctf_lazy = 0;			      /* Build indexes on demand.  */
 
 /* Private, read-only mmap from a file, with fallback to copying.
 
@@ -170,6 +171,24 @@ int ctf_getdebug (void)
   return _libctf_debug;
 }
 
+/* Set whether containers opened from now on build their type-offset table,
+   pointer table and name hashes when first needed rather than at open time.
+   Lazy opening makes opening a container cost little more than validating its
+   header, at the expense of a short pause the first time each index is used,
+   and of reporting corruption in the type section only when it is first
+   looked at.  */
+
+void ctf_setlazy (int lazy)
+{
+  _libctf_lazy = lazy;
+  ctf_dprintf ("CTF lazy opening set to %i\n", lazy);
+}
+
+int ctf_getlazy (void)
+{
+  return _libctf_lazy;
+}
+
 _libctf_printflike_ (1, 2)
 void ctf_dprintf (const char *format, ...)
 {
@@ -24,6 +24,21 @@ ctf_type_ischild (ctf_file_t * fp, ctf_id_t id)
   return (LCTF_TYPE_ISCHILD (fp, id));
 }
 
+/* Private flags in ctf_next_t.cnx_flags.  */
+
+#define LCTF_NEXT_DYNAMIC	0x1	/* Elements are dynamic (a ctf_list_t).  */
+#define LCTF_NEXT_LMEMBERS	0x2	/* Members are ctf_lmember_t's.  */
+
+/* End an iteration with the iteration state IT on FP, resetting IT for
+   reuse.  */
+
+static unsigned long
+ctf_next_end (ctf_file_t *fp, ctf_next_t *it)
+{
+  memset (it, 0, sizeof (ctf_next_t));
+  return (ctf_set_errno (fp, ECTF_NEXT_END));
+}
+
 /* Iterate over the members of a STRUCT or UNION.  We pass the name, member
    type, and offset of each member to the specified callback function.  */
 
@@ -93,6 +108,106 @@ ctf_member_iter (ctf_file_t *fp, ctf_id_t type, ctf_member_f *func, void *arg)
   return 0;
 }
 
+/* Return the next member of a STRUCT or UNION, with its name in *NAME and its
+   type in *MEMBTYPE, if they are non-NULL, and return its offset.  IT holds
+   the iteration state, and TYPE must be the same on every call.  At the end,
+   return -1 with the error ECTF_NEXT_END.  */
+
+ssize_t
+ctf_member_next (ctf_file_t *fp, ctf_id_t type, ctf_next_t *it,
+		 const char **name, ctf_id_t *membtype)
+{
+  ctf_file_t *ofp = fp;
+  ssize_t offset;
+
+  if (it->cnx_fp == NULL)
+    {
+      const ctf_type_t *tp;
+      ctf_dtdef_t *dtd;
+      ssize_t size, increment;
+      uint32_t kind;
+      ctf_id_t rtype;
+
+      if ((rtype = ctf_type_resolve (fp, type)) == CTF_ERR)
+	return -1;		/* errno is set for us.  */
+
+      if ((tp = ctf_lookup_by_id (&fp, rtype)) == NULL)
+	return -1;		/* errno is set for us.  */
+
+      (void) ctf_get_ctt_size (fp, tp, &size, &increment);
+      kind = LCTF_INFO_KIND (fp, tp->ctt_info);
+
+      if (kind != CTF_K_STRUCT && kind != CTF_K_UNION)
+	return (ctf_set_errno (ofp, ECTF_NOTSOU));
+
+      it->cnx_type = type;
+      it->cnx_flags = 0;
+
+      if ((dtd = ctf_dynamic_type (fp, rtype)) != NULL)
+	{
+	  it->cnx_ptr = ctf_list_next (&dtd->dtd_u.dtu_members);
+	  it->cnx_flags |= LCTF_NEXT_DYNAMIC;
+	}
+      else
+	{
+	  it->cnx_ptr = (const void *) ((uintptr_t) tp + increment);
+	  it->cnx_n = LCTF_INFO_VLEN (fp, tp->ctt_info);
+	  if (size >= CTF_LSTRUCT_THRESH)
+	    it->cnx_flags |= LCTF_NEXT_LMEMBERS;
+	}
+      it->cnx_fp = fp;
+    }
+  else if (it->cnx_type != type)
+    return (ctf_set_errno (ofp, EINVAL));
+
+  fp = it->cnx_fp;
+
+  if (it->cnx_flags & LCTF_NEXT_DYNAMIC)
+    {
+      const ctf_dmdef_t *dmd = it->cnx_ptr;
+
+      if (dmd == NULL)
+	return (ctf_next_end (ofp, it));
+
+      if (name != NULL)
+	*name = dmd->dmd_name;
+      if (membtype != NULL)
+	*membtype = dmd->dmd_type;
+      offset = dmd->dmd_offset;
+      it->cnx_ptr = ctf_list_next (dmd);
+      return offset;
+    }
+
+  if (it->cnx_n == 0)
+    return (ctf_next_end (ofp, it));
+
+  if (it->cnx_flags & LCTF_NEXT_LMEMBERS)
+    {
+      const ctf_lmember_t *lmp = it->cnx_ptr;
+
+      if (name != NULL)
+	*name = ctf_strptr (fp, lmp->ctlm_name);
+      if (membtype != NULL)
+	*membtype = lmp->ctlm_type;
+      offset = (ssize_t) CTF_LMEM_OFFSET (lmp);
+      it->cnx_ptr = lmp + 1;
+    }
+  else
+    {
+      const ctf_member_t *mp = it->cnx_ptr;
+
+      if (name != NULL)
+	*name = ctf_strptr (fp, mp->ctm_name);
+      if (membtype != NULL)
+	*membtype = mp->ctm_type;
+      offset = mp->ctm_offset;
+      it->cnx_ptr = mp + 1;
+    }
+  it->cnx_n--;
+
+  return offset;
+}
+
 /* Iterate over the members of an ENUM.  We pass the string name and associated
    integer value of each enum element to the specified callback function.  */
 
@@ -144,15 +259,111 @@ ctf_enum_iter (ctf_file_t *fp, ctf_id_t type, ctf_enum_f *func, void *arg)
   return 0;
 }
 
+/* Return the next enumerator of an ENUM, with its value in *VALP if VALP is
+   non-NULL, and return its name.  IT holds the iteration state, and TYPE must
+   be the same on every call.  At the end, return NULL with the error
+   ECTF_NEXT_END.  */
+
+const char *
+ctf_enum_next (ctf_file_t *fp, ctf_id_t type, ctf_next_t *it, int *valp)
+{
+  ctf_file_t *ofp = fp;
+  const char *name;
+
+  if (it->cnx_fp == NULL)
+    {
+      const ctf_type_t *tp;
+      ctf_dtdef_t *dtd;
+      ssize_t increment;
+      ctf_id_t rtype;
+
+      if ((rtype = ctf_type_resolve_unsliced (fp, type)) == CTF_ERR)
+	return NULL;		/* errno is set for us.  */
+
+      if ((tp = ctf_lookup_by_id (&fp, rtype)) == NULL)
+	return NULL;		/* errno is set for us.  */
+
+      if (LCTF_INFO_KIND (fp, tp->ctt_info) != CTF_K_ENUM)
+	{
+	  (void) ctf_set_errno (ofp, ECTF_NOTENUM);
+	  return NULL;
+	}
+
+      (void) ctf_get_ctt_size (fp, tp, NULL, &increment);
+
+      it->cnx_type = type;
+      it->cnx_flags = 0;
+
+      if ((dtd = ctf_dynamic_type (ofp, rtype)) != NULL)
+	{
+	  it->cnx_ptr = ctf_list_next (&dtd->dtd_u.dtu_members);
+	  it->cnx_flags |= LCTF_NEXT_DYNAMIC;
+	}
+      else
+	{
+	  it->cnx_ptr = (const void *) ((uintptr_t) tp + increment);
+	  it->cnx_n = LCTF_INFO_VLEN (fp, tp->ctt_info);
+	}
+      it->cnx_fp = fp;
+    }
+  else if (it->cnx_type != type)
+    {
+      (void) ctf_set_errno (ofp, EINVAL);
+      return NULL;
+    }
+
+  fp = it->cnx_fp;
+
+  if (it->cnx_flags & LCTF_NEXT_DYNAMIC)
+    {
+      const ctf_dmdef_t *dmd = it->cnx_ptr;
+
+      if (dmd == NULL)
+	{
+	  (void) ctf_next_end (ofp, it);
+	  return NULL;
+	}
+
+      if (valp != NULL)
+	*valp = dmd->dmd_value;
+      name = dmd->dmd_name;
+      it->cnx_ptr = ctf_list_next (dmd);
+      return name;
+    }
+
+  if (it->cnx_n == 0)
+    {
+      (void) ctf_next_end (ofp, it);
+      return NULL;
+    }
+
+  {
+    const ctf_enum_t *ep = it->cnx_ptr;
+
+    if (valp != NULL)
+      *valp = ep->cte_value;
+    name = ctf_strptr (fp, ep->cte_name);
+    it->cnx_ptr = ep + 1;
+    it->cnx_n--;
+  }
+
+  return name;
+}
+
 /* Iterate over every root (user-visible) type in the given CTF container.
    We pass the type ID of each type to the specified callback function.  */
 
 int
 ctf_type_iter (ctf_file_t *fp, ctf_type_f *func, void *arg)
 {
-  ctf_id_t id, max = fp->ctf_typemax;
+  ctf_id_t id, max;
   int rc, child = (fp->ctf_flags & LCTF_CHILD);
 
+  if (ctf_lazy_need (fp, LCTF_LAZY_TYPES) != 0)
+    return -1;			/* errno is set for us.  */
+
+  max = fp->ctf_typemax;
+
   for (id = 1; id <= max; id++)
     {
       const ctf_type_t *tp = LCTF_INDEX_TO_TYPEPTR (fp, id);
@@ -170,9 +381,14 @@ ctf_type_iter (ctf_file_t *fp, ctf_type_f *func, void *arg)
 int
 ctf_type_iter_all (ctf_file_t *fp, ctf_type_all_f *func, void *arg)
 {
-  ctf_id_t id, max = fp->ctf_typemax;
+  ctf_id_t id, max;
   int rc, child = (fp->ctf_flags & LCTF_CHILD);
 
+  if (ctf_lazy_need (fp, LCTF_LAZY_TYPES) != 0)
+    return -1;			/* errno is set for us.  */
+
+  max = fp->ctf_typemax;
+
   for (id = 1; id <= max; id++)
     {
       const ctf_type_t *tp = LCTF_INDEX_TO_TYPEPTR (fp, id);
@@ -185,6 +401,162 @@ ctf_type_iter_all (ctf_file_t *fp, ctf_type_all_f *func, void *arg)
   return 0;
 }
 
+/* Return the next type in the given CTF container, and whether it is a root
+   type in *FLAG if FLAG is non-NULL.  Non-root types are skipped unless
+   WANT_HIDDEN.  IT holds the iteration state.  At the end, return CTF_ERR with
+   the error ECTF_NEXT_END.  */
+
+ctf_id_t
+ctf_type_next (ctf_file_t *fp, ctf_next_t *it, int *flag, int want_hidden)
+{
+  int child = (fp->ctf_flags & LCTF_CHILD);
+
+  if (it->cnx_fp == NULL)
+    {
+      if (ctf_lazy_need (fp, LCTF_LAZY_TYPES) != 0)
+	return CTF_ERR;		/* errno is set for us.  */
+
+      it->cnx_n = 1;
+      it->cnx_flags = 0;
+      it->cnx_fp = fp;
+    }
+  else if (it->cnx_fp != fp)
+    return (ctf_set_errno (fp, EINVAL));
+
+  while (it->cnx_n <= fp->ctf_typemax)
+    {
+      ctf_id_t id = it->cnx_n++;
+      const ctf_type_t *tp = LCTF_INDEX_TO_TYPEPTR (fp, id);
+      int root = LCTF_INFO_ISROOT (fp, tp->ctt_info);
+
+      if (!root && !want_hidden)
+	continue;
+
+      if (flag != NULL)
+	*flag = root ? CTF_ADD_ROOT : CTF_ADD_NONROOT;
+      return LCTF_INDEX_TO_TYPE (fp, id, child);
+    }
+
+  return (ctf_next_end (fp, it));
+}
+
+/* The kind index, listing the type indexes of each kind in a container, so
+   that callers interested only in types of a few kinds need not look at every
+   type.  It is built on first use, and thrown away whenever a type is added or
+   removed or changes kind.  It is a single allocation holding all the type
+   indexes in the container, partitioned by kind and in ascending order within
+   each kind.  */
+
+struct ctf_kindidx
+{
+  uint32_t cki_start[CTF_K_MAX + 2]; /* Start of each kind in cki_types.  */
+  uint32_t cki_types[1];	/* Type indexes.  */
+};
+
+/* Build the kind index for FP.  */
+
+static ctf_kindidx_t *
+ctf_kind_index_build (ctf_file_t *fp)
+{
+  uint32_t pop[CTF_K_MAX + 1] = { 0 };
+  ctf_kindidx_t *ki;
+  ctf_id_t id, max = fp->ctf_typemax;
+  uint32_t kind, n = 0;
+
+  for (id = 1; id <= max; id++)
+    pop[LCTF_INFO_KIND (fp, LCTF_INDEX_TO_TYPEPTR (fp, id)->ctt_info)
+	& CTF_K_MAX]++;
+
+  if ((ki = malloc (sizeof (ctf_kindidx_t) + max * sizeof (uint32_t))) == NULL)
+    return NULL;
+
+  for (kind = 0; kind <= CTF_K_MAX; kind++)
+    {
+      ki->cki_start[kind] = n;
+      n += pop[kind];
+      pop[kind] = ki->cki_start[kind];
+    }
+  ki->cki_start[CTF_K_MAX + 1] = n;
+
+  for (id = 1; id <= max; id++)
+    {
+      kind = LCTF_INFO_KIND (fp, LCTF_INDEX_TO_TYPEPTR (fp, id)->ctt_info);
+      ki->cki_types[pop[kind & CTF_K_MAX]++] = id;
+    }
+
+  return ki;
+}
+
+/* Return the kind index for FP, building it if need be.  */
+
+static const ctf_kindidx_t *
+ctf_kind_index (ctf_file_t *fp)
+{
+  ctf_kindidx_t *ki, *expected = NULL;
+
+  if ((ki = __atomic_load_n (&fp->ctf_kinds, __ATOMIC_ACQUIRE)) != NULL)
+    return ki;
+
+  if (ctf_lazy_need (fp, LCTF_LAZY_TYPES) != 0)
+    return NULL;		/* errno is set for us.  */
+
+  if ((ki = ctf_kind_index_build (fp)) == NULL)
+    {
+      (void) ctf_set_errno (fp, ENOMEM);
+      return NULL;
+    }
+
+  if (!__atomic_compare_exchange_n (&fp->ctf_kinds, &expected, ki, 0,
+				    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      free (ki);
+      ki = expected;
+    }
+  return ki;
+}
+
+/* Throw away the kind index of FP, because a type has been added or removed
+   or has changed kind.  Only for use on containers not shared between
+   threads.  */
+
+void
+ctf_kinds_invalidate (ctf_file_t *fp)
+{
+  free (fp->ctf_kinds);
+  fp->ctf_kinds = NULL;
+}
+
+/* Iterate over every type of the given KIND in the given CTF container,
+   user-visible or not, in type ID order.  We pass the type ID of each type to
+   the specified callback function.  */
+
+int
+ctf_type_iter_kind (ctf_file_t *fp, int kind, ctf_type_all_f *func, void *arg)
+{
+  const ctf_kindidx_t *ki;
+  uint32_t i;
+  int rc, child = (fp->ctf_flags & LCTF_CHILD);
+
+  if (kind < 0 || kind > CTF_K_MAX)
+    return (ctf_set_errno (fp, EINVAL));
+
+  if ((ki = ctf_kind_index (fp)) == NULL)
+    return -1;			/* errno is set for us.  */
+
+  for (i = ki->cki_start[kind]; i < ki->cki_start[kind + 1]; i++)
+    {
+      ctf_id_t id = ki->cki_types[i];
+      const ctf_type_t *tp = LCTF_INDEX_TO_TYPEPTR (fp, id);
+
+      if ((rc = func (LCTF_INDEX_TO_TYPE (fp, id, child),
+		      LCTF_INFO_ISROOT (fp, tp->ctt_info)
+		      ? CTF_ADD_ROOT : CTF_ADD_NONROOT, arg)) != 0)
+	return rc;
+    }
+
+  return 0;
+}
+
 /* Iterate over every variable in the given CTF container, in arbitrary order.
    We pass the name of each variable to the specified callback function.  */
 
@@ -219,12 +591,253 @@ ctf_variable_iter (ctf_file_t *fp, ctf_variable_f *func, void *arg)
   return 0;
 }
 
+/* Return the type of the next variable in the given CTF container, with its
+   name in *NAME if NAME is non-NULL.  IT holds the iteration state.  At the
+   end, return CTF_ERR with the error ECTF_NEXT_END.  */
+
+ctf_id_t
+ctf_variable_next (ctf_file_t *fp, ctf_next_t *it, const char **name)
+{
+  ctf_id_t type;
+
+  if (it->cnx_fp == NULL)
+    {
+      if ((fp->ctf_flags & LCTF_CHILD) && (fp->ctf_parent == NULL))
+	return (ctf_set_errno (fp, ECTF_NOPARENT));
+
+      it->cnx_flags = 0;
+      if (fp->ctf_flags & LCTF_RDWR)
+	{
+	  it->cnx_ptr = ctf_list_next (&fp->ctf_dvdefs);
+	  it->cnx_flags |= LCTF_NEXT_DYNAMIC;
+	}
+      else
+	it->cnx_n = 0;
+      it->cnx_fp = fp;
+    }
+  else if (it->cnx_fp != fp)
+    return (ctf_set_errno (fp, EINVAL));
+
+  if (it->cnx_flags & LCTF_NEXT_DYNAMIC)
+    {
+      const ctf_dvdef_t *dvd = it->cnx_ptr;
+
+      if (dvd == NULL)
+	return (ctf_next_end (fp, it));
+
+      if (name != NULL)
+	*name = dvd->dvd_name;
+      type = dvd->dvd_type;
+      it->cnx_ptr = ctf_list_next (dvd);
+      return type;
+    }
+
+  if (it->cnx_n >= fp->ctf_nvars)
+    return (ctf_next_end (fp, it));
+
+  if (name != NULL)
+    *name = ctf_strptr (fp, fp->ctf_vars[it->cnx_n].ctv_name);
+  return fp->ctf_vars[it->cnx_n++].ctv_type;
+}
+
+/* Return the type cache entry for TYPE, which must be a valid type in FP itself
+   (not its parent), allocating the cache if need be.  Return NULL if the cache
+   cannot be allocated: callers should then just compute what they need.
+
+   In read-only containers, the cache covers all types and is allocated
+   at most once, even if several threads race to do so.  In writable containers
+   it grows along with the set of types.  */
+
+ctf_tcache_t *
+ctf_tcache_entry (ctf_file_t *fp, ctf_id_t type)
+{
+  size_t idx = LCTF_TYPE_TO_INDEX (fp, type);
+  ctf_tcache_t *tcache;
+
+  if (fp->ctf_flags & LCTF_RDWR)
+    {
+      if (idx >= fp->ctf_tcache_len)
+	{
+	  size_t new_len = fp->ctf_dtvec_len;
+
+	  if (idx >= new_len)
+	    return NULL;
+
+	  if ((tcache = realloc (fp->ctf_tcache,
+				 new_len * sizeof (ctf_tcache_t))) == NULL)
+	    return NULL;
+	  memset (tcache + fp->ctf_tcache_len, 0,
+		  (new_len - fp->ctf_tcache_len) * sizeof (ctf_tcache_t));
+	  fp->ctf_tcache = tcache;
+	  fp->ctf_tcache_len = new_len;
+	}
+      return &fp->ctf_tcache[idx];
+    }
+
+  if ((tcache = __atomic_load_n (&fp->ctf_tcache, __ATOMIC_ACQUIRE)) == NULL)
+    {
+      ctf_tcache_t *expected = NULL;
+
+      if ((tcache = calloc (fp->ctf_typemax + 1,
+			    sizeof (ctf_tcache_t))) == NULL)
+	return NULL;
+
+      if (!__atomic_compare_exchange_n (&fp->ctf_tcache, &expected, tcache,
+					0, __ATOMIC_ACQ_REL,
+					__ATOMIC_ACQUIRE))
+	{
+	  free (tcache);
+	  tcache = expected;
+	}
+    }
+
+  if (idx > fp->ctf_typemax)
+    return NULL;
+  return &tcache[idx];
+}
+
+/* Throw away everything in the type cache, the enumerator index, the name
+   lookup cache, the parent pointer table and the kind index, because types
+   they describe have been removed or changed.  Only for use on containers not
+   shared between threads.  */
+
+void
+ctf_tcache_clear (ctf_file_t *fp)
+{
+  size_t i, len;
+
+  len = (fp->ctf_flags & LCTF_RDWR) ? fp->ctf_tcache_len : fp->ctf_typemax + 1;
+  if (fp->ctf_tcache != NULL)
+    for (i = 0; i < len; i++)
+      {
+	free (fp->ctf_tcache[i].ctc_index);
+	free (fp->ctf_tcache[i].ctc_name);
+      }
+
+  free (fp->ctf_tcache);
+  fp->ctf_tcache = NULL;
+  fp->ctf_tcache_len = 0;
+  ctf_tcache_newgen (fp);
+
+  free (fp->ctf_enumerators);
+  fp->ctf_enumerators = NULL;
+  free (fp->ctf_ncache);
+  fp->ctf_ncache = NULL;
+  free (fp->ctf_pptrtab);
+  fp->ctf_pptrtab = NULL;
+  ctf_kinds_invalidate (fp);
+}
+
+/* Give FP a new type cache generation, never used by any other container.  */
+
+void
+ctf_tcache_newgen (ctf_file_t *fp)
+{
+  static uint32_t gens;
+
+  fp->ctf_tcache_gen = __atomic_add_fetch (&gens, 1, __ATOMIC_RELAXED);
+}
+
+/* Throw away all cached sizes and alignments, because some type they may
+   depend on has changed, or the data model has.  */
+
+void
+ctf_tcache_clear_sizes (ctf_file_t *fp)
+{
+  size_t i, len;
+
+  len = (fp->ctf_flags & LCTF_RDWR) ? fp->ctf_tcache_len : fp->ctf_typemax + 1;
+  if (fp->ctf_tcache != NULL)
+    for (i = 0; i < len; i++)
+      {
+	fp->ctf_tcache[i].ctc_flags &= ~CTC_DEPENDED;
+	fp->ctf_tcache[i].ctc_size = 0;
+	fp->ctf_tcache[i].ctc_align = 0;
+      }
+  ctf_tcache_newgen (fp);
+}
+
+/* Forget the cached size, alignment and member index of TYPE in the writable
+   container FP, because it has changed, along with any sizes and alignments
+   derived from them.  */
+
+void
+ctf_tcache_invalidate (ctf_file_t *fp, ctf_id_t type)
+{
+  size_t idx = LCTF_TYPE_TO_INDEX (fp, type);
+  ctf_tcache_t *tc;
+
+  if (fp->ctf_tcache == NULL || idx >= fp->ctf_tcache_len)
+    return;
+
+  tc = &fp->ctf_tcache[idx];
+  free (tc->ctc_index);
+  tc->ctc_index = NULL;
+
+  if (tc->ctc_flags & CTC_DEPENDED)
+    ctf_tcache_clear_sizes (fp);
+  else
+    {
+      tc->ctc_size = 0;
+      tc->ctc_align = 0;
+    }
+}
+
+/* Return the type cache entry for the size and alignment of TYPE in FP, as for
+   ctf_tcache_entry(), first discarding cached sizes that may be stale because
+   of changes in the parent.  If DEPENDED, the caller is about to derive another
+   size or alignment from this one.  */
+
+static ctf_tcache_t *
+ctf_tcache_size_entry (ctf_file_t *fp, ctf_id_t type, int depended)
+{
+  ctf_tcache_t *tc;
+
+  if (fp->ctf_parent != NULL
+      && fp->ctf_tcache_pgen != fp->ctf_parent->ctf_tcache_gen)
+    {
+      ctf_tcache_clear_sizes (fp);
+      fp->ctf_tcache_pgen = fp->ctf_parent->ctf_tcache_gen;
+    }
+
+  tc = ctf_tcache_entry (fp, type);
+  if (tc != NULL && depended && (fp->ctf_flags & LCTF_RDWR))
+    tc->ctc_flags |= CTC_DEPENDED;
+  return tc;
+}
+
+/* Return the kind of the given type and, in *REFP, the type it references if
+   it is of a kind that references one, switching *FPP to the container the
+   type is in.  Uses the packed type descriptors if there are any.  */
+
+static int
+ctf_type_kind_ref (ctf_file_t **fpp, ctf_id_t type, uint32_t *refp)
+{
+  const ctf_tdesc_t *td;
+  const ctf_type_t *tp;
+
+  if ((td = ctf_lookup_tdesc (fpp, type)) != NULL)
+    {
+      *refp = td->ctvt_type;
+      return LCTF_TDESC_KIND (td);
+    }
+
+  if ((tp = ctf_lookup_by_id (fpp, type)) == NULL)
+    return -1;			/* errno is set for us.  */
+
+  *refp = tp->ctt_type;
+  return LCTF_INFO_KIND (*fpp, tp->ctt_info);
+}
+
 /* Follow a given type through the graph for TYPEDEF, VOLATILE, CONST, and
    RESTRICT nodes until we reach a "base" type node.  This is useful when
    we want to follow a type ID to a node that has members or a size.  To guard
    against infinite loops, we implement simplified cycle detection and check
    each link against itself, the previous node, and the topmost node.
 
+   The result is cached in the container holding the type, so that later
+   resolutions of the same type are a single load.
+
    Does not drill down through slices to their contained type.  */
 
 ctf_id_t
@@ -232,34 +845,46 @@ ctf_type_resolve (ctf_file_t *fp, ctf_id_t type)
 {
   ctf_id_t prev = type, otype = type;
   ctf_file_t *ofp = fp;
-  const ctf_type_t *tp;
+  ctf_tcache_t *tc;
+  uint32_t resolved, ref;
+  int kind;
 
   if (type == 0)
     return (ctf_set_errno (ofp, ECTF_NONREPRESENTABLE));
 
-  while ((tp = ctf_lookup_by_id (&fp, type)) != NULL)
+  if ((kind = ctf_type_kind_ref (&fp, type, &ref)) < 0)
+    return CTF_ERR;		/* errno is set for us.  */
+
+  if ((tc = ctf_tcache_entry (fp, type)) != NULL
+      && (resolved = __atomic_load_n (&tc->ctc_resolved,
+				      __ATOMIC_RELAXED)) != 0)
+    return resolved;
+
+  do
     {
-      switch (LCTF_INFO_KIND (fp, tp->ctt_info))
+      switch (kind)
 	{
 	case CTF_K_TYPEDEF:
 	case CTF_K_VOLATILE:
 	case CTF_K_CONST:
 	case CTF_K_RESTRICT:
-	  if (tp->ctt_type == type || tp->ctt_type == otype
-	      || tp->ctt_type == prev)
+	  if (ref == type || ref == otype || ref == prev)
 	    {
 	      ctf_dprintf ("type %ld cycle detected\n", otype);
 	      return (ctf_set_errno (ofp, ECTF_CORRUPT));
 	    }
 	  prev = type;
-	  type = tp->ctt_type;
+	  type = ref;
 	  break;
 	default:
+	  if (tc != NULL)
+	    __atomic_store_n (&tc->ctc_resolved, type, __ATOMIC_RELAXED);
 	  return type;
 	}
       if (type == 0)
 	return (ctf_set_errno (ofp, ECTF_NONREPRESENTABLE));
     }
+  while ((kind = ctf_type_kind_ref (&fp, type, &ref)) >= 0);
 
   return CTF_ERR;		/* errno is set for us.  */
 }
@@ -270,7 +895,16 @@ ctf_type_resolve (ctf_file_t *fp, ctf_id_t type)
 ctf_id_t
 ctf_type_resolve_unsliced (ctf_file_t *fp, ctf_id_t type)
 {
+  ctf_file_t *tfp = fp;
   const ctf_type_t *tp;
+  ctf_tcache_t *tc = NULL;
+  uint32_t resolved;
+
+  if (type != 0 && ctf_lookup_by_id (&tfp, type) != NULL
+      && (tc = ctf_tcache_entry (tfp, type)) != NULL
+      && (resolved = __atomic_load_n (&tc->ctc_unsliced,
+				      __ATOMIC_RELAXED)) != 0)
+    return resolved;
 
   if ((type = ctf_type_resolve (fp, type)) == CTF_ERR)
     return -1;
@@ -279,8 +913,14 @@ ctf_type_resolve_unsliced (ctf_file_t *fp, ctf_id_t type)
     return CTF_ERR;		/* errno is set for us.  */
 
   if ((LCTF_INFO_KIND (fp, tp->ctt_info)) == CTF_K_SLICE)
-    return ctf_type_reference (fp, type);
-  return type;
+    {
+      if ((type = ctf_type_reference (fp, type)) == CTF_ERR)
+	return CTF_ERR;		/* errno is set for us.  */
+    }
+
+  if (tc != NULL)
+    __atomic_store_n (&tc->ctc_unsliced, type, __ATOMIC_RELAXED);
+  return type;
 }
 
 /* Look up a name in the given name table, in the appropriate hash given the
@@ -296,40 +936,84 @@ ctf_id_t ctf_lookup_by_rawname (ctf_file_t *fp, int kind, const char *name)
    identifier.  */
 
 ctf_id_t ctf_lookup_by_rawhash (ctf_file_t *fp, ctf_names_t *np, const char *name)
+{
+  return ctf_lookup_by_rawhash_n (fp, np, name, strlen (name));
+}
+
+/* Like ctf_lookup_by_rawhash(), but the name is the first LEN characters of
+   the string NAME.  */
+
+ctf_id_t ctf_lookup_by_rawhash_n (ctf_file_t *fp, ctf_names_t *np,
+				  const char *name, size_t len)
 {
   ctf_id_t id;
 
   if (fp->ctf_flags & LCTF_RDWR)
-    id = (ctf_id_t) ctf_dynhash_lookup (np->ctn_writable, name);
+    {
+      /* The dynhash wants a NUL-terminated key: copy the name onto the stack
+	 if need be, and only into the heap if it is improbably long.  */
+
+      char buf[256];
+      char *key = (char *) name;
+
+      if (name[len] != '\0')
+	{
+	  if (len < sizeof (buf))
+	    key = buf;
+	  else if ((key = malloc (len + 1)) == NULL)
+	    {
+	      (void) ctf_set_errno (fp, ENOMEM);
+	      return 0;
+	    }
+	  memcpy (key, name, len);
+	  key[len] = '\0';
+	}
+
+      id = (ctf_id_t) ctf_dynhash_lookup (np->ctn_writable, key);
+
+      if (key != name && key != buf)
+	free (key);
+    }
   else
-    id = ctf_hash_lookup_type (np->ctn_readonly, fp, name);
+    {
+      uint32_t which = LCTF_LAZY_NAMES;
+
+      if (np == &fp->ctf_structs)
+	which = LCTF_LAZY_STRUCTS;
+      else if (np == &fp->ctf_unions)
+	which = LCTF_LAZY_UNIONS;
+      else if (np == &fp->ctf_enums)
+	which = LCTF_LAZY_ENUMS;
+
+      if (ctf_lazy_need (fp, which) != 0)
+	return 0;		/* errno is set for us.  */
+
+      id = ctf_hash_lookup_type_n (np->ctn_readonly, fp, name, len);
+    }
   return id;
 }
 
-/* Lookup the given type ID and return its name as a new dynamcally-allocated
-   string.  */
+/* Format the name of the given type ID into BUF, truncating it if LEN is too
+   small, and return the length of the whole name, or -1 on error.  */
 
-char *
-ctf_type_aname (ctf_file_t *fp, ctf_id_t type)
+static ssize_t
+ctf_type_format (ctf_file_t *fp, ctf_id_t type, char *buf, size_t len)
 {
   ctf_decl_t cd;
   ctf_decl_node_t *cdp;
   ctf_decl_prec_t prec, lp, rp;
   int ptr, arr;
   uint32_t k;
-  char *buf;
-
-  if (fp == NULL && type == CTF_ERR)
-    return NULL;	/* Simplify caller code by permitting CTF_ERR.  */
+  size_t slen;
 
-  ctf_decl_init (&cd);
+  ctf_decl_init (&cd, buf, len);
   ctf_decl_push (&cd, fp, type);
 
   if (cd.cd_err != 0)
     {
       ctf_decl_fini (&cd);
       ctf_set_errno (fp, cd.cd_err);
-      return NULL;
+      return -1;
     }
 
   /* If the type graph's order conflicts with lexical precedence order
@@ -412,12 +1096,83 @@ ctf_type_aname (ctf_file_t *fp, ctf_id_t type)
 	ctf_decl_sprintf (&cd, ")");
     }
 
-  if (cd.cd_enomem)
-    (void) ctf_set_errno (fp, ENOMEM);
+  slen = ctf_decl_len (&cd);
+  ctf_decl_fini (&cd);
+  return slen;
+}
 
-  buf = ctf_decl_buf (&cd);
+/* Return the type cache entry in which to cache the name of the given type, if
+   FP caches names.  Names are cached in the container the type is in, which
+   must be read-only.  */
+
+static ctf_tcache_t *
+ctf_name_tcache (ctf_file_t *fp, ctf_id_t type)
+{
+  if (!(fp->ctf_flags & LCTF_NAMECACHE)
+      || ctf_lookup_by_id (&fp, type) == NULL
+      || (fp->ctf_flags & LCTF_RDWR))
+    return NULL;
+
+  return ctf_tcache_entry (fp, type);
+}
+
+/* Cache a copy of NAME in TC, unless another thread got there first.  */
+
+static void
+ctf_name_tcache_set (ctf_tcache_t *tc, const char *name)
+{
+  char *expected = NULL;
+  char *str;
+
+  if ((str = strdup (name)) == NULL)
+    return;
+
+  if (!__atomic_compare_exchange_n (&tc->ctc_name, &expected, str, 0,
+				    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    free (str);
+}
+
+/* Lookup the given type ID and return its name as a new dynamcally-allocated
+   string.  Short names are formatted on the stack, and only copied once their
+   length is known.  */
+
+char *
+ctf_type_aname (ctf_file_t *fp, ctf_id_t type)
+{
+  char sbuf[256];
+  ctf_tcache_t *tc;
+  const char *name;
+  ssize_t slen;
+  char *buf;
+
+  if (fp == NULL && type == CTF_ERR)
+    return NULL;	/* Simplify caller code by permitting CTF_ERR.  */
+
+  if ((tc = ctf_name_tcache (fp, type)) != NULL
+      && (name = __atomic_load_n (&tc->ctc_name, __ATOMIC_ACQUIRE)) != NULL)
+    {
+      if ((buf = strdup (name)) == NULL)
+	(void) ctf_set_errno (fp, ENOMEM);
+      return buf;
+    }
+
+  if ((slen = ctf_type_format (fp, type, sbuf, sizeof (sbuf))) < 0)
+    return NULL;		/* errno is set for us.  */
+
+  if ((buf = malloc (slen + 1)) == NULL)
+    {
+      (void) ctf_set_errno (fp, ENOMEM);
+      return NULL;
+    }
+
+  if ((size_t) slen < sizeof (sbuf))
+    memcpy (buf, sbuf, slen + 1);
+  else
+    (void) ctf_type_format (fp, type, buf, slen + 1);
+
+  if (tc != NULL)
+    ctf_name_tcache_set (tc, buf);
 
-  ctf_decl_fini (&cd);
   return buf;
 }
 
@@ -427,17 +1182,26 @@ ctf_type_aname (ctf_file_t *fp, ctf_id_t type)
 ssize_t
 ctf_type_lname (ctf_file_t *fp, ctf_id_t type, char *buf, size_t len)
 {
-  char *str = ctf_type_aname (fp, type);
-  size_t slen;
+  ctf_tcache_t *tc;
+  const char *name;
+  ssize_t slen;
 
-  if (str == NULL)
-    return CTF_ERR;			/* errno is set for us.  */
+  if ((tc = ctf_name_tcache (fp, type)) != NULL
+      && (name = __atomic_load_n (&tc->ctc_name, __ATOMIC_ACQUIRE)) != NULL)
+    {
+      slen = strlen (name);
+      snprintf (buf, len, "%s", name);
+    }
+  else
+    {
+      if ((slen = ctf_type_format (fp, type, buf, len)) < 0)
+	return CTF_ERR;		/* errno is set for us.  */
 
-  slen = strlen (str);
-  snprintf (buf, len, "%s", str);
-  free (str);
+      if (tc != NULL && (size_t) slen < len)
+	ctf_name_tcache_set (tc, buf);
+    }
 
-  if (slen >= len)
+  if ((size_t) slen >= len)
     (void) ctf_set_errno (fp, ECTF_NAMELEN);
 
   return slen;
@@ -453,49 +1217,107 @@ ctf_type_name (ctf_file_t *fp, ctf_id_t type, char *buf, size_t len)
   return (rv >= 0 && (size_t) rv < len ? buf : NULL);
 }
 
+/* Lookup the given type ID and return its raw, unadorned, undecorated name,
+   without copying it.  The name lives in the container's string table (or the
+   parent's), and remains valid until the container is closed, or, if it is
+   writable, until the types added to it are next serialized by ctf_update(),
+   ctf_write() and the like, or the type is removed by ctf_discard() or
+   ctf_rollback().  Anonymous types have the empty string as their name: NULL
+   is returned if the name is in a string table that is not available, such as
+   an external string table that was never provided.  */
+
+const char *
+ctf_type_name_raw (ctf_file_t *fp, ctf_id_t type)
+{
+  ctf_file_t *ofp = fp;
+  const ctf_tdesc_t *td;
+  const ctf_type_t *tp;
+  const char *name;
+  uint32_t ref;
+
+  if ((td = ctf_lookup_tdesc (&fp, type)) != NULL)
+    ref = td->ctvt_name;
+  else if ((tp = ctf_lookup_by_id (&fp, type)) != NULL)
+    ref = tp->ctt_name;
+  else
+    return NULL;		/* errno is set for us.  */
+
+  if ((name = ctf_strraw (fp, ref)) == NULL)
+    (void) ctf_set_errno (ofp, ECTF_STRTAB);
+
+  return name;
+}
+
 /* Lookup the given type ID and return its raw, unadorned, undecorated name as a
    new dynamcally-allocated string.  */
 
 char *
 ctf_type_aname_raw (ctf_file_t *fp, ctf_id_t type)
 {
-  const ctf_type_t *tp;
+  const char *name;
+  char *copy;
 
-  if ((tp = ctf_lookup_by_id (&fp, type)) == NULL)
+  if ((name = ctf_type_name_raw (fp, type)) == NULL)
     return NULL;		/* errno is set for us.  */
 
-  if (ctf_strraw (fp, tp->ctt_name) != NULL)
-    return strdup (ctf_strraw (fp, tp->ctt_name));
+  if ((copy = strdup (name)) == NULL)
+    (void) ctf_set_errno (fp, ENOMEM);
 
-  return NULL;
+  return copy;
 }
 
 /* Resolve the type down to a base type node, and then return the size
-   of the type storage in bytes.  */
+   of the type storage in bytes.  DEPENDED is as for
+   ctf_tcache_size_entry().  */
 
-ssize_t
-ctf_type_size (ctf_file_t *fp, ctf_id_t type)
+static ssize_t
+ctf_type_size_internal (ctf_file_t *fp, ctf_id_t type, int depended)
 {
+  const ctf_tdesc_t *td;
   const ctf_type_t *tp;
-  ssize_t size;
+  ctf_tcache_t *tc;
+  ssize_t size, ctt_size;
   ctf_arinfo_t ar;
+  int kind;
 
   if ((type = ctf_type_resolve (fp, type)) == CTF_ERR)
     return -1;			/* errno is set for us.  */
 
-  if ((tp = ctf_lookup_by_id (&fp, type)) == NULL)
-    return -1;			/* errno is set for us.  */
+  /* Types too large for the descriptor to hold their size are looked up
+     in full.  */
 
-  switch (LCTF_INFO_KIND (fp, tp->ctt_info))
+  if ((td = ctf_lookup_tdesc (&fp, type)) != NULL
+      && td->ctvt_size != CTF_LSIZE_SENT)
+    {
+      kind = LCTF_TDESC_KIND (td);
+      ctt_size = td->ctvt_size;
+    }
+  else
+    {
+      if ((tp = ctf_lookup_by_id (&fp, type)) == NULL)
+	return -1;		/* errno is set for us.  */
+
+      kind = LCTF_INFO_KIND (fp, tp->ctt_info);
+      ctt_size = ctf_get_ctt_size (fp, tp, NULL, NULL);
+    }
+
+  if ((tc = ctf_tcache_size_entry (fp, type, depended)) != NULL
+      && (size = __atomic_load_n (&tc->ctc_size, __ATOMIC_RELAXED)) != 0)
+    return size - 1;
+
+  switch (kind)
     {
     case CTF_K_POINTER:
-      return fp->ctf_dmodel->ctd_pointer;
+      size = fp->ctf_dmodel->ctd_pointer;
+      break;
 
     case CTF_K_FUNCTION:
-      return 0;		/* Function size is only known by symtab.  */
+      size = 0;		/* Function size is only known by symtab.  */
+      break;
 
     case CTF_K_ENUM:
-      return fp->ctf_dmodel->ctd_int;
+      size = fp->ctf_dmodel->ctd_int;
+      break;
 
     case CTF_K_ARRAY:
       /* ctf_add_array() does not directly encode the element size, but
@@ -504,30 +1326,44 @@ ctf_type_size (ctf_file_t *fp, ctf_id_t type)
 	 If ctf_get_ctt_size() returns nonzero, then use the recorded
 	 size instead.  */
 
-      if ((size = ctf_get_ctt_size (fp, tp, NULL, NULL)) > 0)
-	return size;
+      if ((size = ctt_size) > 0)
+	break;
 
       if (ctf_array_info (fp, type, &ar) < 0
-	  || (size = ctf_type_size (fp, ar.ctr_contents)) < 0)
+	  || (size = ctf_type_size_internal (fp, ar.ctr_contents, 1)) < 0)
 	return -1;		/* errno is set for us.  */
 
-      return size * ar.ctr_nelems;
+      size *= ar.ctr_nelems;
+      break;
 
     default: /* including slices of enums, etc */
-      return (ctf_get_ctt_size (fp, tp, NULL, NULL));
+      size = ctt_size;
     }
+
+  if (tc != NULL && size >= 0)
+    __atomic_store_n (&tc->ctc_size, size + 1, __ATOMIC_RELAXED);
+  return size;
+}
+
+ssize_t
+ctf_type_size (ctf_file_t *fp, ctf_id_t type)
+{
+  return ctf_type_size_internal (fp, type, 0);
 }
 
 /* Resolve the type down to a base type node, and then return the alignment
-   needed for the type storage in bytes.
+   needed for the type storage in bytes.  DEPENDED is as for
+   ctf_tcache_size_entry().
 
    XXX may need arch-dependent attention.  */
 
-ssize_t
-ctf_type_align (ctf_file_t *fp, ctf_id_t type)
+static ssize_t
+ctf_type_align_internal (ctf_file_t *fp, ctf_id_t type, int depended)
 {
   const ctf_type_t *tp;
   ctf_file_t *ofp = fp;
+  ctf_tcache_t *tc;
+  ssize_t align;
   int kind;
 
   if ((type = ctf_type_resolve (fp, type)) == CTF_ERR)
@@ -536,25 +1372,31 @@ ctf_type_align (ctf_file_t *fp, ctf_id_t type)
   if ((tp = ctf_lookup_by_id (&fp, type)) == NULL)
     return -1;			/* errno is set for us.  */
 
+  if ((tc = ctf_tcache_size_entry (fp, type, depended)) != NULL
+      && (align = __atomic_load_n (&tc->ctc_align, __ATOMIC_RELAXED)) != 0)
+    return align - 1;
+
   kind = LCTF_INFO_KIND (fp, tp->ctt_info);
   switch (kind)
     {
     case CTF_K_POINTER:
     case CTF_K_FUNCTION:
-      return fp->ctf_dmodel->ctd_pointer;
+      align = fp->ctf_dmodel->ctd_pointer;
+      break;
 
     case CTF_K_ARRAY:
       {
 	ctf_arinfo_t r;
 	if (ctf_array_info (fp, type, &r) < 0)
 	  return -1;		/* errno is set for us.  */
-	return (ctf_type_align (fp, r.ctr_contents));
+	align = ctf_type_align_internal (fp, r.ctr_contents, 1);
+	break;
       }
 
     case CTF_K_STRUCT:
     case CTF_K_UNION:
       {
-	size_t align = 0;
+	size_t salign = 0;
 	ctf_dtdef_t *dtd;
 
 	if ((dtd = ctf_dynamic_type (ofp, type)) == NULL)
@@ -574,8 +1416,8 @@ ctf_type_align (ctf_file_t *fp, ctf_id_t type)
 		const ctf_member_t *mp = vmp;
 		for (; n != 0; n--, mp++)
 		  {
-		    ssize_t am = ctf_type_align (fp, mp->ctm_type);
-		    align = MAX (align, (size_t) am);
+		    ssize_t am = ctf_type_align_internal (fp, mp->ctm_type, 1);
+		    salign = MAX (salign, (size_t) am);
 		  }
 	      }
 	    else
@@ -583,8 +1425,9 @@ ctf_type_align (ctf_file_t *fp, ctf_id_t type)
 		const ctf_lmember_t *lmp = vmp;
 		for (; n != 0; n--, lmp++)
 		  {
-		    ssize_t am = ctf_type_align (fp, lmp->ctlm_type);
-		    align = MAX (align, (size_t) am);
+		    ssize_t am = ctf_type_align_internal (fp, lmp->ctlm_type,
+							  1);
+		    salign = MAX (salign, (size_t) am);
 		  }
 	      }
 	  }
@@ -595,22 +1438,34 @@ ctf_type_align (ctf_file_t *fp, ctf_id_t type)
 	      for (dmd = ctf_list_next (&dtd->dtd_u.dtu_members);
 		   dmd != NULL; dmd = ctf_list_next (dmd))
 		{
-		  ssize_t am = ctf_type_align (fp, dmd->dmd_type);
-		  align = MAX (align, (size_t) am);
+		  ssize_t am = ctf_type_align_internal (fp, dmd->dmd_type, 1);
+		  salign = MAX (salign, (size_t) am);
 		  if (kind == CTF_K_STRUCT)
 		    break;
 		}
 	  }
 
-	return align;
+	align = salign;
+	break;
       }
 
     case CTF_K_ENUM:
-      return fp->ctf_dmodel->ctd_int;
+      align = fp->ctf_dmodel->ctd_int;
+      break;
 
     default:  /* including slices of enums, etc */
-      return (ctf_get_ctt_size (fp, tp, NULL, NULL));
+      align = ctf_get_ctt_size (fp, tp, NULL, NULL);
     }
+
+  if (tc != NULL && align >= 0)
+    __atomic_store_n (&tc->ctc_align, align + 1, __ATOMIC_RELAXED);
+  return align;
+}
+
+ssize_t
+ctf_type_align (ctf_file_t *fp, ctf_id_t type)
+{
+  return ctf_type_align_internal (fp, type, 0);
 }
 
 /* Return the kind (CTF_K_* constant) for the specified type ID.  */
@@ -618,8 +1473,12 @@ ctf_type_align (ctf_file_t *fp, ctf_id_t type)
 int
 ctf_type_kind_unsliced (ctf_file_t *fp, ctf_id_t type)
 {
+  const ctf_tdesc_t *td;
   const ctf_type_t *tp;
 
+  if ((td = ctf_lookup_tdesc (&fp, type)) != NULL)
+    return LCTF_TDESC_KIND (td);
+
   if ((tp = ctf_lookup_by_id (&fp, type)) == NULL)
     return -1;			/* errno is set for us.  */
 
@@ -654,8 +1513,24 @@ ctf_id_t
 ctf_type_reference (ctf_file_t *fp, ctf_id_t type)
 {
   ctf_file_t *ofp = fp;
+  const ctf_tdesc_t *td;
   const ctf_type_t *tp;
 
+  if ((td = ctf_lookup_tdesc (&fp, type)) != NULL)
+    switch (LCTF_TDESC_KIND (td))
+      {
+      case CTF_K_POINTER:
+      case CTF_K_TYPEDEF:
+      case CTF_K_VOLATILE:
+      case CTF_K_CONST:
+      case CTF_K_RESTRICT:
+	return td->ctvt_type;
+      case CTF_K_SLICE:
+	return ((const ctf_slice_t *) LCTF_TDESC_VDATA (fp, td))->cts_type;
+      default:
+	return (ctf_set_errno (ofp, ECTF_NOTREF));
+      }
+
   if ((tp = ctf_lookup_by_id (&fp, type)) == NULL)
     return CTF_ERR;		/* errno is set for us.  */
 
@@ -698,6 +1573,9 @@ ctf_type_pointer (ctf_file_t *fp, ctf_id_t type)
   if (ctf_lookup_by_id (&fp, type) == NULL)
     return CTF_ERR;		/* errno is set for us.  */
 
+  if (ctf_lazy_need (fp, LCTF_LAZY_PTRTAB) != 0)
+    return (ctf_set_errno (ofp, ctf_errno (fp)));
+
   if ((ntype = fp->ctf_ptrtab[LCTF_TYPE_TO_INDEX (fp, type)]) != 0)
     return (LCTF_INDEX_TO_TYPE (fp, ntype, (fp->ctf_flags & LCTF_CHILD)));
 
@@ -707,6 +1585,9 @@ ctf_type_pointer (ctf_file_t *fp, ctf_id_t type)
   if (ctf_lookup_by_id (&fp, type) == NULL)
     return (ctf_set_errno (ofp, ECTF_NOTYPE));
 
+  if (ctf_lazy_need (fp, LCTF_LAZY_PTRTAB) != 0)
+    return (ctf_set_errno (ofp, ctf_errno (fp)));
+
   if ((ntype = fp->ctf_ptrtab[LCTF_TYPE_TO_INDEX (fp, type)]) != 0)
     return (LCTF_INDEX_TO_TYPE (fp, ntype, (fp->ctf_flags & LCTF_CHILD)));
 
@@ -899,6 +1780,186 @@ ctf_type_compat (ctf_file_t *lfp, ctf_id_t ltype,
     }
 }
 
+/* Member name indexes, built on first use for structs and unions with more than
+   CTF_MEMBIDX_THRESH members, and hung off the type cache.  Each is a single
+   allocation holding an array of the members in order, followed by an
+   open-addressed hash table of indexes into that array, plus one.  Where
+   several members have the same name (as anonymous members do), the first one
+   is found, just as by a linear search.  */
+
+#define CTF_MEMBIDX_THRESH 16
+
+typedef struct ctf_membent
+{
+  const char *cme_name;		/* Member name.  */
+  ctf_id_t cme_type;		/* Member type.  */
+  unsigned long cme_offset;	/* Member offset in bits.  */
+  uint32_t cme_hash;		/* ctf_idx_hash() of name.  */
+} ctf_membent_t;
+
+typedef struct ctf_membidx
+{
+  uint32_t cmi_nslots;		/* Number of slots: a power of two.  */
+  uint32_t *cmi_slots;		/* Member array index plus one, or 0.  */
+  ctf_membent_t cmi_members[1];	/* Members, in order.  */
+} ctf_membidx_t;
+
+/* Copy the name, type and offset of up to VLEN members of the struct or union
+   TYPE at TP into MEMBERS, in order, returning the number copied.  */
+
+static uint32_t
+ctf_member_list (ctf_file_t *fp, ctf_id_t type, const ctf_type_t *tp,
+		 uint32_t vlen, ctf_membent_t *members)
+{
+  ctf_dtdef_t *dtd;
+  ssize_t size, increment;
+  uint32_t n = 0;
+
+  if ((dtd = ctf_dynamic_type (fp, type)) != NULL)
+    {
+      ctf_dmdef_t *dmd;
+
+      for (dmd = ctf_list_next (&dtd->dtd_u.dtu_members);
+	   dmd != NULL && n < vlen; dmd = ctf_list_next (dmd), n++)
+	{
+	  members[n].cme_name = dmd->dmd_name ? dmd->dmd_name : "";
+	  members[n].cme_type = dmd->dmd_type;
+	  members[n].cme_offset = dmd->dmd_offset;
+	}
+      return n;
+    }
+
+  (void) ctf_get_ctt_size (fp, tp, &size, &increment);
+
+  if (size < CTF_LSTRUCT_THRESH)
+    {
+      const ctf_member_t *mp = (const ctf_member_t *) ((uintptr_t) tp +
+						       increment);
+      for (; n < vlen; n++, mp++)
+	{
+	  members[n].cme_name = ctf_strptr (fp, mp->ctm_name);
+	  members[n].cme_type = mp->ctm_type;
+	  members[n].cme_offset = mp->ctm_offset;
+	}
+    }
+  else
+    {
+      const ctf_lmember_t *lmp = (const ctf_lmember_t *) ((uintptr_t) tp +
+							  increment);
+      for (; n < vlen; n++, lmp++)
+	{
+	  members[n].cme_name = ctf_strptr (fp, lmp->ctlm_name);
+	  members[n].cme_type = lmp->ctlm_type;
+	  members[n].cme_offset = (unsigned long) CTF_LMEM_OFFSET (lmp);
+	}
+    }
+  return n;
+}
+
+/* Build a member name index for the struct or union TYPE at TP, with VLEN
+   members.  */
+
+static ctf_membidx_t *
+ctf_member_index_build (ctf_file_t *fp, ctf_id_t type, const ctf_type_t *tp,
+			uint32_t vlen)
+{
+  ctf_membidx_t *mi;
+  uint32_t nslots = 1, i, n;
+
+  while (nslots < vlen * 2)
+    nslots <<= 1;
+
+  if ((mi = malloc (sizeof (ctf_membidx_t) + vlen * sizeof (ctf_membent_t)
+		    + nslots * sizeof (uint32_t))) == NULL)
+    return NULL;
+
+  mi->cmi_nslots = nslots;
+  mi->cmi_slots = (uint32_t *) &mi->cmi_members[vlen];
+  memset (mi->cmi_slots, 0, nslots * sizeof (uint32_t));
+
+  n = ctf_member_list (fp, type, tp, vlen, mi->cmi_members);
+
+  for (i = 0; i < n; i++)
+    {
+      ctf_membent_t *mep = &mi->cmi_members[i];
+      uint32_t slot;
+
+      mep->cme_hash = ctf_idx_hash (mep->cme_name);
+      for (slot = mep->cme_hash & (nslots - 1); mi->cmi_slots[slot] != 0;
+	   slot = (slot + 1) & (nslots - 1))
+	{
+	  const ctf_membent_t *omep = &mi->cmi_members[mi->cmi_slots[slot] - 1];
+	  if (omep->cme_hash == mep->cme_hash
+	      && strcmp (omep->cme_name, mep->cme_name) == 0)
+	    break;
+	}
+
+      if (mi->cmi_slots[slot] == 0)
+	mi->cmi_slots[slot] = i + 1;
+    }
+
+  return mi;
+}
+
+/* Install the newly built index IDX in the type cache entry TC, unless another
+   thread got there first, in which case IDX is freed.  Return whichever index
+   is installed.  */
+
+static void *
+ctf_tcache_set_index (ctf_tcache_t *tc, void *idx)
+{
+  void *expected = NULL;
+
+  if (!__atomic_compare_exchange_n (&tc->ctc_index, &expected, idx, 0,
+				    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      free (idx);
+      idx = expected;
+    }
+  return idx;
+}
+
+/* Return the member name index for the struct or union TYPE at TP in FP,
+   building it if need be, or NULL if it has too few members to be worth
+   indexing, or cannot be built.  */
+
+static const ctf_membidx_t *
+ctf_member_index (ctf_file_t *fp, ctf_id_t type, const ctf_type_t *tp)
+{
+  uint32_t vlen = LCTF_INFO_VLEN (fp, tp->ctt_info);
+  ctf_membidx_t *mi;
+  ctf_tcache_t *tc;
+
+  if (vlen <= CTF_MEMBIDX_THRESH || (tc = ctf_tcache_entry (fp, type)) == NULL)
+    return NULL;
+
+  if ((mi = __atomic_load_n (&tc->ctc_index, __ATOMIC_ACQUIRE)) != NULL)
+    return mi;
+
+  if ((mi = ctf_member_index_build (fp, type, tp, vlen)) == NULL)
+    return NULL;
+
+  return ctf_tcache_set_index (tc, mi);
+}
+
+/* Look NAME up in the member name index MI.  */
+
+static const ctf_membent_t *
+ctf_member_index_lookup (const ctf_membidx_t *mi, const char *name)
+{
+  uint32_t h = ctf_idx_hash (name);
+  uint32_t slot;
+
+  for (slot = h & (mi->cmi_nslots - 1); mi->cmi_slots[slot] != 0;
+       slot = (slot + 1) & (mi->cmi_nslots - 1))
+    {
+      const ctf_membent_t *mep = &mi->cmi_members[mi->cmi_slots[slot] - 1];
+      if (mep->cme_hash == h && strcmp (mep->cme_name, name) == 0)
+	return mep;
+    }
+  return NULL;
+}
+
 /* Return the type and offset for a given member of a STRUCT or UNION.  */
 
 int
@@ -907,6 +1968,7 @@ ctf_member_info (ctf_file_t *fp, ctf_id_t type, const char *name,
 {
   ctf_file_t *ofp = fp;
   const ctf_type_t *tp;
+  const ctf_membidx_t *mi;
   ctf_dtdef_t *dtd;
   ssize_t size, increment;
   uint32_t kind, n;
@@ -923,6 +1985,18 @@ ctf_member_info (ctf_file_t *fp, ctf_id_t type, const char *name,
   if (kind != CTF_K_STRUCT && kind != CTF_K_UNION)
     return (ctf_set_errno (ofp, ECTF_NOTSOU));
 
+  if ((mi = ctf_member_index (fp, type, tp)) != NULL)
+    {
+      const ctf_membent_t *mep;
+
+      if ((mep = ctf_member_index_lookup (mi, name)) == NULL)
+	return (ctf_set_errno (ofp, ECTF_NOMEMBNAM));
+
+      mip->ctm_type = mep->cme_type;
+      mip->ctm_offset = mep->cme_offset;
+      return 0;
+    }
+
   if ((dtd = ctf_dynamic_type (fp, type)) == NULL)
     {
       if (size < CTF_LSTRUCT_THRESH)
@@ -975,17 +2049,112 @@ ctf_member_info (ctf_file_t *fp, ctf_id_t type, const char *name,
   return (ctf_set_errno (ofp, ECTF_NOMEMBNAM));
 }
 
+/* Look up the N members named in NAMES of a STRUCT or UNION, filling in the
+   corresponding entries in MIPS, resolving the type only once and making at
+   most one pass over its members.  Members that are not found get a ctm_type
+   of CTF_ERR.  Return the number of members found, or -1 on error.  */
+
+ssize_t
+ctf_member_info_n (ctf_file_t *fp, ctf_id_t type, const char **names,
+		   size_t n, ctf_membinfo_t *mips)
+{
+  ctf_file_t *ofp = fp;
+  const ctf_type_t *tp;
+  const ctf_membidx_t *mi;
+  ctf_membent_t members[CTF_MEMBIDX_THRESH];
+  uint32_t kind, vlen, nmembers, j;
+  ssize_t found = 0;
+  size_t i;
+
+  if ((type = ctf_type_resolve (fp, type)) == CTF_ERR)
+    return -1;			/* errno is set for us.  */
+
+  if ((tp = ctf_lookup_by_id (&fp, type)) == NULL)
+    return -1;			/* errno is set for us.  */
+
+  kind = LCTF_INFO_KIND (fp, tp->ctt_info);
+  vlen = LCTF_INFO_VLEN (fp, tp->ctt_info);
+
+  if (kind != CTF_K_STRUCT && kind != CTF_K_UNION)
+    return (ctf_set_errno (ofp, ECTF_NOTSOU));
+
+  for (i = 0; i < n; i++)
+    {
+      mips[i].ctm_type = CTF_ERR;
+      mips[i].ctm_offset = 0;
+    }
+
+  if ((mi = ctf_member_index (fp, type, tp)) != NULL)
+    {
+      for (i = 0; i < n; i++)
+	{
+	  const ctf_membent_t *mep;
+
+	  if ((mep = ctf_member_index_lookup (mi, names[i])) != NULL)
+	    {
+	      mips[i].ctm_type = mep->cme_type;
+	      mips[i].ctm_offset = mep->cme_offset;
+	      found++;
+	    }
+	}
+      return found;
+    }
+
+  /* Unindexed: small enough to copy, so walk the members once, matching each
+     against every name not yet found.  (If a large struct could not be
+     indexed for lack of memory, fall back to ctf_member_info().)  */
+
+  if (vlen > CTF_MEMBIDX_THRESH)
+    {
+      for (i = 0; i < n; i++)
+	if (ctf_member_info (ofp, type, names[i], &mips[i]) == 0)
+	  found++;
+	else if (ctf_errno (ofp) != ECTF_NOMEMBNAM)
+	  return -1;		/* errno is set for us.  */
+	else
+	  mips[i].ctm_type = CTF_ERR;
+      return found;
+    }
+
+  nmembers = ctf_member_list (fp, type, tp, vlen, members);
+  for (j = 0; j < nmembers; j++)
+    for (i = 0; i < n; i++)
+      {
+	if (mips[i].ctm_type != CTF_ERR
+	    || strcmp (members[j].cme_name, names[i]) != 0)
+	  continue;
+	mips[i].ctm_type = members[j].cme_type;
+	mips[i].ctm_offset = members[j].cme_offset;
+	found++;
+      }
+
+  return found;
+}
+
 /* Return the array type, index, and size information for the specified ARRAY.  */
 
 int
 ctf_array_info (ctf_file_t *fp, ctf_id_t type, ctf_arinfo_t *arp)
 {
   ctf_file_t *ofp = fp;
+  const ctf_tdesc_t *td;
   const ctf_type_t *tp;
   const ctf_array_t *ap;
   const ctf_dtdef_t *dtd;
   ssize_t increment;
 
+  if ((td = ctf_lookup_tdesc (&fp, type)) != NULL)
+    {
+      if (LCTF_TDESC_KIND (td) != CTF_K_ARRAY)
+	return (ctf_set_errno (ofp, ECTF_NOTARRAY));
+
+      ap = (const ctf_array_t *) LCTF_TDESC_VDATA (fp, td);
+      arp->ctr_contents = ap->cta_contents;
+      arp->ctr_index = ap->cta_index;
+      arp->ctr_nelems = ap->cta_nelems;
+      return 0;
+    }
+
   if ((tp = ctf_lookup_by_id (&fp, type)) == NULL)
     return -1;			/* errno is set for us.  */
 
@@ -1008,6 +2177,444 @@ ctf_array_info (ctf_file_t *fp, ctf_id_t type, ctf_arinfo_t *arp)
   return 0;
 }
 
+/* Member paths, such as "a.b.c[3].d", naming a member or array element nested
+   some way inside a struct, union or array, parsed once by
+   ctf_member_path_compile() into a sequence of steps that can then be
+   evaluated against many base types.  The result of evaluating the path
+   against the type it was compiled for is kept, if that type is in a read-only
+   container, along with the type cache generations of the container and its
+   parent, which change whenever the container's data model or parent (or its
+   parent's data model) does.  */
+
+typedef struct ctf_member_step
+{
+  const char *cms_name;		/* Member name, or NULL for an array index.  */
+  unsigned long cms_index;	/* Array index.  */
+} ctf_member_step_t;
+
+struct ctf_member_path
+{
+  ctf_file_t *cmp_fp;		/* Container of the cached result, if any.  */
+  ctf_id_t cmp_type;		/* Base type of the cached result.  */
+  uint32_t cmp_gen;		/* ctf_tcache_gen of cmp_fp.  */
+  uint32_t cmp_pgen;		/* ctf_tcache_gen of its parent, if any.  */
+  ctf_pathinfo_t cmp_info;	/* Cached result.  */
+  size_t cmp_nsteps;		/* Number of steps.  */
+  ctf_member_step_t cmp_steps[1]; /* Steps, followed by the member names.  */
+};
+
+/* Evaluate the member path MP against the TYPE in FP.  */
+
+static int
+ctf_member_path_walk (const ctf_member_path_t *mp, ctf_file_t *fp,
+		      ctf_id_t type, ctf_pathinfo_t *pip)
+{
+  unsigned long offset = 0;
+  ctf_encoding_t en;
+  ctf_id_t rtype;
+  ssize_t size;
+  size_t i;
+  int kind;
+
+  for (i = 0; i < mp->cmp_nsteps; i++)
+    {
+      const ctf_member_step_t *step = &mp->cmp_steps[i];
+
+      if (step->cms_name != NULL)
+	{
+	  ctf_membinfo_t mi;
+
+	  if (ctf_member_info (fp, type, step->cms_name, &mi) < 0)
+	    return -1;		/* errno is set for us.  */
+
+	  offset += mi.ctm_offset;
+	  type = mi.ctm_type;
+	}
+      else
+	{
+	  ctf_arinfo_t ar;
+
+	  if ((rtype = ctf_type_resolve (fp, type)) == CTF_ERR)
+	    return -1;		/* errno is set for us.  */
+
+	  if (ctf_array_info (fp, rtype, &ar) < 0)
+	    return -1;		/* errno is set for us.  */
+
+	  if ((size = ctf_type_size (fp, ar.ctr_contents)) < 0)
+	    return -1;		/* errno is set for us.  */
+
+	  /* Arrays of no elements are flexible array members, and may be
+	     indexed as far as the offset will stretch.  */
+
+	  if ((ar.ctr_nelems != 0 && step->cms_index >= ar.ctr_nelems)
+	      || (size != 0 && step->cms_index
+		  > (ULONG_MAX - offset) / CHAR_BIT / (unsigned long) size))
+	    return (ctf_set_errno (fp, ECTF_BADID));
+
+	  offset += step->cms_index * size * CHAR_BIT;
+	  type = ar.ctr_contents;
+	}
+    }
+
+  /* Integers, floats and bitfields are as wide as their encoding says, and
+     start as far into their storage as it says: all other types are as wide as
+     they are big.  */
+
+  if ((rtype = ctf_type_resolve (fp, type)) == CTF_ERR)
+    return -1;			/* errno is set for us.  */
+
+  if ((kind = ctf_type_kind (fp, rtype)) < 0)
+    return -1;			/* errno is set for us.  */
+
+  if (kind == CTF_K_INTEGER || kind == CTF_K_FLOAT)
+    {
+      if (ctf_type_encoding (fp, rtype, &en) < 0)
+	return -1;		/* errno is set for us.  */
+      pip->ctp_bits = en.cte_bits;
+      offset += en.cte_offset;
+    }
+  else
+    {
+      if ((size = ctf_type_size (fp, rtype)) < 0)
+	return -1;		/* errno is set for us.  */
+      pip->ctp_bits = size * CHAR_BIT;
+    }
+
+  pip->ctp_type = type;
+  pip->ctp_offset = offset;
+  return 0;
+}
+
+/* Compile the member PATH, a sequence of member names separated by dots and
+   array indexes in square brackets, such as "a.b.c[3].d", and evaluate it
+   against the TYPE in FP, caching the result.  The path may be evaluated
+   against other base types with ctf_member_path_info() and
+   ctf_member_path_info_n(), and must be freed with ctf_member_path_free().
+   Array indexes must be within the bounds of the array, unless it has no
+   elements, and evaluation fails with ECTF_BADID if they are not.  */
+
+ctf_member_path_t *
+ctf_member_path_compile (ctf_file_t *fp, ctf_id_t type, const char *path)
+{
+  ctf_member_path_t *mp;
+  ctf_member_step_t *step;
+  size_t maxsteps = 1;
+  const char *p;
+  char *names;
+
+  for (p = path; *p != '\0'; p++)
+    if (*p == '.' || *p == '[')
+      maxsteps++;
+
+  if ((mp = malloc (sizeof (ctf_member_path_t)
+		    + maxsteps * sizeof (ctf_member_step_t)
+		    + strlen (path) + 1)) == NULL)
+    {
+      (void) ctf_set_errno (fp, ENOMEM);
+      return NULL;
+    }
+
+  memset (mp, 0, sizeof (ctf_member_path_t));
+  names = (char *) &mp->cmp_steps[maxsteps];
+  step = mp->cmp_steps;
+
+  /* Parse the path, copying each member name into NAMES.  A leading dot is
+     optional.  */
+
+  p = path;
+  if (*p == '.')
+    p++;
+
+  while (*p != '\0')
+    {
+      if (*p == '[')
+	{
+	  char *end;
+
+	  step->cms_name = NULL;
+	  step->cms_index = strtoul (p + 1, &end, 0);
+	  if (end == p + 1 || *end != ']')
+	    goto syntax;
+	  p = end + 1;
+	}
+      else
+	{
+	  size_t len = strcspn (p, ".[");
+
+	  if (len == 0)
+	    goto syntax;
+
+	  memcpy (names, p, len);
+	  names[len] = '\0';
+	  step->cms_name = names;
+	  names += len + 1;
+	  p += len;
+	}
+
+      step++;
+
+      /* Each step must be followed by another array index, a dot and a member
+	 name, or the end of the path.  */
+
+      if (*p == '.')
+	{
+	  p++;
+	  if (*p == '\0' || *p == '.' || *p == '[')
+	    goto syntax;
+	}
+      else if (*p != '[' && *p != '\0')
+	goto syntax;
+    }
+
+  mp->cmp_nsteps = step - mp->cmp_steps;
+
+  if (ctf_member_path_walk (mp, fp, type, &mp->cmp_info) < 0)
+    {
+      free (mp);
+      return NULL;		/* errno is set for us.  */
+    }
+
+  if (!(fp->ctf_flags & LCTF_RDWR))
+    {
+      mp->cmp_fp = fp;
+      mp->cmp_type = type;
+      mp->cmp_gen = fp->ctf_tcache_gen;
+      if (fp->ctf_parent != NULL)
+	mp->cmp_pgen = fp->ctf_parent->ctf_tcache_gen;
+    }
+  return mp;
+
+ syntax:
+  free (mp);
+  (void) ctf_set_errno (fp, ECTF_SYNTAX);
+  return NULL;
+}
+
+/* Evaluate the compiled member path MP against the TYPE in FP.  */
+
+int
+ctf_member_path_info (ctf_member_path_t *mp, ctf_file_t *fp, ctf_id_t type,
+		      ctf_pathinfo_t *pip)
+{
+  if (fp == mp->cmp_fp && type == mp->cmp_type
+      && fp->ctf_tcache_gen == mp->cmp_gen
+      && (fp->ctf_parent == NULL
+	  || fp->ctf_parent->ctf_tcache_gen == mp->cmp_pgen))
+    {
+      *pip = mp->cmp_info;
+      return 0;
+    }
+
+  return ctf_member_path_walk (mp, fp, type, pip);
+}
+
+/* Evaluate the compiled member path MP against each of the N TYPES in FP,
+   filling in the corresponding entries in PIPS.  Entries for types against
+   which the path cannot be evaluated get a ctp_type of CTF_ERR, and errno is
+   set for the last of them.  Return the number of types the path was
+   successfully evaluated against.  */
+
+ssize_t
+ctf_member_path_info_n (ctf_member_path_t *mp, ctf_file_t *fp,
+			const ctf_id_t *types, size_t n, ctf_pathinfo_t *pips)
+{
+  ssize_t found = 0;
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    {
+      if (i > 0 && types[i] == types[i - 1])
+	pips[i] = pips[i - 1];
+      else if (ctf_member_path_info (mp, fp, types[i], &pips[i]) < 0)
+	pips[i].ctp_type = CTF_ERR;
+
+      if (pips[i].ctp_type != CTF_ERR)
+	found++;
+    }
+
+  return found;
+}
+
+void
+ctf_member_path_free (ctf_member_path_t *mp)
+{
+  free (mp);
+}
+
+/* Enumerator indexes, built on first use for enums with more than
+   CTF_ENUMIDX_THRESH enumerators, and hung off the type cache.  Each is a
+   single allocation holding an array of the enumerators in order, an array of
+   (value, position) pairs sorted by value and then by position, for
+   value-to-name lookups, and an open-addressed hash table of positions plus
+   one, for name-to-value lookups.  As with a linear search, the first of
+   several enumerators with the same name or value is found.
+
+   Smaller enums are searched linearly: the values are interleaved with the
+   names in the type section, so there is no dense array of values to scan any
+   faster.  */
+
+#define CTF_ENUMIDX_THRESH 16
+
+typedef struct ctf_enument
+{
+  const char *cee_name;		/* Enumerator name.  */
+  int cee_value;		/* Enumerator value.  */
+  uint32_t cee_hash;		/* ctf_idx_hash() of name.  */
+} ctf_enument_t;
+
+typedef struct ctf_enumval
+{
+  int cev_value;		/* Enumerator value.  */
+  uint32_t cev_pos;		/* Position in cei_enums.  */
+} ctf_enumval_t;
+
+typedef struct ctf_enumidx
+{
+  uint32_t cei_nenums;		/* Number of enumerators.  */
+  uint32_t cei_nslots;		/* Number of slots: a power of two.  */
+  ctf_enumval_t *cei_byvalue;	/* Values, sorted.  */
+  uint32_t *cei_slots;		/* Position in cei_enums plus one, or 0.  */
+  ctf_enument_t cei_enums[1];	/* Enumerators, in order.  */
+} ctf_enumidx_t;
+
+static int
+ctf_enumval_compar (const void *a, const void *b)
+{
+  const ctf_enumval_t *one = a;
+  const ctf_enumval_t *two = b;
+
+  if (one->cev_value != two->cev_value)
+    return one->cev_value < two->cev_value ? -1 : 1;
+  return one->cev_pos < two->cev_pos ? -1 : one->cev_pos > two->cev_pos;
+}
+
+/* Build an enumerator index for the enum TYPE at TP, with VLEN
+   enumerators.  */
+
+static ctf_enumidx_t *
+ctf_enum_index_build (ctf_file_t *fp, ctf_id_t type, const ctf_type_t *tp,
+		      uint32_t vlen)
+{
+  ctf_enumidx_t *ei;
+  ctf_dtdef_t *dtd;
+  uint32_t nslots = 1, i, n = 0;
+
+  while (nslots < vlen * 2)
+    nslots <<= 1;
+
+  if ((ei = malloc (sizeof (ctf_enumidx_t) + vlen * sizeof (ctf_enument_t)
+		    + vlen * sizeof (ctf_enumval_t)
+		    + nslots * sizeof (uint32_t))) == NULL)
+    return NULL;
+
+  ei->cei_nslots = nslots;
+  ei->cei_byvalue = (ctf_enumval_t *) &ei->cei_enums[vlen];
+  ei->cei_slots = (uint32_t *) &ei->cei_byvalue[vlen];
+  memset (ei->cei_slots, 0, nslots * sizeof (uint32_t));
+
+  if ((dtd = ctf_dynamic_type (fp, type)) != NULL)
+    {
+      ctf_dmdef_t *dmd;
+
+      for (dmd = ctf_list_next (&dtd->dtd_u.dtu_members);
+	   dmd != NULL && n < vlen; dmd = ctf_list_next (dmd), n++)
+	{
+	  ei->cei_enums[n].cee_name = dmd->dmd_name;
+	  ei->cei_enums[n].cee_value = dmd->dmd_value;
+	}
+    }
+  else
+    {
+      const ctf_enum_t *ep;
+      ssize_t increment;
+
+      (void) ctf_get_ctt_size (fp, tp, NULL, &increment);
+      ep = (const ctf_enum_t *) ((uintptr_t) tp + increment);
+
+      for (; n < vlen; n++, ep++)
+	{
+	  ei->cei_enums[n].cee_name = ctf_strptr (fp, ep->cte_name);
+	  ei->cei_enums[n].cee_value = ep->cte_value;
+	}
+    }
+
+  ei->cei_nenums = n;
+
+  for (i = 0; i < n; i++)
+    {
+      ctf_enument_t *eep = &ei->cei_enums[i];
+      uint32_t slot;
+
+      ei->cei_byvalue[i].cev_value = eep->cee_value;
+      ei->cei_byvalue[i].cev_pos = i;
+
+      eep->cee_hash = ctf_idx_hash (eep->cee_name);
+      for (slot = eep->cee_hash & (nslots - 1); ei->cei_slots[slot] != 0;
+	   slot = (slot + 1) & (nslots - 1))
+	{
+	  const ctf_enument_t *oeep = &ei->cei_enums[ei->cei_slots[slot] - 1];
+	  if (oeep->cee_hash == eep->cee_hash
+	      && strcmp (oeep->cee_name, eep->cee_name) == 0)
+	    break;
+	}
+
+      if (ei->cei_slots[slot] == 0)
+	ei->cei_slots[slot] = i + 1;
+    }
+
+  qsort (ei->cei_byvalue, n, sizeof (ctf_enumval_t), ctf_enumval_compar);
+
+  return ei;
+}
+
+/* Return the enumerator index for the enum TYPE at TP in FP, building it if
+   need be, or NULL if it has too few enumerators to be worth indexing, or
+   cannot be built.  */
+
+static const ctf_enumidx_t *
+ctf_enum_index (ctf_file_t *fp, ctf_id_t type, const ctf_type_t *tp)
+{
+  uint32_t vlen = LCTF_INFO_VLEN (fp, tp->ctt_info);
+  ctf_enumidx_t *ei;
+  ctf_tcache_t *tc;
+
+  if (vlen <= CTF_ENUMIDX_THRESH || (tc = ctf_tcache_entry (fp, type)) == NULL)
+    return NULL;
+
+  if ((ei = __atomic_load_n (&tc->ctc_index, __ATOMIC_ACQUIRE)) != NULL)
+    return ei;
+
+  if ((ei = ctf_enum_index_build (fp, type, tp, vlen)) == NULL)
+    return NULL;
+
+  return ctf_tcache_set_index (tc, ei);
+}
+
+/* Resolve the enum *TYPEP in *FPP, returning its type data and updating *TYPEP
+   and *FPP to the resolved type and the container it is defined in, or NULL
+   with errno set on the original *FPP.  */
+
+static const ctf_type_t *
+ctf_enum_lookup (ctf_file_t **fpp, ctf_id_t *typep)
+{
+  ctf_file_t *ofp = *fpp;
+  const ctf_type_t *tp;
+
+  if ((*typep = ctf_type_resolve_unsliced (ofp, *typep)) == CTF_ERR)
+    return NULL;		/* errno is set for us.  */
+
+  if ((tp = ctf_lookup_by_id (fpp, *typep)) == NULL)
+    return NULL;		/* errno is set for us.  */
+
+  if (LCTF_INFO_KIND (*fpp, tp->ctt_info) != CTF_K_ENUM)
+    {
+      (void) ctf_set_errno (ofp, ECTF_NOTENUM);
+      return NULL;
+    }
+
+  return tp;
+}
+
 /* Convert the specified value to the corresponding enum tag name, if a
    matching name can be found.  Otherwise NULL is returned.  */
 
@@ -1017,26 +2624,36 @@ ctf_enum_name (ctf_file_t *fp, ctf_id_t type, int value)
   ctf_file_t *ofp = fp;
   const ctf_type_t *tp;
   const ctf_enum_t *ep;
+  const ctf_enumidx_t *ei;
   const ctf_dtdef_t *dtd;
   ssize_t increment;
   uint32_t n;
 
-  if ((type = ctf_type_resolve_unsliced (fp, type)) == CTF_ERR)
-    return NULL;		/* errno is set for us.  */
-
-  if ((tp = ctf_lookup_by_id (&fp, type)) == NULL)
+  if ((tp = ctf_enum_lookup (&fp, &type)) == NULL)
     return NULL;		/* errno is set for us.  */
 
-  if (LCTF_INFO_KIND (fp, tp->ctt_info) != CTF_K_ENUM)
+  if ((ei = ctf_enum_index (fp, type, tp)) != NULL)
     {
-      (void) ctf_set_errno (ofp, ECTF_NOTENUM);
-      return NULL;
-    }
+      /* Find the first entry with this value.  */
 
-  (void) ctf_get_ctt_size (fp, tp, NULL, &increment);
+      uint32_t lo = 0, hi = ei->cei_nenums;
 
-  if ((dtd = ctf_dynamic_type (ofp, type)) == NULL)
+      while (lo < hi)
+	{
+	  uint32_t mid = lo + (hi - lo) / 2;
+
+	  if (ei->cei_byvalue[mid].cev_value < value)
+	    lo = mid + 1;
+	  else
+	    hi = mid;
+	}
+
+      if (lo < ei->cei_nenums && ei->cei_byvalue[lo].cev_value == value)
+	return ei->cei_enums[ei->cei_byvalue[lo].cev_pos].cee_name;
+    }
+  else if ((dtd = ctf_dynamic_type (fp, type)) == NULL)
     {
+      (void) ctf_get_ctt_size (fp, tp, NULL, &increment);
       ep = (const ctf_enum_t *) ((uintptr_t) tp + increment);
 
       for (n = LCTF_INFO_VLEN (fp, tp->ctt_info); n != 0; n--, ep++)
@@ -1070,28 +2687,36 @@ ctf_enum_value (ctf_file_t * fp, ctf_id_t type, const char *name, int *valp)
   ctf_file_t *ofp = fp;
   const ctf_type_t *tp;
   const ctf_enum_t *ep;
+  const ctf_enumidx_t *ei;
   const ctf_dtdef_t *dtd;
   ssize_t increment;
   uint32_t n;
 
-  if ((type = ctf_type_resolve_unsliced (fp, type)) == CTF_ERR)
-    return -1;			/* errno is set for us.  */
-
-  if ((tp = ctf_lookup_by_id (&fp, type)) == NULL)
+  if ((tp = ctf_enum_lookup (&fp, &type)) == NULL)
     return -1;			/* errno is set for us.  */
 
-  if (LCTF_INFO_KIND (fp, tp->ctt_info) != CTF_K_ENUM)
+  if ((ei = ctf_enum_index (fp, type, tp)) != NULL)
     {
-      (void) ctf_set_errno (ofp, ECTF_NOTENUM);
-      return -1;
-    }
-
-  (void) ctf_get_ctt_size (fp, tp, NULL, &increment);
-
-  ep = (const ctf_enum_t *) ((uintptr_t) tp + increment);
+      uint32_t h = ctf_idx_hash (name);
+      uint32_t slot;
 
-  if ((dtd = ctf_dynamic_type (ofp, type)) == NULL)
+      for (slot = h & (ei->cei_nslots - 1); ei->cei_slots[slot] != 0;
+	   slot = (slot + 1) & (ei->cei_nslots - 1))
+	{
+	  const ctf_enument_t *eep = &ei->cei_enums[ei->cei_slots[slot] - 1];
+	  if (eep->cee_hash == h && strcmp (eep->cee_name, name) == 0)
+	    {
+	      if (valp != NULL)
+		*valp = eep->cee_value;
+	      return 0;
+	    }
+	}
+    }
+  else if ((dtd = ctf_dynamic_type (fp, type)) == NULL)
     {
+      (void) ctf_get_ctt_size (fp, tp, NULL, &increment);
+      ep = (const ctf_enum_t *) ((uintptr_t) tp + increment);
+
       for (n = LCTF_INFO_VLEN (fp, tp->ctt_info); n != 0; n--, ep++)
 	{
 	  if (strcmp (ctf_strptr (fp, ep->cte_name), name) == 0)
@@ -155,11 +155,13 @@ ctf_set_open_errno (int *errp, int error)
 }
 
 /* Store the specified error code into the CTF container, and then return
-   CTF_ERR / -1 for the benefit of the caller. */
+   CTF_ERR / -1 for the benefit of the caller.  The store is atomic, since
+   lookups failing in several threads at once may all set the errno of the same
+   read-only container.  */
 
 unsigned long
 ctf_set_errno (ctf_file_t * fp, int err)
 {
-  fp->ctf_errno = err;
+  __atomic_store_n (&fp->ctf_errno, err, __ATOMIC_RELAXED);
   return CTF_ERR;
 }
@@ -0,0 +1,244 @@
+/* Check that lookups, iterators and the caches behind them see types added to
+   writable containers, and types in newly-imported parents.
+
+   Copyright (c) 2019, Oracle and/or its affiliates. All rights reserved.
+
+   Licensed under the Universal Permissive License v 1.0 as shown at
+   http://oss.oracle.com/licenses/upl.
+
+   Licensed under the GNU General Public License (GPL), version 2. See the file
+   COPYING in the top level of this tree.  */
+
+#include "test.h"
+
+/* Count the types of a kind.  */
+
+static int
+count_cb (ctf_id_t type, int flag, void *arg)
+{
+  size_t *n = arg;
+
+  (*n)++;
+  return 0;
+}
+
+static size_t
+count_kind (ctf_file_t *fp, int kind)
+{
+  size_t n = 0;
+
+  CHECK (ctf_type_iter_kind (fp, kind, count_cb, &n) == 0);
+  return n;
+}
+
+/* Check that the name lookups of NAMES all find TYPES, one at a time and all
+   together.  */
+
+static void
+check_lookups (ctf_file_t *fp, const char **names, const ctf_id_t *types,
+	       size_t n)
+{
+  ctf_id_t ids[16];
+  ssize_t found = 0;
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    {
+      CHECK (ctf_lookup_by_name (fp, names[i]) == types[i]);
+      if (types[i] != CTF_ERR)
+	found++;
+    }
+  CHECK (ctf_lookup_by_name_n (fp, names, n, ids) == found);
+  for (i = 0; i < n; i++)
+    CHECK (ids[i] == types[i]);
+}
+
+/* Add types to a writable container one by one, looking them up each time,
+   including after serializing it, which rebuilds the container in place.  */
+
+static void
+check_adds (void)
+{
+  const char *names[] = { "struct foo", "struct foo *", "foo_t", "int" };
+  ctf_id_t types[4] = { CTF_ERR, CTF_ERR, CTF_ERR, CTF_ERR };
+  ctf_encoding_t ie = { CTF_INT_SIGNED, 0, 32 };
+  ctf_snapshot_id_t snap;
+  ctf_membinfo_t mi;
+  ctf_file_t *fp;
+  ctf_id_t it, et, ut;
+  size_t size;
+  int err, v;
+
+  CHECK ((fp = ctf_create (&err)) != NULL);
+  ctf_setnamecache (fp, 1);
+  check_lookups (fp, names, types, 4);
+  CHECK (count_kind (fp, CTF_K_STRUCT) == 0);
+  CHECK (count_kind (fp, CTF_K_FORWARD) == 0);
+
+  types[3] = it = ctf_add_integer (fp, CTF_ADD_ROOT, "int", &ie);
+  check_lookups (fp, names, types, 4);
+
+  /* A forward, later promoted to a structure of the same ID.  */
+
+  types[0] = ctf_add_forward (fp, CTF_ADD_ROOT, "foo", CTF_K_STRUCT);
+  check_lookups (fp, names, types, 4);
+  CHECK (ctf_type_kind (fp, types[0]) == CTF_K_FORWARD);
+  CHECK (count_kind (fp, CTF_K_FORWARD) == 1);
+
+  CHECK (ctf_add_struct (fp, CTF_ADD_ROOT, "foo") == types[0]);
+  check_lookups (fp, names, types, 4);
+  CHECK (ctf_type_kind (fp, types[0]) == CTF_K_STRUCT);
+  CHECK (count_kind (fp, CTF_K_FORWARD) == 0);
+  CHECK (count_kind (fp, CTF_K_STRUCT) == 1);
+
+  types[1] = ctf_add_pointer (fp, CTF_ADD_ROOT, types[0]);
+  types[2] = ctf_add_typedef (fp, CTF_ADD_ROOT, "foo_t", types[0]);
+  check_lookups (fp, names, types, 4);
+  CHECK (ctf_type_resolve (fp, types[2]) == types[0]);
+
+  /* Members and enumerators added to existing types.  */
+
+  CHECK (ctf_member_info (fp, types[0], "a", &mi) < 0);
+  CHECK (ctf_add_member (fp, types[0], "a", it) == 0);
+  CHECK (ctf_member_info (fp, types[0], "a", &mi) == 0);
+  CHECK (mi.ctm_type == it && mi.ctm_offset == 0);
+  CHECK (ctf_type_size (fp, types[2]) == 4);
+  CHECK (ctf_add_member (fp, types[0], "b", it) == 0);
+  CHECK (ctf_member_info (fp, types[0], "b", &mi) == 0);
+  CHECK (mi.ctm_offset == 32);
+  CHECK (ctf_type_size (fp, types[2]) == 8);
+
+  CHECK (ctf_lookup_enumerator (fp, "X", &v) == CTF_ERR);
+  CHECK ((et = ctf_add_enum (fp, CTF_ADD_ROOT, "e")) != CTF_ERR);
+  CHECK (ctf_add_enumerator (fp, et, "X", 3) == 0);
+  CHECK (ctf_lookup_enumerator (fp, "X", &v) == et && v == 3);
+  CHECK (ctf_lookup_enumerator (fp, "Y", &v) == CTF_ERR);
+  CHECK (ctf_add_enumerator (fp, et, "Y", 4) == 0);
+  CHECK (ctf_lookup_enumerator (fp, "Y", &v) == et && v == 4);
+  CHECK (strcmp (ctf_enum_name (fp, et, 4), "Y") == 0);
+
+  /* Types added after serialization get new IDs and are seen by the
+     lookups.  */
+
+  free (ctf_write_mem (fp, &size, (size_t) -1));
+  check_lookups (fp, names, types, 4);
+  CHECK ((ut = ctf_add_union (fp, CTF_ADD_ROOT, "u")) > et);
+  CHECK (ctf_lookup_by_name (fp, "union u") == ut);
+  CHECK (count_kind (fp, CTF_K_UNION) == 1);
+
+  /* Rolled-back types are forgotten.  */
+
+  snap = ctf_snapshot (fp);
+  CHECK ((ut = ctf_add_union (fp, CTF_ADD_ROOT, "v")) != CTF_ERR);
+  CHECK (ctf_lookup_by_name (fp, "union v") == ut);
+  CHECK (count_kind (fp, CTF_K_UNION) == 2);
+  CHECK (ctf_rollback (fp, snap) == 0);
+  CHECK (ctf_lookup_by_name (fp, "union v") == CTF_ERR);
+  CHECK (count_kind (fp, CTF_K_UNION) == 1);
+  CHECK (ctf_add_union (fp, CTF_ADD_ROOT, "w") == ut);
+  CHECK (ctf_lookup_by_name (fp, "union w") == ut);
+
+  ctf_file_close (fp);
+}
+
+/* Build a parent whose first type is a 32-bit int, and whose second is a
+   structure called NAME containing NMEMB ints.  */
+
+static ctf_file_t *
+build_parent (const char *name, int nmemb, unsigned char **bufp)
+{
+  ctf_encoding_t ie = { CTF_INT_SIGNED, 0, 32 };
+  ctf_file_t *wfp, *fp;
+  ctf_id_t it, st;
+  char mname[16];
+  int err, i;
+
+  CHECK ((wfp = ctf_create (&err)) != NULL);
+  CHECK ((it = ctf_add_integer (wfp, CTF_ADD_ROOT, "int", &ie)) == 1);
+  CHECK ((st = ctf_add_struct (wfp, CTF_ADD_ROOT, name)) == 2);
+  for (i = 0; i < nmemb; i++)
+    {
+      sprintf (mname, "m%i", i);
+      CHECK (ctf_add_member (wfp, st, mname, it) == 0);
+    }
+  fp = test_reopen (wfp, TEST_INDEXED, bufp);
+  ctf_file_close (wfp);
+  return fp;
+}
+
+/* Look up and name types in a child, through its parent, and check that the
+   answers change when another parent is imported.  */
+
+static void
+check_import (void)
+{
+  unsigned char *pbuf, *qbuf, *buf;
+  ctf_file_t *pp = build_parent ("ps", 1, &pbuf);
+  ctf_file_t *qp = build_parent ("qs", 3, &qbuf);
+  ctf_file_t *wfp, *fp;
+  ctf_id_t ptr, td;
+  ctf_membinfo_t mi;
+  int err, how;
+
+  CHECK ((wfp = ctf_create (&err)) != NULL);
+  CHECK (ctf_import (wfp, pp) == 0);
+  CHECK ((ptr = ctf_add_pointer (wfp, CTF_ADD_ROOT, 2)) != CTF_ERR);
+  CHECK ((td = ctf_add_typedef (wfp, CTF_ADD_ROOT, "s_t", 2)) != CTF_ERR);
+
+  for (how = 0; how < TEST_NOPEN; how++)
+    {
+      int cache;
+
+      for (cache = 0; cache < 2; cache++)
+	{
+	  char nbuf[32];
+	  char *name;
+
+	  fp = test_reopen (wfp, how, &buf);
+	  ctf_setnamecache (fp, cache);
+	  CHECK (ctf_import (fp, pp) == 0);
+
+	  CHECK (ctf_type_size (fp, td) == 4);
+	  CHECK (ctf_lookup_by_name (fp, "struct ps *") == ptr);
+	  CHECK (ctf_lookup_by_name (fp, "struct qs") == CTF_ERR);
+	  CHECK (ctf_member_info (fp, td, "m2", &mi) < 0);
+	  CHECK ((name = ctf_type_aname (fp, ptr)) != NULL);
+	  CHECK (strcmp (name, "struct ps *") == 0);
+	  free (name);
+
+	  CHECK (ctf_import (fp, qp) == 0);
+	  CHECK (ctf_type_size (fp, td) == 12);
+	  CHECK (ctf_type_resolve (fp, td) == 2);
+	  CHECK (ctf_lookup_by_name (fp, "struct qs *") == ptr);
+	  CHECK (ctf_lookup_by_name (fp, "struct qs") == 2);
+	  CHECK (ctf_lookup_by_name (fp, "struct ps") == CTF_ERR);
+	  CHECK (ctf_member_info (fp, td, "m2", &mi) == 0);
+	  CHECK (mi.ctm_offset == 64);
+	  CHECK ((name = ctf_type_aname (fp, ptr)) != NULL);
+	  CHECK (strcmp (name, "struct qs *") == 0);
+	  free (name);
+
+	  CHECK (ctf_import (fp, pp) == 0);
+	  CHECK (ctf_type_size (fp, td) == 4);
+	  CHECK (ctf_type_name (fp, ptr, nbuf, sizeof (nbuf)) != NULL);
+	  CHECK (strcmp (nbuf, "struct ps *") == 0);
+
+	  ctf_file_close (fp);
+	  free (buf);
+	}
+    }
+
+  ctf_file_close (wfp);
+  ctf_file_close (qp);
+  ctf_file_close (pp);
+  free (qbuf);
+  free (pbuf);
+}
+
+int
+main (void)
+{
+  check_adds ();
+  check_import ();
+  return 0;
+}
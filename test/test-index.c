@@ -0,0 +1,395 @@
+/* Check that containers opened using their persisted index, ignoring it, and
+   lazily all describe the same types, and that the cursor iterators, the kind
+   iterator and views agree with the callback iterators and type queries.
+
+   Copyright (c) 2019, Oracle and/or its affiliates. All rights reserved.
+
+   Licensed under the Universal Permissive License v 1.0 as shown at
+   http://oss.oracle.com/licenses/upl.
+
+   Licensed under the GNU General Public License (GPL), version 2. See the file
+   COPYING in the top level of this tree.  */
+
+#include "test.h"
+#include <errno.h>
+#include <sys/ctf-view.h>
+
+#define NSTRUCTS 500
+
+/* Build a container with a good many types of every kind, some of them not
+   visible at the root.  */
+
+static ctf_file_t *
+build (void)
+{
+  ctf_encoding_t ie = { CTF_INT_SIGNED, 0, 32 };
+  ctf_encoding_t fe = { CTF_FP_DOUBLE, 0, 64 };
+  ctf_funcinfo_t fi = { 0 };
+  ctf_arinfo_t ar;
+  ctf_id_t it, dt, prev, args[2];
+  ctf_file_t *fp;
+  char name[32];
+  int err, i;
+
+  CHECK ((fp = ctf_create (&err)) != NULL);
+  it = ctf_add_integer (fp, CTF_ADD_ROOT, "int", &ie);
+  dt = ctf_add_float (fp, CTF_ADD_ROOT, "double", &fe);
+  prev = ctf_add_pointer (fp, CTF_ADD_ROOT, it);
+
+  for (i = 0; i < NSTRUCTS; i++)
+    {
+      uint32_t flag = i % 5 ? CTF_ADD_ROOT : CTF_ADD_NONROOT;
+      ctf_id_t s, e;
+
+      sprintf (name, "s%i", i);
+      s = ctf_add_struct (fp, flag, name);
+      CHECK (ctf_add_member (fp, s, "a", it) == 0);
+      CHECK (ctf_add_member (fp, s, "b", prev) == 0);
+      CHECK (ctf_add_member (fp, s, "c", dt) == 0);
+
+      sprintf (name, "t%i", i);
+      prev = ctf_add_pointer (fp, CTF_ADD_ROOT,
+			      ctf_add_typedef (fp, flag, name, s));
+
+      ar.ctr_contents = prev;
+      ar.ctr_index = it;
+      ar.ctr_nelems = i;
+      CHECK (ctf_add_array (fp, CTF_ADD_ROOT, &ar) != CTF_ERR);
+
+      if (i % 10 == 0)
+	{
+	  sprintf (name, "e%i", i);
+	  e = ctf_add_enum (fp, flag, name);
+	  sprintf (name, "E%i_0", i);
+	  CHECK (ctf_add_enumerator (fp, e, name, 0) == 0);
+	  sprintf (name, "E%i_1", i);
+	  CHECK (ctf_add_enumerator (fp, e, name, i) == 0);
+
+	  sprintf (name, "u%i", i);
+	  CHECK (ctf_add_union (fp, flag, name) != CTF_ERR);
+	  sprintf (name, "f%i", i);
+	  CHECK (ctf_add_forward (fp, CTF_ADD_ROOT, name, CTF_K_STRUCT)
+		 != CTF_ERR);
+
+	  sprintf (name, "v%i", i);
+	  CHECK (ctf_add_variable (fp, name, prev) == 0);
+	}
+    }
+
+  args[0] = prev;
+  args[1] = dt;
+  fi.ctc_return = it;
+  fi.ctc_argc = 2;
+  CHECK (ctf_add_function (fp, CTF_ADD_ROOT, &fi, args) != CTF_ERR);
+  CHECK (ctf_add_volatile (fp, CTF_ADD_ROOT,
+			   ctf_add_restrict (fp, CTF_ADD_ROOT, prev))
+	 != CTF_ERR);
+  CHECK (ctf_update (fp) == 0);
+  return fp;
+}
+
+/* Describe the members of TYPE in BUF, using the cursor iterator.  */
+
+static size_t
+members_by_next (ctf_file_t *fp, ctf_id_t type, char *buf, size_t len)
+{
+  ctf_next_t it = CTF_NEXT_INIT;
+  const char *name;
+  ctf_id_t membtype;
+  ssize_t off;
+  size_t n = 0;
+
+  buf[0] = '\0';
+  while ((off = ctf_member_next (fp, type, &it, &name, &membtype)) >= 0)
+    n += snprintf (buf + n, len - n, " %s:%li@%zi", name, membtype, off);
+  CHECK (ctf_errno (fp) == ECTF_NEXT_END);
+  return n;
+}
+
+/* The same, using the callback iterator.  */
+
+typedef struct members_state
+{
+  char *ms_buf;
+  size_t ms_len;
+  size_t ms_n;
+} members_state_t;
+
+static int
+member_cb (const char *name, ctf_id_t membtype, unsigned long offset,
+	   void *arg)
+{
+  members_state_t *ms = arg;
+
+  ms->ms_n += snprintf (ms->ms_buf + ms->ms_n, ms->ms_len - ms->ms_n,
+			" %s:%li@%lu", name, membtype, offset);
+  return 0;
+}
+
+static size_t
+members_by_iter (ctf_file_t *fp, ctf_id_t type, char *buf, size_t len)
+{
+  members_state_t ms = { buf, len, 0 };
+
+  buf[0] = '\0';
+  CHECK (ctf_member_iter (fp, type, member_cb, &ms) == 0);
+  return ms.ms_n;
+}
+
+/* Describe TYPE, in as much detail as there is, in BUF.  */
+
+static void
+describe (ctf_file_t *fp, ctf_id_t type, char *buf, size_t len)
+{
+  char *name = ctf_type_aname (fp, type);
+  ctf_arinfo_t ar;
+  size_t n;
+  int kind = ctf_type_kind (fp, type);
+
+  n = snprintf (buf, len, "%i %s %zi %zi %li %li", kind,
+		name ? name : "(null)", ctf_type_size (fp, type),
+		ctf_type_align (fp, type), ctf_type_reference (fp, type),
+		ctf_type_resolve (fp, type));
+  free (name);
+
+  switch (kind)
+    {
+    case CTF_K_STRUCT:
+    case CTF_K_UNION:
+      n += members_by_next (fp, type, buf + n, len - n);
+      break;
+    case CTF_K_ENUM:
+      {
+	ctf_next_t it = CTF_NEXT_INIT;
+	const char *ename;
+	int val;
+
+	while ((ename = ctf_enum_next (fp, type, &it, &val)) != NULL)
+	  n += snprintf (buf + n, len - n, " %s=%i", ename, val);
+	CHECK (ctf_errno (fp) == ECTF_NEXT_END);
+      }
+      break;
+    case CTF_K_ARRAY:
+      CHECK (ctf_array_info (fp, type, &ar) == 0);
+      n += snprintf (buf + n, len - n, " [%li:%u]", ar.ctr_contents,
+		     ar.ctr_nelems);
+      break;
+    }
+  CHECK (n < len);
+}
+
+/* Check the description of each type passed to ctf_type_iter_all() or
+   ctf_type_iter_kind(), and count them.  */
+
+typedef struct desc_state
+{
+  ctf_file_t *ds_fp;
+  char **ds_descs;
+  size_t ds_n;
+  int ds_kind;
+} desc_state_t;
+
+static int
+type_cb (ctf_id_t type, int flag, void *arg)
+{
+  desc_state_t *ds = arg;
+  char buf[16384];
+
+  CHECK (ds->ds_descs[type] != NULL);
+  describe (ds->ds_fp, type, buf, sizeof (buf));
+  CHECK (strcmp (ds->ds_descs[type], buf) == 0);
+  if (ds->ds_kind >= 0)
+    CHECK (ctf_type_kind (ds->ds_fp, type) == ds->ds_kind);
+  ds->ds_n++;
+  return 0;
+}
+
+/* Check that everything FP says about its types matches the descriptions in
+   DESCS, built from the indexed open, and check the iterators against each
+   other.  */
+
+static void
+check (ctf_file_t *fp, char **descs, size_t ntypes)
+{
+  ctf_next_t it = CTF_NEXT_INIT;
+  desc_state_t ds = { fp, descs, 0, -1 };
+  const char *vname;
+  ctf_id_t type, prev = 0;
+  size_t nroot = 0, nkinds = 0;
+  int flag, kind;
+
+  /* Every type, in order, with its root flag.  */
+
+  while ((type = ctf_type_next (fp, &it, &flag, 1)) != CTF_ERR)
+    {
+      char buf[16384];
+
+      CHECK (type == prev + 1);
+      prev = type;
+      describe (fp, type, buf, sizeof (buf));
+      CHECK (strcmp (descs[type], buf) == 0);
+      if (flag == CTF_ADD_ROOT)
+	nroot++;
+    }
+  CHECK (ctf_errno (fp) == ECTF_NEXT_END);
+  CHECK ((size_t) prev == ntypes);
+
+  CHECK (ctf_type_iter_all (fp, type_cb, &ds) == 0);
+  CHECK (ds.ds_n == ntypes);
+
+  /* Only root types.  */
+
+  prev = 0;
+  while ((type = ctf_type_next (fp, &it, NULL, 0)) != CTF_ERR)
+    {
+      CHECK (type > prev);
+      prev = type;
+      nroot--;
+    }
+  CHECK (ctf_errno (fp) == ECTF_NEXT_END && nroot == 0);
+
+  /* Every kind in turn, which between them cover every type once.  */
+
+  for (kind = CTF_K_UNKNOWN; kind <= CTF_K_MAX; kind++)
+    {
+      ds.ds_n = 0;
+      ds.ds_kind = kind;
+      CHECK (ctf_type_iter_kind (fp, kind, type_cb, &ds) == 0);
+      nkinds += ds.ds_n;
+    }
+  CHECK (nkinds == ntypes);
+  CHECK (ctf_type_iter_kind (fp, CTF_K_MAX + 1, type_cb, &ds) < 0);
+
+  /* Members, as seen by ctf_member_iter().  */
+
+  for (type = 1; (size_t) type <= ntypes; type++)
+    if (ctf_type_kind (fp, type) == CTF_K_STRUCT
+	|| ctf_type_kind (fp, type) == CTF_K_UNION)
+      {
+	char bynext[16384], byiter[16384];
+
+	members_by_next (fp, type, bynext, sizeof (bynext));
+	members_by_iter (fp, type, byiter, sizeof (byiter));
+	CHECK (strcmp (bynext, byiter) == 0);
+      }
+
+  /* Variables, in name order, each the pointer type defined just before.  */
+
+  prev = 0;
+  while ((type = ctf_variable_next (fp, &it, &vname)) != CTF_ERR)
+    {
+      CHECK (ctf_lookup_variable (fp, vname) == type);
+      CHECK (ctf_type_kind (fp, type) == CTF_K_POINTER);
+      prev++;
+    }
+  CHECK (ctf_errno (fp) == ECTF_NEXT_END);
+  CHECK (prev == NSTRUCTS / 10);
+
+  /* An abandoned cursor needs no cleanup, and one used on another container
+     is rejected.  */
+
+  CHECK (ctf_type_next (fp, &it, NULL, 1) == 1);
+  {
+    int err;
+    ctf_file_t *other = ctf_create (&err);
+
+    CHECK (ctf_type_next (other, &it, NULL, 1) == CTF_ERR);
+    CHECK (ctf_errno (other) == EINVAL);
+    ctf_file_close (other);
+  }
+}
+
+/* Check everything a view of FP says against FP itself.  */
+
+static void
+check_view (ctf_file_t *fp, size_t ntypes)
+{
+  const ctf_view_t *v;
+  ctf_id_t type;
+
+  CHECK ((v = ctf_view_acquire (fp)) != NULL);
+  CHECK (v->ctv_version == CTF_VIEW_VERSION);
+  CHECK (v->ctv_type_size >= sizeof (ctf_view_type_t));
+  CHECK (v->ctv_typemax == ntypes);
+
+  for (type = 1; (size_t) type <= ntypes; type++)
+    {
+      ssize_t size = ctf_view_size (v, type);
+
+      CHECK (ctf_view_kind (v, type) == ctf_type_kind (fp, type));
+      CHECK (ctf_view_reference (v, type) == ctf_type_reference (fp, type));
+      CHECK (ctf_view_resolve (v, type) == ctf_type_resolve (fp, type));
+      CHECK (size < 0 || size == ctf_type_size (fp, type));
+    }
+  CHECK (ctf_view_kind (v, 0) < 0);
+  CHECK (ctf_view_kind (v, ntypes + 1) < 0);
+}
+
+int
+main (void)
+{
+  ctf_file_t *wfp = build (), *fp;
+  char **descs;
+  unsigned char *buf;
+  size_t ntypes = 0;
+  ctf_next_t it = CTF_NEXT_INIT;
+  ctf_id_t type, *byname;
+  int how;
+
+  CHECK (ctf_view (wfp, CTF_VIEW_VERSION) == NULL);
+  CHECK (ctf_errno (wfp) == ECTF_NOVIEW);
+
+  /* Describe the types as the indexed open sees them.  */
+
+  fp = test_reopen (wfp, TEST_INDEXED, &buf);
+  while (ctf_type_next (fp, &it, NULL, 1) != CTF_ERR)
+    ntypes++;
+  CHECK ((descs = calloc (ntypes + 1, sizeof (char *))) != NULL);
+  CHECK ((byname = calloc (ntypes + 1, sizeof (ctf_id_t))) != NULL);
+  for (type = 1; (size_t) type <= ntypes; type++)
+    {
+      char desc[16384];
+
+      describe (fp, type, desc, sizeof (desc));
+      CHECK ((descs[type] = strdup (desc)) != NULL);
+    }
+  ctf_file_close (fp);
+  free (buf);
+
+  check (wfp, descs, ntypes);
+  for (how = 0; how < TEST_NOPEN; how++)
+    {
+      fp = test_reopen (wfp, how, &buf);
+
+      /* Views first, so that lazy containers build them on demand.  */
+
+      check_view (fp, ntypes);
+      check (fp, descs, ntypes);
+
+      /* Name lookups of every type in the container must find the same
+	 types however it was opened.  */
+
+      for (type = 1; (size_t) type <= ntypes; type++)
+	{
+	  char *name = ctf_type_aname (fp, type);
+	  ctf_id_t found = ctf_lookup_by_name (fp, name);
+
+	  if (how == TEST_INDEXED)
+	    byname[type] = found;
+	  CHECK (found == byname[type]);
+	  free (name);
+	}
+
+      CHECK (ctf_view (fp, CTF_VIEW_VERSION + 1) == NULL);
+      CHECK (ctf_errno (fp) == ECTF_VIEWVERS);
+      ctf_file_close (fp);
+      free (buf);
+    }
+
+  for (type = 1; (size_t) type <= ntypes; type++)
+    free (descs[type]);
+  free (descs);
+  free (byname);
+  ctf_file_close (wfp);
+  return 0;
+}
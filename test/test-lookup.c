@@ -0,0 +1,275 @@
+/* Check the batched lookup functions against their single-item counterparts.
+
+   Copyright (c) 2019, Oracle and/or its affiliates. All rights reserved.
+
+   Licensed under the Universal Permissive License v 1.0 as shown at
+   http://oss.oracle.com/licenses/upl.
+
+   Licensed under the GNU General Public License (GPL), version 2. See the file
+   COPYING in the top level of this tree.  */
+
+#include "test.h"
+
+#define NMEMBERS 40
+#define NENUMS 100
+
+static const char *type_names[] =
+  { "int", "char", "long", "myint", "myint *", "int *", "const int",
+    "struct s", "struct s *", "struct big", "union u", "enum e", "enum bige",
+    "s", "u", "nonexistent", "struct nope", "int **", "struct s **",
+    "const int *", "volatile int", "", "int[", "int ", " int", "int",
+    "struct s" };
+
+#define NTYPE_NAMES (sizeof (type_names) / sizeof (type_names[0]))
+
+static const char *var_names[] = { "v1", "v2", "v3", "nope", "v1", "" };
+
+#define NVAR_NAMES (sizeof (var_names) / sizeof (var_names[0]))
+
+/* Build the container the tests look things up in.  */
+
+static ctf_file_t *
+build (void)
+{
+  ctf_encoding_t ie = { CTF_INT_SIGNED, 0, 32 };
+  ctf_encoding_t ce = { CTF_INT_SIGNED | CTF_INT_CHAR, 0, 8 };
+  ctf_encoding_t le = { CTF_INT_SIGNED, 0, 64 };
+  ctf_id_t it, ct, lt, td, st, big, un, en, bige;
+  ctf_file_t *fp;
+  char name[32];
+  int err, i;
+
+  CHECK ((fp = ctf_create (&err)) != NULL);
+  it = ctf_add_integer (fp, CTF_ADD_ROOT, "int", &ie);
+  ct = ctf_add_integer (fp, CTF_ADD_ROOT, "char", &ce);
+  lt = ctf_add_integer (fp, CTF_ADD_ROOT, "long", &le);
+  td = ctf_add_typedef (fp, CTF_ADD_ROOT, "myint", it);
+  CHECK (ctf_add_pointer (fp, CTF_ADD_ROOT, td) != CTF_ERR);
+  CHECK (ctf_add_pointer (fp, CTF_ADD_ROOT, it) != CTF_ERR);
+  CHECK (ctf_add_const (fp, CTF_ADD_ROOT, it) != CTF_ERR);
+
+  st = ctf_add_struct (fp, CTF_ADD_ROOT, "s");
+  CHECK (ctf_add_member (fp, st, "a", it) == 0);
+  CHECK (ctf_add_member (fp, st, "b", ct) == 0);
+  CHECK (ctf_add_member (fp, st, "c", lt) == 0);
+  CHECK (ctf_add_pointer (fp, CTF_ADD_ROOT, st) != CTF_ERR);
+
+  big = ctf_add_struct (fp, CTF_ADD_ROOT, "big");
+  for (i = 0; i < NMEMBERS; i++)
+    {
+      sprintf (name, "m%i", i);
+      CHECK (ctf_add_member (fp, big, name, i % 2 ? it : lt) == 0);
+    }
+
+  un = ctf_add_union (fp, CTF_ADD_ROOT, "u");
+  CHECK (ctf_add_member (fp, un, "i", it) == 0);
+  CHECK (ctf_add_member (fp, un, "l", lt) == 0);
+
+  en = ctf_add_enum (fp, CTF_ADD_ROOT, "e");
+  CHECK (ctf_add_enumerator (fp, en, "A", 1) == 0);
+  CHECK (ctf_add_enumerator (fp, en, "B", 2) == 0);
+  CHECK (ctf_add_enumerator (fp, en, "C", 2) == 0);
+
+  bige = ctf_add_enum (fp, CTF_ADD_ROOT, "bige");
+  for (i = 0; i < NENUMS; i++)
+    {
+      sprintf (name, "E%i", i);
+      CHECK (ctf_add_enumerator (fp, bige, name, i * 7 % 13) == 0);
+    }
+
+  CHECK (ctf_add_variable (fp, "v1", it) == 0);
+  CHECK (ctf_add_variable (fp, "v2", st) == 0);
+  CHECK (ctf_add_variable (fp, "v3", td) == 0);
+  CHECK (ctf_update (fp) == 0);
+  return fp;
+}
+
+/* Look the type names up a batch at a time, with and without precomputed
+   hashes, and compare with ctf_lookup_by_name().  Do it twice, so that the
+   second round is answered from the name lookup cache, if any.  */
+
+static void
+check_names (ctf_file_t *fp)
+{
+  const char *names[NTYPE_NAMES * 3];
+  uint32_t hashes[NTYPE_NAMES * 3];
+  ctf_id_t ids[NTYPE_NAMES * 3], hids[NTYPE_NAMES * 3];
+  ssize_t found, hfound;
+  size_t i, n = NTYPE_NAMES * 3;
+  int round;
+
+  for (i = 0; i < n; i++)
+    {
+      names[i] = type_names[i % NTYPE_NAMES];
+      hashes[i] = ctf_name_hash (names[i]);
+    }
+
+  for (round = 0; round < 2; round++)
+    {
+      found = ctf_lookup_by_name_n (fp, names, n, ids);
+      hfound = ctf_lookup_by_name_hashed_n (fp, names, hashes, n, hids);
+
+      for (i = 0; i < n; i++)
+	{
+	  ctf_id_t id = ctf_lookup_by_name (fp, names[i]);
+
+	  CHECK (ids[i] == id);
+	  CHECK (hids[i] == id);
+	  if (id != CTF_ERR)
+	    found--, hfound--;
+	}
+      CHECK (found == 0);
+      CHECK (hfound == 0);
+    }
+
+  CHECK (ctf_lookup_by_name (fp, "struct s") != CTF_ERR);
+  CHECK (ctf_lookup_by_name (fp, "nonexistent") == CTF_ERR);
+  CHECK (ctf_lookup_by_name_n (fp, names, 0, ids) == 0);
+}
+
+/* Likewise for variables.  */
+
+static void
+check_variables (ctf_file_t *fp)
+{
+  ctf_id_t types[NVAR_NAMES];
+  ssize_t found;
+  size_t i;
+
+  found = ctf_lookup_variable_n (fp, var_names, NVAR_NAMES, types);
+  for (i = 0; i < NVAR_NAMES; i++)
+    {
+      ctf_id_t type = ctf_lookup_variable (fp, var_names[i]);
+
+      CHECK (types[i] == type);
+      if (type != CTF_ERR)
+	found--;
+    }
+  CHECK (found == 0);
+}
+
+/* Look the members of TYPE named in NAMES up together, and compare with
+   ctf_member_info().  */
+
+static void
+check_members_of (ctf_file_t *fp, ctf_id_t type, const char **names, size_t n)
+{
+  ctf_membinfo_t mis[NMEMBERS * 2 + 2];
+  ssize_t found;
+  size_t i;
+
+  found = ctf_member_info_n (fp, type, names, n, mis);
+  for (i = 0; i < n; i++)
+    {
+      ctf_membinfo_t mi;
+
+      if (ctf_member_info (fp, type, names[i], &mi) < 0)
+	{
+	  CHECK (ctf_errno (fp) == ECTF_NOMEMBNAM);
+	  CHECK (mis[i].ctm_type == CTF_ERR);
+	  continue;
+	}
+      CHECK (mis[i].ctm_type == mi.ctm_type);
+      CHECK (mis[i].ctm_offset == mi.ctm_offset);
+      found--;
+    }
+  CHECK (found == 0);
+}
+
+static void
+check_members (ctf_file_t *fp)
+{
+  const char *small[] = { "c", "a", "nope", "b", "a" };
+  const char *names[NMEMBERS * 2 + 2];
+  static char buf[NMEMBERS * 2][8];
+  ctf_membinfo_t mi;
+  size_t i;
+
+  check_members_of (fp, ctf_lookup_by_name (fp, "struct s"), small, 5);
+  check_members_of (fp, ctf_lookup_by_name (fp, "union u"), small, 5);
+
+  /* Backwards, with every other name missing.  */
+
+  for (i = 0; i < NMEMBERS * 2; i++)
+    {
+      sprintf (buf[i], "%c%i", i % 2 ? 'x' : 'm', NMEMBERS - 1 - (int) i / 2);
+      names[i] = buf[i];
+    }
+  names[i++] = "m0";
+  names[i++] = "";
+  check_members_of (fp, ctf_lookup_by_name (fp, "struct big"), names, i);
+
+  CHECK (ctf_member_info_n (fp, ctf_lookup_by_name (fp, "int"), small, 5,
+			    &mi) < 0);
+  CHECK (ctf_errno (fp) == ECTF_NOTSOU);
+}
+
+/* Look every enumerator up by name, and compare with the enum's own view of
+   it.  */
+
+static int
+check_enumerator (const char *name, int val, void *arg)
+{
+  ctf_file_t *fp = arg;
+  ctf_id_t type;
+  int v;
+
+  CHECK ((type = ctf_lookup_enumerator (fp, name, &v)) != CTF_ERR);
+  CHECK (v == val);
+  CHECK (ctf_enum_value (fp, type, name, &v) == 0 && v == val);
+  return 0;
+}
+
+static void
+check_enumerators (ctf_file_t *fp)
+{
+  ctf_id_t e = ctf_lookup_by_name (fp, "enum e");
+  ctf_id_t bige = ctf_lookup_by_name (fp, "enum bige");
+  int v;
+
+  CHECK (ctf_enum_iter (fp, e, check_enumerator, fp) == 0);
+  CHECK (ctf_enum_iter (fp, bige, check_enumerator, fp) == 0);
+  CHECK (ctf_lookup_enumerator (fp, "A", NULL) == e);
+  CHECK (ctf_lookup_enumerator (fp, "E99", &v) == bige && v == 99 * 7 % 13);
+  CHECK (ctf_lookup_enumerator (fp, "Z", &v) == CTF_ERR);
+
+  /* The first of several enumerators with the same value is found.  */
+
+  CHECK (strcmp (ctf_enum_name (fp, e, 2), "B") == 0);
+  CHECK (strcmp (ctf_enum_name (fp, bige, 0), "E0") == 0);
+  CHECK (strcmp (ctf_enum_name (fp, bige, 7), "E1") == 0);
+  CHECK (ctf_enum_name (fp, bige, 13) == NULL);
+}
+
+static void
+check (ctf_file_t *fp)
+{
+  check_names (fp);
+  check_variables (fp);
+  check_members (fp);
+  check_enumerators (fp);
+}
+
+int
+main (void)
+{
+  ctf_file_t *wfp = build ();
+  int how;
+
+  check (wfp);
+
+  for (how = 0; how < TEST_NOPEN; how++)
+    {
+      unsigned char *buf;
+      ctf_file_t *fp = test_reopen (wfp, how, &buf);
+
+      check (fp);
+      ctf_setnamecache (fp, 1);
+      check (fp);
+      ctf_file_close (fp);
+      free (buf);
+    }
+
+  ctf_file_close (wfp);
+  return 0;
+}
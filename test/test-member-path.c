@@ -0,0 +1,306 @@
+/* Check member paths into nested structures, arrays and bitfields, and that
+   their cached results are thrown away when the types they depend on change.
+
+   Copyright (c) 2019, Oracle and/or its affiliates. All rights reserved.
+
+   Licensed under the Universal Permissive License v 1.0 as shown at
+   http://oss.oracle.com/licenses/upl.
+
+   Licensed under the GNU General Public License (GPL), version 2. See the file
+   COPYING in the top level of this tree.  */
+
+#include "test.h"
+
+/* The types in the container the paths are evaluated in.  */
+
+struct types
+{
+  ctf_id_t it;
+  ctf_id_t bf;
+  ctf_id_t inner;
+  ctf_id_t outer;
+  ctf_id_t flex;
+  ctf_id_t other;
+};
+
+/* Build, roughly,
+
+   struct inner { int x; int bf:5 (at bit 35); int *p; };
+   struct outer { long l; struct inner in[4]; struct inner one; };
+   struct flex { int n; int data[]; };
+   struct other { char pad[3]; struct inner in[2]; };  */
+
+static ctf_file_t *
+build (struct types *t)
+{
+  ctf_encoding_t ie = { CTF_INT_SIGNED, 0, 32 };
+  ctf_encoding_t le = { CTF_INT_SIGNED, 0, 64 };
+  ctf_encoding_t ce = { CTF_INT_SIGNED | CTF_INT_CHAR, 0, 8 };
+  ctf_encoding_t se = { CTF_INT_SIGNED, 3, 5 };
+  ctf_arinfo_t ar;
+  ctf_id_t lt, ct, p;
+  ctf_file_t *fp;
+  int err;
+
+  CHECK ((fp = ctf_create (&err)) != NULL);
+  t->it = ctf_add_integer (fp, CTF_ADD_ROOT, "int", &ie);
+  lt = ctf_add_integer (fp, CTF_ADD_ROOT, "long", &le);
+  ct = ctf_add_integer (fp, CTF_ADD_ROOT, "char", &ce);
+  t->bf = ctf_add_slice (fp, CTF_ADD_NONROOT, t->it, &se);
+  p = ctf_add_pointer (fp, CTF_ADD_ROOT, t->it);
+
+  t->inner = ctf_add_struct (fp, CTF_ADD_ROOT, "inner");
+  CHECK (ctf_add_member_offset (fp, t->inner, "x", t->it, 0) == 0);
+  CHECK (ctf_add_member_offset (fp, t->inner, "bf", t->bf, 32) == 0);
+  CHECK (ctf_add_member_offset (fp, t->inner, "p", p, 64) == 0);
+
+  ar.ctr_contents = t->inner;
+  ar.ctr_index = t->it;
+  ar.ctr_nelems = 4;
+  t->outer = ctf_add_struct (fp, CTF_ADD_ROOT, "outer");
+  CHECK (ctf_add_member (fp, t->outer, "l", lt) == 0);
+  CHECK (ctf_add_member (fp, t->outer, "in",
+			 ctf_add_array (fp, CTF_ADD_ROOT, &ar)) == 0);
+  CHECK (ctf_add_member (fp, t->outer, "one", t->inner) == 0);
+
+  ar.ctr_contents = t->it;
+  ar.ctr_nelems = 0;
+  t->flex = ctf_add_struct (fp, CTF_ADD_ROOT, "flex");
+  CHECK (ctf_add_member (fp, t->flex, "n", t->it) == 0);
+  CHECK (ctf_add_member (fp, t->flex, "data",
+			 ctf_add_array (fp, CTF_ADD_ROOT, &ar)) == 0);
+
+  ar.ctr_contents = ct;
+  ar.ctr_nelems = 3;
+  t->other = ctf_add_struct (fp, CTF_ADD_ROOT, "other");
+  CHECK (ctf_add_member (fp, t->other, "pad",
+			 ctf_add_array (fp, CTF_ADD_ROOT, &ar)) == 0);
+  ar.ctr_contents = t->inner;
+  ar.ctr_nelems = 2;
+  CHECK (ctf_add_member (fp, t->other, "in",
+			 ctf_add_array (fp, CTF_ADD_ROOT, &ar)) == 0);
+
+  CHECK (ctf_setmodel (fp, CTF_MODEL_LP64) == 0);
+  CHECK (ctf_update (fp) == 0);
+  return fp;
+}
+
+/* Compile PATH against TYPE, and check what it names.  */
+
+static void
+check_path (ctf_file_t *fp, ctf_id_t type, const char *path,
+	    ctf_id_t mtype, unsigned long offset, unsigned long bits)
+{
+  ctf_member_path_t *mp;
+  ctf_pathinfo_t pi;
+
+  if ((mp = ctf_member_path_compile (fp, type, path)) == NULL)
+    fprintf (stderr, "cannot compile %s: %s\n", path,
+	     ctf_errmsg (ctf_errno (fp)));
+  CHECK (mp != NULL);
+  CHECK (ctf_member_path_info (mp, fp, type, &pi) == 0);
+  CHECK (pi.ctp_type == mtype);
+  CHECK (pi.ctp_offset == offset);
+  CHECK (pi.ctp_bits == bits);
+  ctf_member_path_free (mp);
+}
+
+/* Check that PATH cannot be compiled against TYPE, failing with ERR.  */
+
+static void
+check_bad_path (ctf_file_t *fp, ctf_id_t type, const char *path, int err)
+{
+  CHECK (ctf_member_path_compile (fp, type, path) == NULL);
+  CHECK (ctf_errno (fp) == err);
+}
+
+static void
+check (ctf_file_t *fp, const struct types *t)
+{
+  ctf_id_t types[5] = { t->outer, t->other, t->flex, t->outer, t->it };
+  ctf_pathinfo_t pis[5], pi;
+  ctf_member_path_t *mp;
+  ctf_membinfo_t mi;
+  size_t i;
+
+  /* Members, array elements and bitfields.  The inner structure is 128 bits
+     long, and starts 64 bits into the outer one.  */
+
+  check_path (fp, t->inner, "x", t->it, 0, 32);
+  check_path (fp, t->inner, ".bf", t->bf, 35, 5);
+  check_path (fp, t->inner, "p", ctf_type_pointer (fp, t->it), 64, 64);
+  check_path (fp, t->outer, "in[0].x", t->it, 64, 32);
+  check_path (fp, t->outer, "in[2].bf", t->bf, 64 + 2 * 128 + 35, 5);
+  check_path (fp, t->outer, "in[3]", t->inner, 64 + 3 * 128, 128);
+  check_path (fp, t->outer, "in[0x3].p", ctf_type_pointer (fp, t->it),
+	      64 + 3 * 128 + 64, 64);
+  CHECK (ctf_member_info (fp, t->outer, "in", &mi) == 0);
+  check_path (fp, t->outer, "in", mi.ctm_type, 64, 4 * 128);
+  check_path (fp, t->outer, "one.bf", t->bf, 64 + 4 * 128 + 35, 5);
+  check_path (fp, t->flex, "data[0]", t->it, 32, 32);
+  check_path (fp, t->flex, "data[1000]", t->it, 32 + 1000 * 32, 32);
+
+  /* Out-of-range indexes, unknown members and syntax errors.  */
+
+  check_bad_path (fp, t->outer, "in[4].x", ECTF_BADID);
+  check_bad_path (fp, t->outer, "in[-1]", ECTF_BADID);
+  check_bad_path (fp, t->flex, "data[0x1000000000000000]", ECTF_BADID);
+  check_bad_path (fp, t->outer, "in[0].y", ECTF_NOMEMBNAM);
+  check_bad_path (fp, t->outer, "l[0]", ECTF_NOTARRAY);
+  check_bad_path (fp, t->outer, "in[0]..x", ECTF_SYNTAX);
+  check_bad_path (fp, t->outer, "in[0", ECTF_SYNTAX);
+  check_bad_path (fp, t->outer, "in[]", ECTF_SYNTAX);
+  check_bad_path (fp, t->outer, "in.", ECTF_SYNTAX);
+  check_bad_path (fp, t->outer, "in[0]x", ECTF_SYNTAX);
+
+  /* The same path evaluated against several types at once must agree with
+     evaluating it against each in turn.  */
+
+  CHECK ((mp = ctf_member_path_compile (fp, t->outer, "in[1].bf")) != NULL);
+  CHECK (ctf_member_path_info_n (mp, fp, types, 5, pis) == 3);
+  for (i = 0; i < 5; i++)
+    {
+      if (ctf_member_path_info (mp, fp, types[i], &pi) < 0)
+	{
+	  CHECK (pis[i].ctp_type == CTF_ERR);
+	  continue;
+	}
+      CHECK (pis[i].ctp_type == pi.ctp_type);
+      CHECK (pis[i].ctp_offset == pi.ctp_offset);
+      CHECK (pis[i].ctp_bits == pi.ctp_bits);
+    }
+  CHECK (pis[1].ctp_offset == 32 + 128 + 35);
+  ctf_member_path_free (mp);
+}
+
+/* Changing the data model of a container, or of its parent, must change the
+   width of pointers a compiled path names.  */
+
+static void
+check_model (ctf_file_t *fp, const struct types *t)
+{
+  ctf_member_path_t *mp;
+  ctf_pathinfo_t pi;
+
+  CHECK ((mp = ctf_member_path_compile (fp, t->outer, "one.p")) != NULL);
+  CHECK (ctf_member_path_info (mp, fp, t->outer, &pi) == 0);
+  CHECK (pi.ctp_bits == 64);
+  CHECK (ctf_setmodel (fp, CTF_MODEL_ILP32) == 0);
+  CHECK (ctf_member_path_info (mp, fp, t->outer, &pi) == 0);
+  CHECK (pi.ctp_bits == 32);
+  CHECK (ctf_setmodel (fp, CTF_MODEL_LP64) == 0);
+  CHECK (ctf_member_path_info (mp, fp, t->outer, &pi) == 0);
+  CHECK (pi.ctp_bits == 64);
+  ctf_member_path_free (mp);
+}
+
+/* Build a parent whose third type is a typedef named "word" of a 32-bit or
+   64-bit integer, and whose fourth is a pointer to int.  */
+
+static ctf_file_t *
+build_parent (int bits, unsigned char **bufp)
+{
+  ctf_encoding_t ie = { CTF_INT_SIGNED, 0, 32 };
+  ctf_encoding_t le = { CTF_INT_SIGNED, 0, 64 };
+  ctf_file_t *wfp, *fp;
+  ctf_id_t it, lt;
+  int err;
+
+  CHECK ((wfp = ctf_create (&err)) != NULL);
+  it = ctf_add_integer (wfp, CTF_ADD_ROOT, "int", &ie);
+  lt = ctf_add_integer (wfp, CTF_ADD_ROOT, "long", &le);
+  CHECK (ctf_add_typedef (wfp, CTF_ADD_ROOT, "word",
+			  bits == 32 ? it : lt) == 3);
+  CHECK (ctf_add_pointer (wfp, CTF_ADD_ROOT, it) == 4);
+  fp = test_reopen (wfp, TEST_INDEXED, bufp);
+  CHECK (ctf_setmodel (fp, CTF_MODEL_LP64) == 0);
+  ctf_file_close (wfp);
+  return fp;
+}
+
+/* Importing a different parent must change what a path compiled in a child
+   against the old parent's types names.  */
+
+static void
+check_import (void)
+{
+  unsigned char *p32buf, *p64buf, *buf;
+  ctf_file_t *p32 = build_parent (32, &p32buf);
+  ctf_file_t *p64 = build_parent (64, &p64buf);
+  ctf_file_t *wfp, *fp;
+  ctf_member_path_t *mp;
+  ctf_pathinfo_t pi;
+  ctf_id_t st;
+  int err, how;
+
+  CHECK ((wfp = ctf_create (&err)) != NULL);
+  CHECK (ctf_import (wfp, p32) == 0);
+  st = ctf_add_struct (wfp, CTF_ADD_ROOT, "c");
+  CHECK (ctf_add_member_offset (wfp, st, "w", 3, 0) == 0);
+  CHECK (ctf_add_member_offset (wfp, st, "p", 4, 64) == 0);
+
+  for (how = 0; how < TEST_NOPEN; how++)
+    {
+      fp = test_reopen (wfp, how, &buf);
+      CHECK (ctf_import (fp, p32) == 0);
+      CHECK ((mp = ctf_member_path_compile (fp, st, "w")) != NULL);
+      CHECK (ctf_member_path_info (mp, fp, st, &pi) == 0);
+      CHECK (pi.ctp_bits == 32);
+
+      CHECK (ctf_import (fp, p64) == 0);
+      CHECK (ctf_member_path_info (mp, fp, st, &pi) == 0);
+      CHECK (pi.ctp_bits == 64);
+
+      CHECK (ctf_import (fp, p32) == 0);
+      CHECK (ctf_member_path_info (mp, fp, st, &pi) == 0);
+      CHECK (pi.ctp_bits == 32);
+      ctf_member_path_free (mp);
+
+      /* Changing the parent's data model changes the width of pointers to
+	 its types in the child, too.  */
+
+      CHECK ((mp = ctf_member_path_compile (fp, st, "p")) != NULL);
+      CHECK (ctf_member_path_info (mp, fp, st, &pi) == 0);
+      CHECK (pi.ctp_offset == 64 && pi.ctp_bits == 64);
+      CHECK (ctf_setmodel (p32, CTF_MODEL_ILP32) == 0);
+      CHECK (ctf_member_path_info (mp, fp, st, &pi) == 0);
+      CHECK (pi.ctp_offset == 64 && pi.ctp_bits == 32);
+      CHECK (ctf_setmodel (p32, CTF_MODEL_LP64) == 0);
+      CHECK (ctf_member_path_info (mp, fp, st, &pi) == 0);
+      CHECK (pi.ctp_bits == 64);
+      ctf_member_path_free (mp);
+
+      ctf_file_close (fp);
+      free (buf);
+    }
+
+  ctf_file_close (wfp);
+  ctf_file_close (p64);
+  ctf_file_close (p32);
+  free (p64buf);
+  free (p32buf);
+}
+
+int
+main (void)
+{
+  struct types t;
+  ctf_file_t *wfp = build (&t);
+  int how;
+
+  for (how = 0; how < TEST_NOPEN; how++)
+    {
+      unsigned char *buf;
+      ctf_file_t *fp = test_reopen (wfp, how, &buf);
+
+      CHECK (ctf_setmodel (fp, CTF_MODEL_LP64) == 0);
+      check (fp, &t);
+      check_model (fp, &t);
+      ctf_file_close (fp);
+      free (buf);
+    }
+
+  check_import ();
+  ctf_file_close (wfp);
+  return 0;
+}
@@ -0,0 +1,367 @@
+/* Check the symbol, address and function-type lookups against each other, in
+   containers opened both eagerly and lazily.
+
+   Copyright (c) 2019, Oracle and/or its affiliates. All rights reserved.
+
+   Licensed under the Universal Permissive License v 1.0 as shown at
+   http://oss.oracle.com/licenses/upl.
+
+   Licensed under the GNU General Public License (GPL), version 2. See the file
+   COPYING in the top level of this tree.  */
+
+#include "test.h"
+#include <elf.h>
+
+/* Symbols 1 .. NSYMS alternate between objects and functions.  Even symbols
+   are functions f<N>, 16 bytes long, at 0x100000 + N * 16, taking a char and
+   returning int or const int * if N is a multiple of 4 and of 8 respectively,
+   and otherwise taking nothing and returning char.  Odd symbols are objects
+   o<N>, 8 bytes long, at 0x800000 + N * 8, of type char if N is a multiple of
+   3 and int otherwise.  A local and then a global object both called "dup"
+   follow.  */
+
+#define NSYMS 400
+#define NALLSYMS (NSYMS + 3)
+
+struct types
+{
+  ctf_id_t t_int;
+  ctf_id_t t_char;
+  ctf_id_t t_cp;
+  ctf_id_t t_td;
+};
+
+static char strtab[NALLSYMS * 8];
+static size_t strtab_len;
+
+static uint32_t
+add_string (const char *s)
+{
+  uint32_t off = strtab_len;
+
+  strcpy (strtab + off, s);
+  strtab_len += strlen (s) + 1;
+  return off;
+}
+
+/* Build the types and the symbol table, and the container's data object and
+   function info sections, which are not built by ctf_create() and must be
+   spliced into the serialized container by hand.  Return the container, to be
+   opened with ctf_bufopen().  */
+
+static unsigned char *
+build (struct types *t, Elf64_Sym *syms, size_t *sizep)
+{
+  ctf_encoding_t ie = { CTF_INT_SIGNED, 0, 32 };
+  ctf_encoding_t ce = { CTF_INT_SIGNED | CTF_INT_CHAR, 0, 8 };
+  uint32_t objt[NALLSYMS], func[NALLSYMS * 3];
+  size_t nobjt = 0, nfunc = 0, size, ins;
+  unsigned char *buf, *nbuf;
+  ctf_header_t *hp;
+  ctf_file_t *wfp;
+  char name[16];
+  size_t i;
+  int err;
+
+  CHECK ((wfp = ctf_create (&err)) != NULL);
+  t->t_int = ctf_add_integer (wfp, CTF_ADD_ROOT, "int", &ie);
+  t->t_char = ctf_add_integer (wfp, CTF_ADD_ROOT, "char", &ce);
+  t->t_cp = ctf_add_pointer (wfp, CTF_ADD_ROOT,
+			     ctf_add_const (wfp, CTF_ADD_ROOT, t->t_int));
+  t->t_td = ctf_add_typedef (wfp, CTF_ADD_ROOT, "myint", t->t_int);
+  CHECK ((buf = ctf_write_mem (wfp, &size, (size_t) -1)) != NULL);
+  ctf_file_close (wfp);
+
+  memset (syms, 0, NALLSYMS * sizeof (Elf64_Sym));
+  strtab_len = 0;
+  add_string ("");
+  for (i = 1; i <= NSYMS; i++)
+    {
+      syms[i].st_shndx = 1;
+      if (i % 2 == 0)
+	{
+	  sprintf (name, "f%zu", i);
+	  syms[i].st_info = ELF64_ST_INFO (STB_GLOBAL, STT_FUNC);
+	  syms[i].st_value = 0x100000 + i * 16;
+	  syms[i].st_size = 16;
+	  if (i % 4 == 0)
+	    {
+	      func[nfunc++] = CTF_TYPE_INFO (CTF_K_FUNCTION, 0, 1);
+	      func[nfunc++] = i % 8 == 0 ? t->t_cp : t->t_int;
+	      func[nfunc++] = t->t_char;
+	    }
+	  else
+	    {
+	      func[nfunc++] = CTF_TYPE_INFO (CTF_K_FUNCTION, 0, 0);
+	      func[nfunc++] = t->t_char;
+	    }
+	}
+      else
+	{
+	  sprintf (name, "o%zu", i);
+	  syms[i].st_info = ELF64_ST_INFO (STB_GLOBAL, STT_OBJECT);
+	  syms[i].st_value = 0x800000 + i * 8;
+	  syms[i].st_size = 8;
+	  objt[nobjt++] = i % 3 == 0 ? t->t_char : t->t_int;
+	}
+      syms[i].st_name = add_string (name);
+    }
+
+  syms[i].st_name = add_string ("dup");
+  syms[i].st_shndx = 1;
+  syms[i].st_info = ELF64_ST_INFO (STB_LOCAL, STT_OBJECT);
+  syms[i].st_value = 0x900000;
+  syms[i].st_size = 4;
+  objt[nobjt++] = t->t_char;
+  i++;
+  syms[i].st_name = syms[i - 1].st_name;
+  syms[i].st_shndx = 1;
+  syms[i].st_info = ELF64_ST_INFO (STB_GLOBAL, STT_OBJECT);
+  syms[i].st_value = 0x900010;
+  syms[i].st_size = 4;
+  objt[nobjt++] = t->t_int;
+
+  /* Insert the sections in front of the (empty) object section, moving
+     everything after it along.  The type offsets are no longer those the
+     index records, so drop it.  */
+
+  ins = (nobjt + nfunc) * sizeof (uint32_t);
+  hp = (ctf_header_t *) buf;
+  CHECK ((nbuf = malloc (size + ins)) != NULL);
+  memcpy (nbuf, buf, sizeof (ctf_header_t) + hp->cth_objtoff);
+  memcpy (nbuf + sizeof (ctf_header_t) + hp->cth_objtoff, objt,
+	  nobjt * sizeof (uint32_t));
+  memcpy (nbuf + sizeof (ctf_header_t) + hp->cth_objtoff
+	  + nobjt * sizeof (uint32_t), func, nfunc * sizeof (uint32_t));
+  memcpy (nbuf + sizeof (ctf_header_t) + hp->cth_objtoff + ins,
+	  buf + sizeof (ctf_header_t) + hp->cth_objtoff,
+	  size - sizeof (ctf_header_t) - hp->cth_objtoff);
+  free (buf);
+
+  hp = (ctf_header_t *) nbuf;
+  hp->cth_flags &= ~CTF_F_IDX;
+  hp->cth_funcoff = hp->cth_objtoff + nobjt * sizeof (uint32_t);
+  hp->cth_objtidxoff += ins;
+  hp->cth_funcidxoff += ins;
+  hp->cth_varoff += ins;
+  hp->cth_typeoff += ins;
+  hp->cth_stroff += ins;
+  *sizep = size + ins;
+  return nbuf;
+}
+
+static ctf_file_t *
+open_syms (unsigned char *buf, size_t size, Elf64_Sym *syms, int lazy)
+{
+  ctf_sect_t ctfsect = { .cts_name = ".ctf", .cts_data = buf,
+			 .cts_size = size, .cts_entsize = 1 };
+  ctf_sect_t symsect = { .cts_name = ".symtab", .cts_data = syms,
+			 .cts_size = NALLSYMS * sizeof (Elf64_Sym),
+			 .cts_entsize = sizeof (Elf64_Sym) };
+  ctf_sect_t strsect = { .cts_name = ".strtab", .cts_data = strtab,
+			 .cts_size = strtab_len, .cts_entsize = 1 };
+  ctf_file_t *fp;
+  int err;
+
+  ctf_setlazy (lazy);
+  fp = ctf_bufopen (&ctfsect, &symsect, &strsect, &err);
+  ctf_setlazy (0);
+  if (fp == NULL)
+    fprintf (stderr, "cannot open: %s\n", ctf_errmsg (err));
+  CHECK (fp != NULL);
+  return fp;
+}
+
+/* Look every symbol up by name, and compare with looking it up by index.  */
+
+static void
+check_names (ctf_file_t *fp, const struct types *t)
+{
+  ctf_funcinfo_t fi, nfi;
+  ctf_id_t args[2];
+  char name[16];
+  size_t i;
+
+  for (i = 1; i <= NSYMS; i++)
+    {
+      if (i % 2 == 0)
+	{
+	  sprintf (name, "f%zu", i);
+	  CHECK (ctf_func_info (fp, i, &fi) == 0);
+	  CHECK (ctf_func_info_by_name (fp, name, &nfi) == 0);
+	  CHECK (fi.ctc_return == nfi.ctc_return);
+	  CHECK (fi.ctc_argc == nfi.ctc_argc);
+	  CHECK (fi.ctc_argc == (i % 4 == 0));
+	  if (fi.ctc_argc != 0)
+	    {
+	      CHECK (ctf_func_args_by_name (fp, name, 2, args) == 0);
+	      CHECK (args[0] == t->t_char);
+	    }
+	  CHECK (ctf_lookup_object_by_name (fp, name) == CTF_ERR);
+	  CHECK (ctf_errno (fp) == ECTF_NOTDATA);
+	}
+      else
+	{
+	  sprintf (name, "o%zu", i);
+	  CHECK (ctf_lookup_object_by_name (fp, name)
+		 == ctf_lookup_by_symbol (fp, i));
+	  CHECK (ctf_lookup_by_symbol (fp, i)
+		 == (i % 3 == 0 ? t->t_char : t->t_int));
+	  CHECK (ctf_func_info_by_name (fp, name, &fi) < 0);
+	  CHECK (ctf_errno (fp) == ECTF_NOTFUNC);
+	}
+    }
+
+  /* Global symbols are preferred to local ones of the same name.  */
+
+  CHECK (ctf_lookup_object_by_name (fp, "dup") == t->t_int);
+  CHECK (ctf_lookup_object_by_name (fp, "nope") == CTF_ERR);
+  CHECK (ctf_errno (fp) == ECTF_NOTDATA);
+}
+
+/* Look addresses in and between the symbols up, one at a time and all
+   together.  */
+
+static void
+check_addrs (ctf_file_t *fp, const struct types *t)
+{
+  static uint64_t addrs[NSYMS * 4];
+  static ctf_addrinfo_t ais[NSYMS * 4];
+  ctf_addrinfo_t ai;
+  size_t i, n = 0;
+  ssize_t found;
+
+  for (i = 0; i < NSYMS * 2; i++)
+    addrs[n++] = 0x100000 + i * 5;
+  for (i = 0; i < NSYMS; i++)
+    addrs[n++] = 0x800000 + i * 3;
+  for (i = 0; i < NSYMS; i++)
+    addrs[n++] = 0x900000 + i % 40 - 10;
+
+  found = ctf_lookup_by_addr_n (fp, addrs, n, ais);
+  for (i = 0; i < n; i++)
+    {
+      if (ctf_lookup_by_addr (fp, addrs[i], &ai) < 0)
+	{
+	  CHECK (ctf_errno (fp) == ECTF_NOSYMADDR);
+	  CHECK (ais[i].cai_symidx == (unsigned long) -1);
+	  continue;
+	}
+      CHECK (ais[i].cai_symidx == ai.cai_symidx);
+      CHECK (ais[i].cai_offset == ai.cai_offset);
+      CHECK (ais[i].cai_flags == ai.cai_flags);
+      if (ai.cai_flags == CTF_ADDR_TYPED)
+	CHECK (ais[i].cai_type == ai.cai_type);
+      found--;
+    }
+  CHECK (found == 0);
+
+  CHECK (ctf_lookup_by_addr (fp, 0x100000 + 4 * 16 + 3, &ai) == 0);
+  CHECK (ai.cai_symidx == 4 && ai.cai_offset == 3);
+  CHECK (ai.cai_flags == (CTF_ADDR_FUNC | CTF_ADDR_TYPED));
+  CHECK (ai.cai_func.ctc_argc == 1 && ai.cai_func.ctc_return == t->t_int);
+  CHECK (ctf_lookup_by_addr (fp, 0x800000 + 9 * 8 + 7, &ai) == 0);
+  CHECK (ai.cai_symidx == 9 && ai.cai_offset == 7);
+  CHECK (ai.cai_flags == CTF_ADDR_TYPED && ai.cai_type == t->t_char);
+  CHECK (ctf_lookup_by_addr (fp, 0x100000 + 5 * 16, &ai) < 0);
+  CHECK (ctf_errno (fp) == ECTF_NOSYMADDR);
+}
+
+/* Count the functions ctf_func_iter_by_type() finds, checking that they are
+   found in symbol order.  */
+
+struct func_count
+{
+  unsigned long last;
+  size_t n;
+  size_t nreturn;
+};
+
+static int
+func_count_cb (const char *name, unsigned long symidx, int argn, void *arg)
+{
+  struct func_count *fc = arg;
+  char expected[16];
+
+  sprintf (expected, "f%lu", symidx);
+  CHECK (strcmp (name, expected) == 0);
+  CHECK (fc->n == 0 || symidx > fc->last);
+  fc->last = symidx;
+  fc->n++;
+  if (argn < 0)
+    fc->nreturn++;
+  return 0;
+}
+
+static size_t
+count_funcs (ctf_file_t *fp, ctf_id_t type, int flags, size_t *nreturnp)
+{
+  struct func_count fc = { 0, 0, 0 };
+
+  CHECK (ctf_func_iter_by_type (fp, type, flags, func_count_cb, &fc) == 0);
+  if (nreturnp != NULL)
+    *nreturnp = fc.nreturn;
+  return fc.n;
+}
+
+static void
+check_funcs (ctf_file_t *fp, const struct types *t)
+{
+  size_t nreturn;
+
+  CHECK (count_funcs (fp, t->t_char, CTF_FUNC_BY_ARG, &nreturn) == NSYMS / 4);
+  CHECK (nreturn == 0);
+  CHECK (count_funcs (fp, t->t_char, CTF_FUNC_BY_RETURN, &nreturn)
+	 == NSYMS / 4);
+  CHECK (nreturn == NSYMS / 4);
+  CHECK (count_funcs (fp, t->t_char, CTF_FUNC_BY_RETURN | CTF_FUNC_BY_ARG,
+		      NULL) == NSYMS / 2);
+  CHECK (count_funcs (fp, t->t_int, CTF_FUNC_BY_ARG, NULL) == 0);
+  CHECK (count_funcs (fp, t->t_int, CTF_FUNC_BY_RETURN, NULL) == NSYMS / 8);
+  CHECK (count_funcs (fp, t->t_cp, CTF_FUNC_BY_RETURN, NULL) == NSYMS / 8);
+  CHECK (count_funcs (fp, t->t_td, CTF_FUNC_BY_RETURN, NULL) == 0);
+
+  /* Matching by base type finds int, const int * and myint alike.  */
+
+  CHECK (count_funcs (fp, t->t_int, CTF_FUNC_BY_RETURN | CTF_FUNC_BY_BASE,
+		      NULL) == NSYMS / 4);
+  CHECK (count_funcs (fp, t->t_cp, CTF_FUNC_BY_RETURN | CTF_FUNC_BY_BASE,
+		      NULL) == NSYMS / 4);
+  CHECK (count_funcs (fp, t->t_td, CTF_FUNC_BY_RETURN | CTF_FUNC_BY_ARG
+		      | CTF_FUNC_BY_BASE, NULL) == NSYMS / 4);
+  CHECK (count_funcs (fp, t->t_char, CTF_FUNC_BY_RETURN | CTF_FUNC_BY_ARG
+		      | CTF_FUNC_BY_BASE, NULL) == NSYMS / 2);
+}
+
+int
+main (void)
+{
+  static Elf64_Sym syms[NALLSYMS];
+  struct types t;
+  unsigned char *buf;
+  size_t size;
+  int lazy;
+
+  buf = build (&t, syms, &size);
+  for (lazy = 0; lazy < 2; lazy++)
+    {
+      ctf_file_t *fp;
+
+      /* Function iteration first, before anything else has made lazy
+	 containers build their types.  */
+
+      fp = open_syms (buf, size, syms, lazy);
+      check_funcs (fp, &t);
+      check_names (fp, &t);
+      check_addrs (fp, &t);
+      ctf_file_close (fp);
+
+      fp = open_syms (buf, size, syms, lazy);
+      check_addrs (fp, &t);
+      check_funcs (fp, &t);
+      ctf_file_close (fp);
+    }
+
+  free (buf);
+  return 0;
+}
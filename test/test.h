@@ -0,0 +1,72 @@
+/* Helpers shared by the libdtrace-ctf tests.
+
+   Copyright (c) 2019, Oracle and/or its affiliates. All rights reserved.
+
+   Licensed under the Universal Permissive License v 1.0 as shown at
+   http://oss.oracle.com/licenses/upl.
+
+   Licensed under the GNU General Public License (GPL), version 2. See the file
+   COPYING in the top level of this tree.  */
+
+#ifndef	_TEST_H
+#define	_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ctf-api.h>
+
+/* Fail the test, naming the condition that did not hold.  */
+
+#define CHECK(cond)							\
+  do									\
+    {									\
+      if (!(cond))							\
+	{								\
+	  fprintf (stderr, "%s:%i: check failed: %s\n", __FILE__,	\
+		   __LINE__, #cond);					\
+	  exit (1);							\
+	}								\
+    }									\
+  while (0)
+
+/* Ways a writable container can be reopened read-only.  */
+
+enum test_open
+  {
+   TEST_INDEXED,		/* Using the persisted index.  */
+   TEST_UNINDEXED,		/* Ignoring the index.  */
+   TEST_LAZY,			/* Ignoring the index, building lazily.  */
+   TEST_NOPEN
+  };
+
+static const char *const test_open_names[TEST_NOPEN] =
+  { "indexed", "unindexed", "lazy" };
+
+/* Serialize the writable container WFP, and open the result read-only in the
+   given way, returning the buffer (to be freed once the container is closed)
+   in *BUFP.  */
+
+static inline ctf_file_t *
+test_reopen (ctf_file_t *wfp, enum test_open how, unsigned char **bufp)
+{
+  ctf_file_t *fp;
+  size_t size;
+  int err;
+
+  CHECK ((*bufp = ctf_write_mem (wfp, &size, (size_t) -1)) != NULL);
+  CHECK (((ctf_header_t *) *bufp)->cth_flags & CTF_F_IDX);
+  if (how != TEST_INDEXED)
+    ((ctf_header_t *) *bufp)->cth_flags &= ~CTF_F_IDX;
+
+  ctf_setlazy (how == TEST_LAZY);
+  fp = ctf_simple_open ((const char *) *bufp, size, NULL, 0, 0, NULL, 0, &err);
+  ctf_setlazy (0);
+  if (fp == NULL)
+    fprintf (stderr, "cannot open %s: %s\n", test_open_names[how],
+	     ctf_errmsg (err));
+  CHECK (fp != NULL);
+  return fp;
+}
+
+#endif				/* _TEST_H */
@@ -115,6 +115,9 @@ dump_ctf (const char *file, ctf_file_t *fp, int quiet, const char *one_section)
   if (!quiet)
     printf ("\nCTF file: %s\n", file);
 
+  /* The same types are named again and again.  */
+  ctf_setnamecache (fp, 1);
+
   for (i = 0, thing = things; *thing[0] ; thing++, i++)
     {
       ctf_dump_state_t *s = NULL;